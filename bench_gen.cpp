@@ -0,0 +1,296 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bench_gen.cpp
+    \brief Generate a synthetic .bib corpus for benchmarking
+
+    Usage: <tt>bench_gen <entries> [seed] [key prefix] > out.bib</tt>
+
+    Writes [entries] BibTeX entries to standard output. The mix of
+    entry types and fields follows a typical physics library:
+    mostly articles with journal, volume, pages, DOI and eprint
+    fields, some proceedings, books, theses and miscellaneous
+    entries, author lists from one to several hundred names with
+    LaTeX accents, titles and abstracts with nested braces, and
+    journals given both as names and as macros like <tt>\\prl</tt>.
+    About one entry in fifty repeats the journal, volume and pages
+    of an earlier entry under a different key, so that the
+    duplicate scan has something to find. The output depends only
+    on the arguments, so that benchmark runs are comparable. Keys
+    start with [key prefix] (default "Key"), so that two corpora
+    with different prefixes can be added to each other without
+    collisions.
+*/
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** \brief Deterministic choices for the generator
+ */
+class corpus_rng {
+
+protected:
+
+  /// The underlying generator
+  std::mt19937_64 gen;
+
+public:
+
+  corpus_rng(uint64_t seed) : gen(seed) {
+  }
+
+  /// Return an integer in <tt>[0,n)</tt>
+  size_t below(size_t n) {
+    return (size_t)(gen()%n);
+  }
+
+  /// Return true with probability \c p
+  bool chance(double p) {
+    return ((double)(gen()%1000000))<p*1.0e6;
+  }
+
+  /// Return a random element of \c list
+  const std::string &pick(const std::vector<std::string> &list) {
+    return list[below(list.size())];
+  }
+
+};
+
+/** \brief The journal, volume and pages of an article, kept so
+    that later entries can duplicate them
+ */
+struct article_ref {
+  std::string journal;
+  int volume;
+  int page;
+};
+
+int main(int argc, char *argv[]) {
+
+  if (argc<2) {
+    cerr << "Usage: bench_gen <entries> [seed] [key prefix]" << endl;
+    return 1;
+  }
+  size_t n=(size_t)strtoull(argv[1],0,10);
+  uint64_t seed=1;
+  if (argc>2) seed=strtoull(argv[2],0,10);
+  std::string prefix="Key";
+  if (argc>3) prefix=argv[3];
+
+  corpus_rng r(seed);
+
+  static const std::vector<std::string> last_names={
+    "Smith","Steiner","Lattimer","Prakash","Brown","M{\\\"u}ller",
+    "Schr{\\\"o}dinger","Gandolfi","Carlson","Reddy","Hebeler",
+    "Schwenk","Tews","Drischler","Ozel","Psaltis","Nättilä",
+    "Watts","Haensel","Zdunik","Fortin","Oertel","Gulminelli",
+    "Raduta","Typel","Hempel","Schaffner-Bielich","Sagert",
+    "Fischer","Bl{\\'a}zquez","G{\\'o}mez","Pe{\\~n}a","Dutra",
+    "Lourenco","Horowitz","Piekarewicz","Fattoyev","Li","Chen",
+    "Wang","Zhang","Yang","Ho","Nakazato","Sumiyoshi","Suzuki",
+    "O'Connor","Ott","Burrows","Couch","Janka","Bauswein"
+  };
+  static const std::vector<std::string> initials={
+    "A.","B.","C.","D.","E.","F.","G.","H.","J.","K.","L.","M.",
+    "N.","P.","R.","S.","T.","V.","W.","A. W.","J. M.","S.~K.",
+    "M.~B.","{\\AA}."
+  };
+  static const std::vector<std::string> journals={
+    "Phys. Rev. C","Phys. Rev. D","Phys. Rev. Lett.","Astrophys. J.",
+    "Astrophys. J. Lett.","Nucl. Phys. A","Phys. Lett. B",
+    "Mon. Not. Roy. Astron. Soc.","Astron. Astrophys.",
+    "Eur. Phys. J. A","J. Phys. G","Prog. Part. Nucl. Phys.",
+    "Physical Review C","Physical Review Letters",
+    "The Astrophysical Journal","\\prc","\\prl","\\apj","\\npa"
+  };
+  static const std::vector<std::string> words={
+    "neutron","star","equation","of","state","nuclear","matter",
+    "symmetry","energy","constraints","from","observations","the",
+    "radius","mass","dense","QCD","chiral","effective","field",
+    "theory","supernova","merger","gravitational","waves","tidal",
+    "deformability","crust","core","pasta","phases","quark",
+    "hyperons","Bayesian","inference","model","a","new","analysis",
+    "thermal","evolution","cooling","emission","X-ray","pulsar"
+  };
+  static const std::vector<std::string> months={
+    "jan","feb","mar","apr","may","jun","jul","aug","sep","oct",
+    "nov","dec"
+  };
+  static const std::vector<std::string> publishers={
+    "Springer","Cambridge University Press","Oxford University Press",
+    "World Scientific","Wiley","Princeton University Press"
+  };
+
+  std::vector<article_ref> refs;
+
+  for(size_t i=0;i<n;i++) {
+
+    // Choose the entry type
+    size_t t=r.below(100);
+    std::string tag;
+    if (t<70) tag="Article";
+    else if (t<82) tag="InProceedings";
+    else if (t<88) tag="Book";
+    else if (t<92) tag="PhdThesis";
+    else if (t<97) tag="Misc";
+    else tag="TechReport";
+
+    cout << "@" << tag << "{" << prefix << i << ",\n";
+
+    // Author list: usually short, occasionally a large collaboration
+    size_t n_auth;
+    size_t a=r.below(1000);
+    if (a<300) n_auth=1;
+    else if (a<600) n_auth=2+r.below(2);
+    else if (a<950) n_auth=4+r.below(8);
+    else if (a<995) n_auth=12+r.below(40);
+    else n_auth=100+r.below(400);
+    cout << "  author = {";
+    for(size_t j=0;j<n_auth;j++) {
+      if (j>0) cout << " and ";
+      if (r.chance(0.5)) {
+	cout << r.pick(last_names) << ", " << r.pick(initials);
+      } else {
+	cout << r.pick(initials) << " " << r.pick(last_names);
+      }
+    }
+    cout << "},\n";
+
+    // Title with nested braces and some math
+    size_t n_words=4+r.below(12);
+    cout << "  title = {";
+    for(size_t j=0;j<n_words;j++) {
+      if (j>0) cout << " ";
+      size_t s=r.below(20);
+      if (s==0) {
+	cout << "{{" << r.pick(words) << "}}";
+      } else if (s==1) {
+	cout << "{\\it " << r.pick(words) << " {" << r.pick(words)
+	     << "}}";
+      } else if (s==2) {
+	cout << "$M_{\\rm max}$";
+      } else {
+	cout << r.pick(words);
+      }
+    }
+    cout << "},\n";
+
+    int year=1960+(int)r.below(66);
+
+    if (tag=="Article") {
+
+      article_ref ref;
+      bool dup=(refs.size()>0 && r.chance(0.02));
+      if (dup) {
+	ref=refs[r.below(refs.size())];
+      } else {
+	ref.journal=r.pick(journals);
+	ref.volume=1+(int)r.below(999);
+	ref.page=1+(int)r.below(20000);
+	refs.push_back(ref);
+      }
+      if (ref.journal[0]=='\\') {
+	cout << "  journal = {" << ref.journal << "},\n";
+      } else if (r.chance(0.5)) {
+	cout << "  journal = \"" << ref.journal << "\",\n";
+      } else {
+	cout << "  journal = {" << ref.journal << "},\n";
+      }
+      cout << "  volume = {" << ref.volume << "},\n";
+      if (r.chance(0.3)) {
+	cout << "  pages = {" << ref.page << "},\n";
+      } else {
+	cout << "  pages = {" << ref.page << "--"
+	     << ref.page+1+(int)r.below(40) << "},\n";
+      }
+      cout << "  year = {" << year << "},\n";
+      if (r.chance(0.4)) {
+	cout << "  month = " << r.pick(months) << ",\n";
+      }
+      if (r.chance(0.8)) {
+	cout << "  doi = {10." << 1000+r.below(9000) << "/"
+	     << prefix << "." << i << "." << r.below(100000) << "},\n";
+      }
+      if (year>1992 && r.chance(0.6)) {
+	cout << "  eprint = {" << (year%100<10 ? "0" : "")
+	     << year%100 << "0" << 1+r.below(9) << "."
+	     << 10000+r.below(89999) << "},\n";
+      }
+
+    } else if (tag=="InProceedings") {
+
+      cout << "  booktitle = {Proceedings of the " << 1+r.below(40)
+	   << "th {International} {Conference} on "
+	   << r.pick(words) << " " << r.pick(words) << "},\n";
+      cout << "  pages = {" << 1+r.below(900) << "},\n";
+      cout << "  year = {" << year << "},\n";
+
+    } else if (tag=="Book") {
+
+      cout << "  publisher = {" << r.pick(publishers) << "},\n";
+      cout << "  address = {New York},\n";
+      cout << "  year = {" << year << "},\n";
+      if (r.chance(0.7)) {
+	cout << "  isbn = {978-" << 1000000000+r.below(899999999)
+	     << "},\n";
+      }
+
+    } else if (tag=="PhdThesis") {
+
+      cout << "  school = {University of " << r.pick(last_names)
+	   << "},\n";
+      cout << "  year = {" << year << "},\n";
+
+    } else {
+
+      cout << "  year = " << year << ",\n";
+      cout << "  note = \"" << r.pick(words) << " " << r.pick(words)
+	   << "\",\n";
+      cout << "  url = {https://example.org/" << prefix << "/"
+	   << i << "},\n";
+    }
+
+    // Long abstracts for some entries
+    if (r.chance(0.1)) {
+      cout << "  abstract = {";
+      size_t n_abs=50+r.below(250);
+      for(size_t j=0;j<n_abs;j++) {
+	if (j>0) cout << ((j%17==0) ? "\n    " : " ");
+	if (r.below(40)==0) {
+	  cout << "{\\em " << r.pick(words) << "}";
+	} else {
+	  cout << r.pick(words);
+	}
+      }
+      cout << "},\n";
+    }
+
+    cout << "}\n\n";
+  }
+
+  return 0;
+}
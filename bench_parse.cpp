@@ -0,0 +1,177 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bench_parse.cpp
+    \brief Compare the istream and memory-mapped parse paths
+
+    Usage: <tt>bench_parse <file.bib> [repeats] [threads]</tt>
+
+    Each parse path is run [repeats] times (default 3) over the same
+    file and the best time is reported. If [threads] is larger than
+    1, the parallel parse of the mapped buffer is also timed. The
+    parse into a bibtex::CompactBibliography is timed as well. The
+    program exits with a nonzero status if the paths produce
+    different entries.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bt_reader.h"
+#include "bt_mapped_file.h"
+#include "bt_compact.h"
+
+using namespace std;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/** \brief Parse \c fname through an <tt>std::ifstream</tt>
+ */
+double parse_istream(std::string fname,
+		     std::vector<bibtex::BibTeXEntry> &ents) {
+  ents.clear();
+  bench_clock::time_point t1=bench_clock::now();
+  std::ifstream in(fname.c_str());
+  bibtex::read(in,ents);
+  bench_clock::time_point t2=bench_clock::now();
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+/** \brief Parse \c fname through a memory mapping
+ */
+double parse_mmap(std::string fname,
+		  std::vector<bibtex::BibTeXEntry> &ents) {
+  ents.clear();
+  bench_clock::time_point t1=bench_clock::now();
+  bibtex::MappedFile mf(fname);
+  bibtex::read(mf.begin(),mf.end(),ents);
+  bench_clock::time_point t2=bench_clock::now();
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+/** \brief Parse \c fname through a memory mapping with 
+    \c nthreads threads
+ */
+double parse_parallel(std::string fname,
+		      std::vector<bibtex::BibTeXEntry> &ents,
+		      unsigned nthreads) {
+  ents.clear();
+  bench_clock::time_point t1=bench_clock::now();
+  bibtex::MappedFile mf(fname);
+  bibtex::read_parallel(mf.begin(),mf.end(),ents,nthreads);
+  bench_clock::time_point t2=bench_clock::now();
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+/** \brief Parse \c fname into a compact bibliography
+ */
+double parse_compact(std::string fname,
+		     bibtex::CompactBibliography &cb) {
+  bench_clock::time_point t1=bench_clock::now();
+  cb.open(fname);
+  bench_clock::time_point t2=bench_clock::now();
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+int main(int argc, char *argv[]) {
+
+  if (argc<2) {
+    cerr << "Usage: bench_parse <file.bib> [repeats] [threads]" << endl;
+    return 1;
+  }
+  std::string fname=argv[1];
+  int repeats=3;
+  if (argc>2) repeats=atoi(argv[2]);
+  if (repeats<1) repeats=1;
+  int threads=1;
+  if (argc>3) threads=atoi(argv[3]);
+
+  bibtex::MappedFile test(fname);
+  if (!test.is_open()) {
+    cerr << "Could not open file " << fname << " ." << endl;
+    return 2;
+  }
+  double mb=((double)test.size())/1.0e6;
+  test.close();
+
+  std::vector<bibtex::BibTeXEntry> ents_is, ents_mm, ents_par;
+  double best_is=0.0, best_mm=0.0, best_par=0.0, best_cp=0.0;
+  bibtex::CompactBibliography cb;
+  for(int i=0;i<repeats;i++) {
+    double t_is=parse_istream(fname,ents_is);
+    double t_mm=parse_mmap(fname,ents_mm);
+    if (i==0 || t_is<best_is) best_is=t_is;
+    if (i==0 || t_mm<best_mm) best_mm=t_mm;
+    if (threads>1) {
+      double t_par=parse_parallel(fname,ents_par,threads);
+      if (i==0 || t_par<best_par) best_par=t_par;
+    }
+    double t_cp=parse_compact(fname,cb);
+    if (i==0 || t_cp<best_cp) best_cp=t_cp;
+  }
+
+  cout << "file: " << fname << " (" << mb << " MB, "
+       << ents_mm.size() << " entries)" << endl;
+  cout << "istream: " << best_is << " s, "
+       << ents_is.size()/best_is << " entries/s, "
+       << mb/best_is << " MB/s" << endl;
+  cout << "mmap:    " << best_mm << " s, "
+       << ents_mm.size()/best_mm << " entries/s, "
+       << mb/best_mm << " MB/s" << endl;
+  cout << "speedup: " << best_is/best_mm << endl;
+  if (threads>1) {
+    cout << "mmap, " << threads << " threads: " << best_par << " s, "
+	 << ents_par.size()/best_par << " entries/s, "
+	 << mb/best_par << " MB/s" << endl;
+    cout << "speedup: " << best_is/best_par << endl;
+  }
+  cout << "compact: " << best_cp << " s, "
+       << cb.entries.size()/best_cp << " entries/s, "
+       << mb/best_cp << " MB/s, " << cb.arena_bytes()
+       << " bytes copied to arena" << endl;
+
+  if (ents_is!=ents_mm) {
+    cerr << "Parse results differ between istream and mmap paths."
+	 << endl;
+    return 3;
+  }
+  if (threads>1 && ents_par!=ents_mm) {
+    cerr << "Parse results differ between serial and parallel paths."
+	 << endl;
+    return 4;
+  }
+
+  bool compact_equal=(cb.entries.size()==ents_mm.size());
+  for(size_t i=0;compact_equal && i<ents_mm.size();i++) {
+    compact_equal=(cb.entries[i].to_entry()==ents_mm[i]);
+  }
+  if (!compact_equal) {
+    cerr << "Parse results differ between serial and compact paths."
+	 << endl;
+    return 5;
+  }
+
+  return 0;
+}
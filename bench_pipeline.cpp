@@ -0,0 +1,428 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bench_pipeline.cpp
+    \brief Time the main btmanip operations on a .bib file
+
+    Usage: <tt>bench_pipeline <file.bib> [add.bib] [repeats]
+    [dup entries] [journal list]</tt>
+
+    Times <tt>bibtex::read()</tt>, \ref btmanip::bib_file::parse_bib()
+    (both from scratch and as a reload of the unchanged file), \ref
+    btmanip::bib_file::add_bib() of [add.bib] (skipped if it is "-"
+    or not given), \ref btmanip::bib_file::search_or(), \ref
+    btmanip::bib_file::search_and() (both also with \ref
+    btmanip::bib_file::use_columns set and the columns already
+    built), \ref btmanip::bib_file::view_expr() with numeric and
+    text conditions, \ref btmanip::bib_file::find_text() both
+    with the word index built by the call and with the index
+    already built, \ref btmanip::bib_file::view_author() likewise,
+    \ref
+    btmanip::bib_file::remove_or(), \ref
+    btmanip::bib_file::clean(), the pairwise duplicate scan which
+    the \c dup command used over the first [dup entries] entries
+    (default 2000, since the scan is quadratic), \ref
+    btmanip::bib_file::find_duplicates() over all entries, \ref
+    btmanip::bib_file::auto_keys() with one and with four threads,
+    \ref btmanip::bib_file::sort_bib(), \ref
+    btmanip::bib_file::bib_output_one() for every entry, \ref
+    btmanip::bib_file::snapshot() (both the first one and one
+    after \ref btmanip::bib_file::search_or(), neither of which
+    copies entries), \ref btmanip::bib_file::undo() after \ref
+    btmanip::bib_file::clean(), and \ref btmanip::bib_file::clear()
+    after a parse.
+
+    Each operation is run [repeats] times (default 3) on a fresh
+    copy of the parsed file (on the parsed file itself for the two
+    searches without columns) and the best time is kept. The results
+    are written to standard output as a JSON object with one record
+    per operation giving the number of entries processed, the time
+    in seconds, the number of entries per second, the number of
+    calls to the global <tt>operator new</tt> and <tt>operator
+    delete</tt> during the last run, and the peak
+    resident set size of the process in MB after the operation. The
+    journal list (default <tt>btmanip_jlist</tt>) is used by \c
+    clean if it can be read. Output from the operations themselves
+    is discarded.
+
+    The corpora are typically created with \c bench_gen, see
+    <tt>make bench</tt>.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "bib_file.h"
+#include "json.hpp"
+
+using namespace std;
+using namespace btmanip;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/// Number of calls to the global <tt>operator new</tt>, with or
+/// without alignment
+static size_t n_new=0;
+
+/// Number of calls to the global <tt>operator delete</tt>
+static size_t n_delete=0;
+
+void *operator new(size_t n) {
+  n_new++;
+  void *p=malloc(n>0 ? n : 1);
+  if (p==0) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  if (p!=0) n_delete++;
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  if (p!=0) n_delete++;
+  free(p);
+}
+
+void *operator new(size_t n, std::align_val_t al) {
+  n_new++;
+  size_t a=(size_t)al;
+  void *p=aligned_alloc(a,(n+a-1)/a*a);
+  if (p==0) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  if (p!=0) n_delete++;
+  free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  if (p!=0) n_delete++;
+  free(p);
+}
+
+/** \brief Return the peak resident set size in MB
+ */
+double peak_rss_mb() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF,&ru);
+  // Linux reports kilobytes, OSX reports bytes
+#ifdef __APPLE__
+  return ((double)ru.ru_maxrss)/1024.0/1024.0;
+#else
+  return ((double)ru.ru_maxrss)/1024.0;
+#endif
+}
+
+/** \brief A stream buffer which discards its output
+ */
+class null_buf : public std::streambuf {
+protected:
+  virtual int_type overflow(int_type c) {
+    return traits_type::not_eof(c);
+  }
+};
+
+/** \brief Collects the timing results
+ */
+class bench_results {
+
+protected:
+
+  /// Number of times each operation is run
+  int repeats;
+
+  /// Buffer used to discard <tt>std::cout</tt>
+  null_buf nb;
+
+public:
+
+  /// The results
+  nlohmann::json list;
+
+  bench_results(int r) : repeats(r), list(nlohmann::json::array()) {
+  }
+
+  /** \brief Time \c op, calling \c setup before each run, and
+      record the best time for \c n entries under \c name
+  */
+  template<class Setup, class Op>
+  void run(std::string name, size_t n, Setup setup, Op op) {
+    double best=0.0;
+    size_t allocs=0, frees=0;
+    for(int i=0;i<repeats;i++) {
+      setup();
+      std::streambuf *old=std::cout.rdbuf(&nb);
+      size_t new1=n_new, delete1=n_delete;
+      bench_clock::time_point t1=bench_clock::now();
+      op();
+      bench_clock::time_point t2=bench_clock::now();
+      allocs=n_new-new1;
+      frees=n_delete-delete1;
+      std::cout.rdbuf(old);
+      double t=std::chrono::duration<double>(t2-t1).count();
+      if (i==0 || t<best) best=t;
+    }
+    nlohmann::json j;
+    j["name"]=name;
+    j["entries"]=n;
+    j["seconds"]=best;
+    j["entries_per_sec"]=(best>0.0) ? ((double)n)/best : 0.0;
+    j["allocations"]=allocs;
+    j["deallocations"]=frees;
+    j["peak_rss_mb"]=peak_rss_mb();
+    list.push_back(j);
+  }
+
+};
+
+int main(int argc, char *argv[]) {
+
+  if (argc<2) {
+    cerr << "Usage: bench_pipeline <file.bib> [add.bib] [repeats] "
+	 << "[dup entries] [journal list]" << endl;
+    return 1;
+  }
+  std::string fname=argv[1];
+  std::string fname_add;
+  if (argc>2 && ((std::string)argv[2])!="-") fname_add=argv[2];
+  int repeats=3;
+  if (argc>3) repeats=atoi(argv[3]);
+  if (repeats<1) repeats=1;
+  size_t n_dup=2000;
+  if (argc>4) n_dup=(size_t)strtoull(argv[4],0,10);
+  std::string fname_jlist="btmanip_jlist";
+  if (argc>5) fname_jlist=argv[5];
+
+  bibtex::MappedFile test(fname);
+  if (!test.is_open()) {
+    cerr << "Could not open file " << fname << " ." << endl;
+    return 2;
+  }
+  size_t bytes=test.size();
+  test.close();
+
+  bench_results br(repeats);
+
+  // The parsed file which is copied for each operation
+  bib_file base;
+  base.verbose=0;
+  base.read_journals(fname_jlist);
+  base.parse_bib(fname);
+  size_t n=base.entries.size();
+  bib_file bf;
+
+  // Replace bf by a copy of base. The copy is made after clearing
+  // bf, so that the memory of its previous entries is released
+  // first, see bib_file::clear().
+  auto copy_base=[&](){ bf.clear(); bf=base; };
+
+  std::vector<bibtex::BibTeXEntry> ents;
+  br.run("read",n,[&](){ ents.clear(); },[&](){
+    bibtex::MappedFile mf(fname);
+    bibtex::read(mf.begin(),mf.end(),ents);
+  });
+  ents.clear();
+
+  br.run("parse_bib",n,[&](){ bf=bib_file(); bf.verbose=0; },
+	 [&](){ bf.parse_bib(fname); });
+
+  br.run("parse_bib_reload",n,[&](){ copy_base(); },
+	 [&](){ bf.parse_bib(fname); });
+
+  if (fname_add.length()>0) {
+    size_t n_add=0;
+    {
+      bib_file tmp;
+      tmp.verbose=0;
+      tmp.parse_bib(fname_add);
+      n_add=tmp.entries.size();
+    }
+    br.run("add_bib",n_add,[&](){ copy_base(); },
+	   [&](){ bf.add_bib(fname_add,false); });
+  }
+
+  std::vector<std::string> args_or={"author","*Smith*",
+				    "journal","*Lett*"};
+  // The plain searches start from a parsed file, as in btmanip, so
+  // that the entries they remove are those read by parse_bib()
+  auto parse_fresh=[&](){ bf.clear(); bf.parse_bib(fname); };
+  br.run("search_or",n,parse_fresh,[&](){
+    std::vector<std::string> args=args_or;
+    bf.search_or(args);
+  });
+
+  std::vector<std::string> args_and={"journal","Phys*","year","20*"};
+  br.run("search_and",n,parse_fresh,[&](){
+    std::vector<std::string> args=args_and;
+    bf.search_and(args);
+  });
+
+  // The same searches with the columns built by an earlier search
+  // which keeps every entry
+  std::vector<std::string> args_all={"author","*","journal","*",
+				     "year","*","key","*"};
+  br.run("search_or_columns",n,[&](){
+    copy_base();
+    bf.use_columns=true;
+    std::vector<std::string> args=args_all;
+    bf.search_or(args);
+  },[&](){
+    std::vector<std::string> args=args_or;
+    bf.search_or(args);
+  });
+
+  br.run("search_and_columns",n,[&](){
+    copy_base();
+    bf.use_columns=true;
+    std::vector<std::string> args=args_all;
+    bf.search_or(args);
+  },[&](){
+    std::vector<std::string> args=args_and;
+    bf.search_and(args);
+  });
+
+  br.run("view_expr",n,[&](){ copy_base(); },[&](){
+    bf.view_expr("year between 2000 and 2010 and "
+		 "(journal ~ \"*lett*\" or volume > 50)");
+  });
+
+  // The first find builds the word index
+  std::vector<std::string> words={"neutron star","crust"};
+  std::vector<std::pair<double,size_t> > results;
+  br.run("find_text_build",n,[&](){ copy_base(); },[&](){
+    bf.find_text(words,results);
+  });
+
+  br.run("find_text",n,[&](){
+    copy_base();
+    bf.find_text(words,results);
+    bf.reset_views();
+  },[&](){
+    bf.find_text(words,results);
+  });
+
+  // The first author query builds the author index
+  std::vector<std::string> names={"Smith, J."};
+  br.run("view_author_build",n,[&](){ copy_base(); },[&](){
+    bf.view_author(names);
+  });
+
+  br.run("view_author",n,[&](){
+    copy_base();
+    bf.view_author(names);
+    bf.reset_views();
+  },[&](){
+    bf.view_author(names);
+  });
+
+  br.run("remove_or",n,[&](){ copy_base(); },[&](){
+    std::vector<std::string> args=args_or;
+    bf.remove_or(args);
+  });
+
+  br.run("clean",n,[&](){ copy_base(); },[&](){ bf.clean(false); });
+
+  // The pairwise scan formerly used by the 'dup' command
+  if (n_dup>n) n_dup=n;
+  size_t n_found=0;
+  br.run("dup",n_dup,[&](){ copy_base(); n_found=0; },[&](){
+    for(size_t i=0;i<n_dup;i++) {
+      for(size_t j=i+1;j<n_dup;j++) {
+	bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+	bibtex_entry &bt2=static_cast<bibtex_entry &>(bf.entries[j]);
+	if (bf.possible_duplicate(bt,bt2)!=0) n_found++;
+      }
+    }
+  });
+
+  // The grouped search of the 'dup' command over all entries
+  std::vector<std::pair<size_t,size_t> > dup_pairs;
+  std::vector<int> dup_vals;
+  br.run("find_duplicates",n,[&](){ copy_base(); },[&](){
+    bf.find_duplicates(dup_pairs,dup_vals);
+  });
+
+  std::vector<std::pair<std::string,std::string> > changes;
+  br.run("auto_keys",n,[&](){ copy_base(); bf.threads=1; },[&](){
+    bf.auto_keys(changes);
+  });
+  br.run("auto_keys_4_threads",n,[&](){ copy_base(); bf.threads=4; },[&](){
+    bf.auto_keys(changes);
+  });
+
+  br.run("sort_bib",n,[&](){ copy_base(); },[&](){ bf.sort_bib(); });
+
+  std::ostringstream oss;
+  br.run("bib_output_one",n,[&](){ copy_base(); oss.str(""); },[&](){
+    for(size_t i=0;i<bf.entries.size();i++) {
+      bf.bib_output_one(oss,static_cast<bibtex_entry &>(bf.entries[i]));
+    }
+  });
+
+  br.run("snapshot_first",n,[&](){
+    copy_base();
+    bf.clear_history();
+  },[&](){ bf.snapshot("first"); });
+
+  br.run("snapshot_after_search",n,[&](){
+    copy_base();
+    bf.clear_history();
+    bf.snapshot("first");
+    std::vector<std::string> args=args_or;
+    bf.search_or(args);
+  },[&](){ bf.snapshot("search"); });
+
+  br.run("undo_clean",n,[&](){
+    copy_base();
+    bf.clear_history();
+    bf.snapshot("clean");
+    bf.clean(false);
+  },[&](){ bf.undo(); });
+
+  br.run("clear",n,[&](){
+    bf=bib_file();
+    bf.verbose=0;
+    bf.parse_bib(fname);
+  },[&](){ bf.clear(); });
+
+  nlohmann::json j;
+  j["file"]=fname;
+  j["bytes"]=bytes;
+  j["entries"]=n;
+  j["repeats"]=repeats;
+  j["dup_pairs_found"]=n_found;
+  j["duplicate_pairs"]=dup_pairs.size();
+  j["results"]=br.list;
+  j["peak_rss_mb"]=peak_rss_mb();
+  cout << j.dump(2) << endl;
+
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bench_stream.cpp
+    \brief Check that the streaming reader runs in bounded memory
+
+    Usage: <tt>bench_stream [max entries]</tt>
+
+    Streams synthetic inputs of increasing size (10^4 entries up
+    to [max entries], default 10^6) through bibtex::EntryReader and
+    reports the peak resident set size after each one. The input
+    is generated on the fly, so the only memory which could grow
+    with the input size is that used by the reader. The program
+    exits with a nonzero status if the peak RSS after the largest
+    input exceeds the peak after the smallest by more than 16 MB.
+*/
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "bt_reader.h"
+
+using namespace std;
+
+/** \brief A stream buffer which generates \c n BibTeX entries
+ */
+class synthetic_bib_buf : public std::streambuf {
+
+protected:
+
+  /// Number of entries remaining
+  size_t n;
+  
+  /// Index of the next entry
+  size_t ix;
+  
+  /// The current entry
+  std::string cur;
+
+  virtual int_type underflow() {
+    if (gptr()<egptr()) return traits_type::to_int_type(*gptr());
+    if (ix==n) return traits_type::eof();
+    std::ostringstream oss;
+    oss << "@Article{Key" << ix << ",\n"
+	<< "  author = {Last" << ix % 97 << ", F. and Other, A.},\n"
+	<< "  title = {A {Synthetic} title number " << ix << "},\n"
+	<< "  journal = \"Phys. Rev. C\",\n"
+	<< "  year = " << 1950+ix % 70 << ",\n"
+	<< "  volume = {" << ix % 113 << "},\n"
+	<< "  pages = {" << ix << "--" << ix+9 << "}\n"
+	<< "}\n\n";
+    cur=oss.str();
+    ix++;
+    char *p=&cur[0];
+    setg(p,p,p+cur.size());
+    return traits_type::to_int_type(*gptr());
+  }
+
+public:
+
+  synthetic_bib_buf(size_t nent) : n(nent), ix(0) {
+  }
+  
+};
+
+/** \brief Return the peak resident set size in MB
+ */
+double peak_rss_mb() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF,&ru);
+  // ru_maxrss is in kilobytes on Linux
+  return ru.ru_maxrss/1024.0;
+}
+
+int main(int argc, char *argv[]) {
+
+  size_t nmax=1000000;
+  if (argc>1) nmax=strtoul(argv[1],0,10);
+  
+  double first_rss=0.0, last_rss=0.0;
+  for(size_t n=10000;n<=nmax;n*=10) {
+    synthetic_bib_buf sb(n);
+    std::istream in(&sb);
+    size_t count=0, nfields=0;
+    count=bibtex::for_each_entry(in,[&](bibtex::BibTeXEntry &e) {
+      nfields+=e.fields.size();
+    });
+    if (count!=n) {
+      cerr << "Read " << count << " entries but expected " << n
+	   << "." << endl;
+      return 2;
+    }
+    last_rss=peak_rss_mb();
+    if (n==10000) first_rss=last_rss;
+    cout << "entries: " << n << " fields: " << nfields
+	 << " peak RSS: " << last_rss << " MB" << endl;
+  }
+
+  if (last_rss>first_rss+16.0) {
+    cerr << "Peak RSS grew from " << first_rss << " MB to "
+	 << last_rss << " MB." << endl;
+    return 3;
+  }
+  
+  return 0;
+}
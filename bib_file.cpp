@@ -26,6 +26,10 @@
 #include "bib_file.h"
 #include "hdf_bibtex.h"
 
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 #include "o2scl/cursesw.h"
 
 #include <o2scl/cli_readline.h>
@@ -42,80 +46,65 @@ std::string bibtex_tools::lower_string(std::string s) {
   return s;
 }
 
-std::string bibtex_entry::get_field(std::string field) {
-  return get_field_ref(field);
+size_t bibtex_entry::find_present(const std::string &field) const {
+  size_t j=find_field(field);
+  while (j!=npos && fields[j].second.size()==0) {
+    j=find_field(field,j+1);
+  }
+  return j;
 }
 
-std::string &bibtex_entry::get_field_ref(std::string field) {
+std::string bibtex_entry::get_field(const std::string &field) {
 
-  // Convert user-specified field to lowercase
-  field=this->lower_string(field);
-      
-  for(size_t j=0;j<fields.size();j++) {
+  // Expand the value without modifying the entry
+  size_t j=find_present(field);
+  if (j!=npos) return bibtex::expand(fields[j].second);
+  
+  // Otherwise, get_field_ref() will call the error handler
+  return get_field_ref(field);
+}
 
-    std::string lower=fields[j].first;
-    lower=this->lower_string(lower);
-        
-    if (lower==field) {
-      if (fields[j].second.size()==1) {
-        return fields[j].second[0];
-      } else if (fields[j].second.size()>1) {
-        O2SCL_ERR("Field had multiple entries.",
-                  o2scl::exc_esanity);
-      } else {
-        O2SCL_ERR("Field found but value vector was empty.",
-                  o2scl::exc_einval);
-      }
+std::string &bibtex_entry::get_field_ref(const std::string &field) {
+
+  size_t j=find_field(field);
+  if (j!=npos) {
+    if (fields[j].second.size()>0) {
+      // Values which refer to macros are replaced by their
+      // expansion, since the caller may modify the value
+      return bibtex::resolve(fields[j].second).str();
+    } else {
+      O2SCL_ERR("Field found but value vector was empty.",
+                o2scl::exc_einval);
     }
   }
   if (!key) {
-    O2SCL_ERR((((std::string)"Field ")+field+
+    O2SCL_ERR((((std::string)"Field ")+lower_string(field)+
                " not found in entry with no key ").c_str(),
               o2scl::exc_einval);
   }
-  O2SCL_ERR((((std::string)"Field ")+field+
+  O2SCL_ERR((((std::string)"Field ")+lower_string(field)+
              " not found in entry with key "+(*key).c_str()).c_str(),
             o2scl::exc_einval);
       
-  return fields[0].first;
+  return fields[0].second[0].str();
 }
 
 /** \brief Return true if field \c field is present (case-insensitive)
  */
-bool bibtex_entry::is_field_present(std::string field) {
-
-  // Convert user-specified field to lowercase
-  field=this->lower_string(field);
-      
-  for(size_t j=0;j<fields.size();j++) {
-
-    std::string lower=lower_string(fields[j].first);
-    
-    if (lower==field && fields[j].second.size()>0) {
-      return true;
-    }
-  }
-  return false;
+bool bibtex_entry::is_field_present(const std::string &field) {
+  return find_present(field)!=npos;
 }
     
 /** \brief Return true if field \c field1 or field \c field2 is 
     present (case-insensitive)
 */
-bool bibtex_entry::is_field_present_or(std::string field1, std::string field2) {
-
-  field1=lower_string(field1);
-  field2=lower_string(field2);
-      
-  for(size_t j=0;j<fields.size();j++) {
-    std::string lower=lower_string(fields[j].first);
-    if ((lower==field1 || lower==field2) && fields[j].second.size()>0) {
-      return true;
-    }
-  }
-  return false;
+bool bibtex_entry::is_field_present_or(const std::string &field1,
+                                       const std::string &field2) {
+  return find_present(field1)!=npos || find_present(field2)!=npos;
 }
 
 bib_file::bib_file() {
+  n_removed=0;
   remove_extra_whitespace=false;
   recase_tag=true;
   reformat_journal=true;
@@ -129,6 +118,13 @@ bib_file::bib_file() {
   add_empty_titles=true;
   remove_author_tildes=true;
   verbose=1;
+  threads=1;
+  skip_bad_entries=true;
+  use_mmap=true;
+  use_columns=false;
+  use_text_index=false;
+  undo_levels=20;
+  cache="off";
       
   trans_latex.push_back("{\\'a}");
   trans_latex_alt.push_back("\\'{a}");
@@ -496,60 +492,382 @@ std::string bib_file::first_page(std::string pages) {
 void bib_file::search_keys(std::string pattern,
 			   std::vector<std::string> &list) {
   list.clear();
-  for(size_t i=0;i<entries.size();i++) {
-    bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
-    if (fnmatch(pattern.c_str(),(*bt.key).c_str(),0)==0) {
+  bibtex::GlobMatcher glob(pattern);
+  for(size_t i=0;i<view_size();i++) {
+    bibtex_entry &bt=view_entry(i);
+    if (bt.key && glob.matches(*bt.key)) {
       list.push_back(*bt.key);
     }
   }
   return;
 }
 
-int bib_file::search_or(std::vector<std::string> &args) {
+bibtex::Query bib_file::make_query(std::vector<std::string> &args,
+				    bibtex::Query::Mode mode) {
+  bibtex::Query q(mode);
+  for(size_t k=0;k+1<args.size();k+=2) {
+    q.add(args[k],args[k+1]);
+  }
+  return q;
+}
+
+void bib_file::match_query(const bibtex::Query &q, std::vector<char> &match,
+			   const std::vector<size_t> *subset) {
+  q.evaluate(entries,match,subset,use_columns ? &columns : 0);
+  return;
+}
+
+size_t bib_file::keep_entries(const std::vector<char> &keep) {
+  history.remove(entries,keep,arena);
+  size_t n_keep=entries.size();
+  invalidate_indexes(keep);
+  key_index.rebuild(entries);
+  reset_views();
+  return n_keep;
+}
+
+int bib_file::push_view(std::vector<size_t> &ix, std::string desc) {
+  int n_matches=ix.size();
+  if (ix.size()>0) {
+    if (verbose>0) {
+      if (ix.size()==1) {
+	std::cout << "1 record found." << std::endl;
+      } else {
+	std::cout << ix.size() << " records found." << std::endl;
+      }
+    }
+    views.push_back(std::vector<size_t>());
+    std::swap(views.back(),ix);
+    view_descs.push_back(desc);
+  } else {
+    if (verbose>0) {
+      std::cout << "No records found." << std::endl;
+    }
+  }
+  return n_matches;
+}
+
+int bib_file::view_or(std::vector<std::string> &args) {
+  compact();
 
   if (args.size()==0 || args.size()%2!=0) {
-    O2SCL_ERR("Need a set of field and pattern pairs in search_or().",
+    O2SCL_ERR("Need a set of field and pattern pairs in view_or().",
 	      o2scl::exc_einval);
   }
-      
-  std::vector<bibtex::BibTeXEntry> entries2;
-      
-  for(size_t i=0;i<entries.size();i++) {
 
-    bool entry_matches=false;
-    bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
+  const std::vector<size_t> *subset=0;
+  if (views.size()>0) subset=&views.back();
+  
+  std::vector<char> match(entries.size(),0);
+  match_query(make_query(args,bibtex::Query::any),match,subset);
+  std::string desc="or";
+  for(size_t k=0;k<args.size();k+=2) {
+    desc+=" "+args[k]+" "+args[k+1];
+  }
 
-    for(size_t k=0;k<args.size();k+=2) {
-      std::string field=lower_string(args[k]);
-      std::string pattern=args[k+1];
-      if (field==((string)"key")) {
-	if (fnmatch(pattern.c_str(),(*bt.key).c_str(),0)==0) {
-	  entry_matches=true;
-	}
-      } else {
-	for(size_t j=0;j<bt.fields.size();j++) {
-	  std::string tmp=lower_string(bt.fields[j].first);
-	  if (tmp==field &&
-	      fnmatch(pattern.c_str(),bt.fields[j].second[0].c_str(),0)==0) {
-	    entry_matches=true;
-	  }
-	}
+  std::vector<size_t> ix;
+  for(size_t k=0;k<view_size();k++) {
+    if (match[view_index(k)]) ix.push_back(view_index(k));
+  }
+  return push_view(ix,desc);
+}
+
+int bib_file::view_and(std::vector<std::string> &args) {
+  compact();
+
+  if (args.size()==0 || args.size()%2!=0) {
+    O2SCL_ERR("Need a set of field and pattern pairs in view_and().",
+	      o2scl::exc_einval);
+  }
+
+  const std::vector<size_t> *subset=0;
+  if (views.size()>0) subset=&views.back();
+  
+  std::vector<char> match(entries.size(),0);
+  match_query(make_query(args,bibtex::Query::all),match,subset);
+  std::string desc="and";
+  for(size_t k=0;k<args.size();k+=2) {
+    desc+=" "+args[k]+" "+args[k+1];
+  }
+
+  std::vector<size_t> ix;
+  for(size_t k=0;k<view_size();k++) {
+    if (match[view_index(k)]) ix.push_back(view_index(k));
+  }
+  return push_view(ix,desc);
+}
+
+int bib_file::view_expr(std::string expr) {
+  compact();
+
+  bibtex::Expression e;
+  std::string err;
+  if (!e.parse(expr,err)) {
+    O2SCL_ERR((((std::string)"Could not parse expression in ")+
+	       "view_expr(): "+err+".").c_str(),o2scl::exc_einval);
+  }
+
+  const std::vector<size_t> *subset=0;
+  if (views.size()>0) subset=&views.back();
+  
+  std::vector<char> match(entries.size(),0);
+  e.evaluate(entries,match,subset,use_columns ? &columns : 0);
+
+  std::vector<size_t> ix;
+  for(size_t k=0;k<view_size();k++) {
+    if (match[view_index(k)]) ix.push_back(view_index(k));
+  }
+  return push_view(ix,"expr "+expr);
+}
+
+int bib_file::find_text(std::vector<std::string> &words,
+			std::vector<std::pair<double,size_t> > &results) {
+  compact();
+
+  if (words.size()==0) {
+    O2SCL_ERR("No words specified in find_text().",o2scl::exc_einval);
+  }
+  if (!text_index.current(entries)) {
+    text_index.build(entries,threads);
+  }
+  text_index.search(words,results);
+
+  // Keep only the results in the current view
+  if (views.size()>0) {
+    std::vector<char> in_view(entries.size(),0);
+    for(size_t k=0;k<view_size();k++) in_view[view_index(k)]=1;
+    size_t n=0;
+    for(size_t k=0;k<results.size();k++) {
+      if (in_view[results[k].second]) results[n++]=results[k];
+    }
+    results.resize(n);
+  }
+
+  // The view keeps the order of the entries
+  std::vector<size_t> ix(results.size());
+  for(size_t k=0;k<results.size();k++) ix[k]=results[k].second;
+  std::sort(ix.begin(),ix.end());
+  
+  std::string desc="find";
+  for(size_t k=0;k<words.size();k++) desc+=" "+words[k];
+  return push_view(ix,desc);
+}
+
+int bib_file::view_author(std::vector<std::string> &names) {
+  compact();
+
+  if (names.size()==0) {
+    O2SCL_ERR("No names specified in view_author().",o2scl::exc_einval);
+  }
+  auto split=[this](const std::string &name,
+		   std::vector<std::string> &firstv,
+		   std::vector<std::string> &lastv) {
+    parse_author(name,firstv,lastv);
+  };
+  if (!author_index.current(entries)) {
+    author_index.build(entries,split);
+  }
+
+  std::vector<size_t> found;
+  std::string key, initials;
+  for(size_t k=0;k<names.size();k++) {
+    if (!bibtex::AuthorIndex::normalize_name(names[k],split,key,
+					      initials)) {
+      O2SCL_ERR(((std::string)"Could not read name '")+names[k]+
+		"' in view_author().",o2scl::exc_einval);
+    }
+    author_index.find(key,initials,found);
+  }
+  std::sort(found.begin(),found.end());
+  found.erase(std::unique(found.begin(),found.end()),found.end());
+
+  // Keep only the entries in the current view
+  std::vector<size_t> ix;
+  if (views.size()>0) {
+    std::vector<char> in_view(entries.size(),0);
+    for(size_t k=0;k<view_size();k++) in_view[view_index(k)]=1;
+    for(size_t k=0;k<found.size();k++) {
+      if (in_view[found[k]]) ix.push_back(found[k]);
+    }
+  } else {
+    std::swap(ix,found);
+  }
+
+  std::string desc="author";
+  for(size_t k=0;k<names.size();k++) desc+=" "+names[k];
+  return push_view(ix,desc);
+}
+
+void bib_file::pop_view() {
+  if (views.size()>0) {
+    views.pop_back();
+    view_descs.pop_back();
+  }
+  return;
+}
+
+void bib_file::reset_views() {
+  views.clear();
+  view_descs.clear();
+  return;
+}
+
+void bib_file::apply_view() {
+  compact();
+  if (views.size()==0) return;
+
+  std::vector<size_t> &ix=views.back();
+  std::vector<char> keep(entries.size(),0);
+  for(size_t k=0;k<ix.size();k++) {
+    keep[ix[k]]=1;
+  }
+  history.select(entries,ix,arena);
+  invalidate_indexes(keep);
+  reset_views();
+
+  // Rebuild the key index, since the indexes changed
+  key_index.rebuild(entries);
+  
+  if (verbose>1) {
+    std::cout << "Kept the " << entries.size()
+	      << " entries in the current view." << std::endl;
+  }
+  return;
+}
+
+void bib_file::remove_entry(size_t i) {
+  if (removed.size()<entries.size()) removed.resize(entries.size(),0);
+  if (removed[i]) return;
+  removed[i]=1;
+  n_removed++;
+
+  if (!entries[i].key || key_index.find(*entries[i].key)!=i) return;
+  std::string key=*entries[i].key;
+  key_index.erase(key);
+  
+  // If other entries have the same key, the next one which was not
+  // removed is now the first one
+  if (key_index.size()+n_removed<entries.size()) {
+    for(size_t j=i+1;j<entries.size();j++) {
+      if (entries[j].key && *entries[j].key==key && !is_removed(j)) {
+	key_index.insert(key,j);
+	break;
       }
     }
-    if (entry_matches) {
-      entries2.push_back(bt);
+  }
+  return;
+}
+
+void bib_file::compact() {
+  if (n_removed==0) return;
+
+  // Move the entries which remain, recording their new indexes
+  std::vector<size_t> new_ix(entries.size(),bibtex::KeyIndex::npos);
+  std::vector<char> keep(entries.size(),1);
+  size_t n_keep=0;
+  for(size_t i=0;i<entries.size();i++) {
+    if (i<removed.size() && removed[i]) {
+      keep[i]=0;
+    } else {
+      new_ix[i]=n_keep;
+      n_keep++;
     }
   }
-  int n_matches=entries2.size();
-  if (entries2.size()>0) {
+  history.remove(entries,keep,arena);
+  invalidate_indexes(keep);
+  key_index.remap(new_ix);
+  for(size_t k=0;k<views.size();k++) {
+    size_t m=0;
+    for(size_t j=0;j<views[k].size();j++) {
+      if (keep[views[k][j]]) views[k][m++]=new_ix[views[k][j]];
+    }
+    views[k].resize(m);
+  }
+  
+  removed.assign(n_keep,0);
+  n_removed=0;
+  return;
+}
+
+void bib_file::restore_snapshot(bibtex::Snapshot &s) {
+  removed.clear();
+  n_removed=0;
+  invalidate_indexes();
+  views.swap(s.views);
+  view_descs.swap(s.view_descs);
+  s.views.clear();
+  s.view_descs.clear();
+  key_index.rebuild(entries);
+  return;
+}
+
+void bib_file::snapshot(std::string desc) {
+  compact();
+  if (undo_levels<0) undo_levels=0;
+  history.set_depth((size_t)undo_levels);
+  bibtex::Snapshot s;
+  s.desc=desc;
+  s.views=views;
+  s.view_descs=view_descs;
+  history.push(s);
+  return;
+}
+
+bool bib_file::undo() {
+  if (history.undo_size()==0) return false;
+  // Removals which are pending are made first, so that they are
+  // undone along with the others
+  compact();
+  // The current state is saved for redo() under the description
+  // of the change which is undone
+  bibtex::Snapshot s;
+  s.desc=history.undo_top().desc;
+  s.views=views;
+  s.view_descs=view_descs;
+  history.undo(entries,arena,s);
+  restore_snapshot(s);
+  return true;
+}
+
+bool bib_file::redo() {
+  if (history.redo_size()==0) return false;
+  // Removals which are pending are dropped, since they were made
+  // after the snapshot which is restored
+  removed.clear();
+  n_removed=0;
+  bibtex::Snapshot s;
+  s.desc=history.redo_top().desc;
+  s.views=views;
+  s.view_descs=view_descs;
+  history.redo(entries,arena,s);
+  restore_snapshot(s);
+  return true;
+}
+
+int bib_file::search_or(std::vector<std::string> &args) {
+  compact();
+
+  if (args.size()==0 || args.size()%2!=0) {
+    O2SCL_ERR("Need a set of field and pattern pairs in search_or().",
+	      o2scl::exc_einval);
+  }
+      
+  std::vector<char> match(entries.size(),0);
+  match_query(make_query(args,bibtex::Query::any),match);
+  
+  size_t n_matches=0;
+  for(size_t i=0;i<entries.size();i++) {
+    if (match[i]) n_matches++;
+  }
+  if (n_matches>0) {
     if (verbose>0) {
-      if (entries2.size()==1) {
+      if (n_matches==1) {
 	std::cout << "1 record found." << std::endl;
       } else {
-	std::cout << entries2.size() << " records found." << std::endl;
+	std::cout << n_matches << " records found." << std::endl;
       }
     }
-    std::swap(entries,entries2);
+    keep_entries(match);
   } else {
     if (verbose>0) {
       std::cout << "No records found." << std::endl;
@@ -559,37 +877,20 @@ int bib_file::search_or(std::vector<std::string> &args) {
 }
     
 void bib_file::remove_or(std::vector<std::string> &args) {
+  compact();
 
   if (args.size()==0 || args.size()%2!=0) {
     O2SCL_ERR("Need a set of field and pattern pairs in remove_or().",
 	      o2scl::exc_einval);
   }
       
-  bool restart_loop=true;
-  while (restart_loop) {
-    restart_loop=false;
-	
-    for(std::vector<bibtex::BibTeXEntry>::iterator it=entries.begin();
-	restart_loop==false && it!=entries.end();it++) {
-	  
-      bibtex_entry &bt=static_cast<bibtex_entry &>(*it);
-	  
-      for(size_t k=0;restart_loop==false && k<args.size();k+=2) {
-	std::string field=lower_string(args[k]);
-	std::string pattern=args[k+1];
-	for(size_t j=0;restart_loop==false && j<bt.fields.size();j++) {
-	  std::string tmp=lower_string(bt.fields[j].first);
-	  if (tmp==field &&
-	      fnmatch(pattern.c_str(),
-		      bt.fields[j].second[0].c_str(),0)==0) {
-	    entries.erase(it);
-	    // Reset the interator and restart the loops
-	    restart_loop=true;
-	  }
-	}
-      }
-    }
+  // Remove the matching entries, keeping the others in order
+  std::vector<char> match(entries.size(),0);
+  match_query(make_query(args,bibtex::Query::any),match);
+  for(size_t i=0;i<entries.size();i++) {
+    match[i]=!match[i];
   }
+  keep_entries(match);
       
   if (verbose>0) {
     if (entries.size()==0) {
@@ -604,49 +905,27 @@ void bib_file::remove_or(std::vector<std::string> &args) {
 }
 
 void bib_file::search_and(std::vector<std::string> &args) {
+  compact();
 
   if (args.size()==0 || args.size()%2!=0) {
     O2SCL_ERR("Need a set of field and pattern pairs in search_and().",
 	      o2scl::exc_einval);
   }
       
-  for(size_t k=0;k<args.size();k+=2) {
-
-    std::string field=lower_string(args[k]);
-    std::string pattern=args[k+1];
-	
-    std::vector<bibtex::BibTeXEntry> entries2;
-
-    for(size_t i=0;i<entries.size();i++) {
-      bool entry_matches=false;
-      bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
-      if (field==((string)"key")) {
-	if (fnmatch(pattern.c_str(),(*bt.key).c_str(),0)==0) {
-	  entry_matches=true;
-	}
-      } else {
-	for(size_t j=0;j<bt.fields.size();j++) {
-	  std::string tmp=lower_string(bt.fields[j].first);
-	  if (tmp==field &&
-	      fnmatch(pattern.c_str(),bt.fields[j].second[0].c_str(),0)==0) {
-	    entry_matches=true;
-	  }
-	}
-      }
-      if (entry_matches) {
-	entries2.push_back(bt);
-      }
-    }
-
-    if (entries2.size()>0) {
-      std::swap(entries,entries2);
-    } else {
-      if (verbose>0) {
-	std::cout << "No records found." << std::endl;
-      }
-      return;
+  std::vector<char> match(entries.size(),0);
+  match_query(make_query(args,bibtex::Query::all),match);
+  
+  size_t n_matches=0;
+  for(size_t i=0;i<entries.size();i++) {
+    if (match[i]) n_matches++;
+  }
+  if (n_matches==0) {
+    if (verbose>0) {
+      std::cout << "No records found." << std::endl;
     }
+    return;
   }
+  keep_entries(match);
 
   if (verbose>0) {
     if (entries.size()==1) {
@@ -861,9 +1140,10 @@ bool bib_file::entry_add_empty_title(bibtex_entry &bt) {
   if (lower_string(bt.tag)==((std::string)"article") ||
       lower_string(bt.tag)==((std::string)"inproceedings")) {
     if (!is_field_present(bt,"title")) {
-      std::vector<std::string> val;
+      bibtex::ValueVector val;
       val.push_back(" ");
       bt.fields.push_back(std::make_pair("title",val));
+      bt.invalidate_field_index();
       changed=true;
       if (verbose>1) {
 	std::cout << "In entry with key " << *bt.key
@@ -890,10 +1170,11 @@ bool bib_file::entry_autoformat_url(bibtex_entry &bt) {
 	  }
 	}
       } else {
-	std::vector<std::string> val;
+	bibtex::ValueVector val;
 	val.push_back(((std::string)"https://doi.org/")+
 		      bt.get_field("doi"));
 	bt.fields.push_back(std::make_pair("url",val));
+	bt.invalidate_field_index();
 	changed=true;
 	if (verbose>1) {
 	  std::cout << "In entry with key " << *bt.key
@@ -903,10 +1184,11 @@ bool bib_file::entry_autoformat_url(bibtex_entry &bt) {
     }
   } else if (lower_string(bt.tag)==((std::string)"book")) {
     if (is_field_present(bt,"isbn") && !is_field_present(bt,"url")) {
-      std::vector<std::string> val;
+      bibtex::ValueVector val;
       val.push_back(((std::string)"http://www.worldcat.org/isbn/")+
 		    bt.get_field("isbn"));
       bt.fields.push_back(std::make_pair("url",val));
+      bt.invalidate_field_index();
       changed=true;
       if (verbose>1) {
 	std::cout << "In entry with key " << *bt.key
@@ -1034,6 +1316,8 @@ bool bib_file::entry_remove_vol_letters(bibtex_entry &bt) {
 }
     
 void bib_file::clean(bool prompt) {
+  compact();
+  invalidate_indexes();
 
   size_t empty_titles_added=0;
   size_t entries_fields_removed=0;
@@ -1077,17 +1361,23 @@ void bib_file::clean(bool prompt) {
     bool this_tags_normalized=false;
     bool this_author_fields_notilde=false;
 
-    // Make a copy
+    // A copy of the entry is kept for undo(), since the entry is
+    // modified in place
+    bibtex::BibTeXEntry old;
+    bool record_old=history.begin_modify(i);
+    if (record_old) old=entries[i];
     bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
 
     if (normalize_tags) {
 	  
-      std::string old_tag=bt.tag;
+      bibtex::Symbol old_tag=bt.tag;
       // Capitalize first letter and downcase all other letters
-      bt.tag[0]=std::toupper(bt.tag[0]);
-      for(size_t i2=1;i2<bt.tag.size();i2++) {
-	bt.tag[i2]=std::tolower(bt.tag[i2]);
+      std::string new_tag=bt.tag;
+      new_tag[0]=std::toupper(new_tag[0]);
+      for(size_t i2=1;i2<new_tag.size();i2++) {
+	new_tag[i2]=std::tolower(new_tag[i2]);
       }
+      bt.tag=new_tag;
       // Manually fix tags which normally have more than one
       // uppercase letter
       if (bt.tag==((std::string)"Inbook")) {
@@ -1139,19 +1429,24 @@ void bib_file::clean(bool prompt) {
 	  }
 	}
 
-	// Remove extra braces from each value
-	std::string &valtemp=bt.fields[j].second[0];
-	bool removed_verb=false;
-	while (valtemp.length()>=4 && valtemp[0]=='{' &&
-	       valtemp[1]=='{' && valtemp[valtemp.size()-1]=='}' &&
-	       valtemp[valtemp.size()-2]=='}') {
-	  valtemp=valtemp.substr(1,valtemp.size()-2);
-	  entry_changed[i]=true;
-	  if (removed_verb==false && verbose>1) {
-	    std::cout << "Removing extra braces in entry with key "
-		      << *bt.key << " for field " << bt.fields[j].first
-		      << "with value:\n" << valtemp << std::endl;
-	    removed_verb=true;
+	// Remove extra braces from each value, leaving values
+	// which refer to macros or are concatenated unchanged
+	const std::string &valtext=bt.fields[j].second[0];
+	if (bibtex::is_plain(bt.fields[j].second) &&
+	    valtext.length()>=4 && valtext[0]=='{' && valtext[1]=='{') {
+	  std::string &valtemp=bt.fields[j].second[0].str();
+	  bool removed_verb=false;
+	  while (valtemp.length()>=4 && valtemp[0]=='{' &&
+		 valtemp[1]=='{' && valtemp[valtemp.size()-1]=='}' &&
+		 valtemp[valtemp.size()-2]=='}') {
+	    valtemp=valtemp.substr(1,valtemp.size()-2);
+	    entry_changed[i]=true;
+	    if (removed_verb==false && verbose>1) {
+	      std::cout << "Removing extra braces in entry with key "
+			<< *bt.key << " for field " << bt.fields[j].first
+			<< "with value:\n" << valtemp << std::endl;
+	      removed_verb=true;
+	    }
 	  }
 	}
 
@@ -1165,6 +1460,7 @@ void bib_file::clean(bool prompt) {
 			<< " in entry with key " << *bt.key << std::endl;
 	    }
 	    bt.fields.erase(bt.fields.begin()+j);
+	    bt.invalidate_field_index();
 	    restart_loop=true;
 	    j=bt.fields.size();
 	    field_removed=true;
@@ -1182,17 +1478,14 @@ void bib_file::clean(bool prompt) {
 	    std::string err=((std::string)"Field ")+bt.fields[j].first+
 	      " has no values";
 	    O2SCL_ERR(err.c_str(),o2scl::exc_einval);
-	  } else if (bt.fields[j].second.size()>1) {
-	    std::string err=((std::string)"Field ")+bt.fields[j].first+
-	      " has more than one value";
-	    O2SCL_ERR(err.c_str(),o2scl::exc_einval);
 	  }
 	  
 	  if (remove_extra_whitespace) {
 	    for(size_t k=0;k<bt.fields[j].second.size();k++) {
-	      std::string old=bt.fields[j].second[k];
-	      thin_whitespace(bt.fields[j].second[k]);
-	      if (bt.fields[j].second[k]!=old) {
+	      if (bt.fields[j].second[k].macro) continue;
+	      std::string old=bt.fields[j].second[k].text();
+	      thin_whitespace(bt.fields[j].second[k].str());
+	      if (bt.fields[j].second[k].text()!=old) {
 		entry_changed[i]=true;
 	      }
 	    }
@@ -1204,7 +1497,7 @@ void bib_file::clean(bool prompt) {
 	      bt.fields[j].first==((std::string)"journal") &&
 	      journals.size()>0 ) {
 	    if (bt.fields[j].second.size()>0) {
-	      std::string jour=bt.fields[j].second[0];
+	      std::string jour=bibtex::expand(bt.fields[j].second);
 	      std::string abbrev;
 	      if (find_abbrev(jour,abbrev)==0) {
 		// Avoid changing arxiv entries in journal fields
@@ -1213,7 +1506,7 @@ void bib_file::clean(bool prompt) {
 		    std::cout << "Reformatting journal " << jour << " to "
 			      << abbrev << std::endl;
 		  }
-		  bt.fields[j].second[0]=abbrev;
+		  bt.fields[j].second.assign(1,bibtex::Value(abbrev));
 		  this_journals_renamed=true;
 		  entry_changed[i]=true;
 		}
@@ -1224,6 +1517,9 @@ void bib_file::clean(bool prompt) {
 	    }
 	  }
 
+	  // Values decoded or replaced above are shared again
+	  bibtex::encode_shared_value(bt.fields[j]);
+
 	  // End of if (field_removed==false)
 	}
 	// End of loop over fields
@@ -1262,6 +1558,14 @@ void bib_file::clean(bool prompt) {
       entry_check_required(bt);
     }
 
+    if (record_old) {
+      if (bibtex::same_entry(old,entries[i])) {
+	history.unmodified(i);
+      } else {
+	history.modified(i,std::move(old),arena);
+      }
+    }
+
     if (entry_changed[i]==true) {
       bool accept=false;
       if (prompt) {
@@ -1393,15 +1697,18 @@ void bib_file::clean(bool prompt) {
 
 int bib_file::set_field_value(bibtex_entry &bt, std::string field,
 			      std::string value) {
+  invalidate_indexes();
+  modify_entry(bt);
   for(size_t j=0;j<bt.fields.size();j++) {
     if (bt.fields[j].first==field) {
-      bt.fields[j].second[0]=value;
+      bt.fields[j].second.assign(1,bibtex::Value(value));
       return 0;
     }
   }
-  std::vector<std::string> list={value};
+  bibtex::ValueVector list(1,bibtex::Value(value));
   // If the field is not found, then add it
   bt.fields.push_back(std::make_pair(field,list));
+  bt.invalidate_field_index();
       
   return 0;
 }
@@ -1412,67 +1719,452 @@ int bib_file::set_field_value(std::string key, std::string field,
   return set_field_value(bt,field,value);
 }
     
+int bib_file::read_buffer(std::string fname, bibtex::MappedFile &mf,
+			  std::string &buf, const char *&first,
+			  const char *&last) {
+
+  // Obtain the file contents as one contiguous buffer, either
+  // by mapping the file or by reading it through a stream
+  if (use_mmap) {
+    if (!mf.open(fname)) {
+      return o2scl::exc_efilenotfound;
+    }
+    first=mf.begin();
+    last=mf.end();
+  } else {
+    std::ifstream in(fname.c_str(),std::ios::binary);
+    if (!in) {
+      return o2scl::exc_efilenotfound;
+    }
+    buf.assign(std::istreambuf_iterator<char>(in),
+	       std::istreambuf_iterator<char>());
+    first=buf.data();
+    last=first+buf.size();
+  }
+  return 0;
+}
+
+int bib_file::read_entries(std::string fname,
+			   std::vector<bibtex::BibTeXEntry> &ents,
+			   std::vector<size_t> *sort_index,
+			   bibtex::SourceMap *smap) {
+
+  parse_errors.clear();
+  if (sort_index) sort_index->clear();
+  if (smap) smap->clear();
+
+  bool cache_read=false, cache_write=false;
+  if (cache==((std::string)"read")) {
+    cache_read=true;
+  } else if (cache==((std::string)"rw")) {
+    cache_read=true;
+    cache_write=true;
+  } else if (cache!=((std::string)"off")) {
+    std::cerr << "Warning: unknown cache mode " << cache
+	      << ", not using the cache." << std::endl;
+  }
+
+  // Record the file's size and modification time before reading it
+  bibtex::CacheStamp stamp;
+  if (cache_read && !bibtex::stat_file(fname,stamp)) {
+    cache_read=false;
+    cache_write=false;
+  }
+  
+  bibtex::MappedFile mf;
+  std::string buf;
+  const char *first, *last;
+  if (read_buffer(fname,mf,buf,first,last)!=0) {
+    return o2scl::exc_efilenotfound;
+  }
+
+  // Try the cache
+  std::string cname=bibtex::cache_file_name(fname);
+  bool cached=false;
+  if (cache_read) {
+    stamp.hash=bibtex::content_hash(first,last);
+    if (skip_bad_entries) stamp.flags|=1;
+    std::vector<size_t> ix;
+    cached=bibtex::read_cache(cname,stamp,ents,parse_errors,ix);
+    if (cached) {
+      if (sort_index) std::swap(*sort_index,ix);
+      if (verbose>1) {
+	std::cout << "Read entries from cache file " << cname
+		  << "." << std::endl;
+      }
+    }
+  }
+
+  if (!cached) {
+    
+    // Parse into a separate list if ents is not empty so that
+    // only the entries from this file are cached
+    std::vector<bibtex::BibTeXEntry> ents_file;
+    std::vector<bibtex::BibTeXEntry> &out=(ents.size()>0 && cache_write) ?
+      ents_file : ents;
+    
+    // Record where each entry came from only when it is needed,
+    // and when the spans are relative to the start of 'out'
+    std::vector<bibtex::EntrySpan> spans;
+    std::vector<bibtex::EntrySpan> *spans_ptr=0;
+    if (smap && out.size()==0) spans_ptr=&spans;
+    
+    if (verbose>1) std::cout << "Starting bibtex::read()." << std::endl;
+    if (threads>1) {
+      bibtex::read_parallel(first,last,out,threads,&parse_errors,
+			    skip_bad_entries,spans_ptr);
+    } else {
+      bibtex::read_with_errors(first,last,out,parse_errors,
+			       skip_bad_entries,spans_ptr);
+    }
+    if (verbose>1) std::cout << "Done with bibtex::read()." << std::endl;
+
+    if (spans_ptr && parse_errors.size()==0) {
+      bibtex::make_source_map(first,last,spans,*smap);
+    }
+
+    if (cache_write) {
+      if (bibtex::write_cache(cname,stamp,out,parse_errors,
+			      bibtex::sort_index(out))) {
+	if (verbose>1) {
+	  std::cout << "Wrote cache file " << cname << "." << std::endl;
+	}
+      } else if (verbose>0) {
+	std::cout << "Could not write cache file " << cname
+		  << "." << std::endl;
+      }
+    }
+    
+    for(size_t i=0;i<ents_file.size();i++) {
+      ents.push_back(std::move(ents_file[i]));
+    }
+  }
+  
+  // Report the entries which could not be parsed
+  for(size_t i=0;i<parse_errors.size();i++) {
+    const bibtex::ParseError &pe=parse_errors[i];
+    std::cerr << "Warning: could not parse entry at line " << pe.line
+	      << ", column " << pe.column << " (byte " << pe.offset
+	      << ") of file " << fname << ":\n  " << pe.text << std::endl;
+  }
+  if (parse_errors.size()>0) {
+    if (skip_bad_entries) {
+      std::cerr << "Skipped " << parse_errors.size()
+		<< " entries which could not be parsed." << std::endl;
+    } else {
+      std::cerr << "Parsing stopped at this entry and the remainder "
+		<< "of file " << fname << " was ignored." << std::endl;
+    }
+  }
+  
+  return 0;
+}
+    
+size_t bib_file::define_macros(std::vector<bibtex::BibTeXEntry> &ents) {
+
+  // Move the @string entries into the macro table, in order, so
+  // that each definition may refer to the earlier ones
+  size_t n_def=0, n_keep=0;
+  for(size_t i=0;i<ents.size();i++) {
+    if (lower_string(ents[i].tag)==((string)"string")) {
+      if (ents[i].fields.size()==1) {
+	macros.define(ents[i].fields[0].first,ents[i].fields[0].second);
+	n_def++;
+      }
+    } else {
+      if (n_keep!=i) std::swap(ents[n_keep],ents[i]);
+      n_keep++;
+    }
+  }
+  ents.resize(n_keep);
+
+  // Link macro references in the remaining entries, and store
+  // journal and publisher names once in the symbol table
+  for(size_t i=0;i<ents.size();i++) {
+    for(size_t j=0;j<ents[i].fields.size();j++) {
+      if (macros.size()>0) macros.link(ents[i].fields[j].second);
+      bibtex::encode_shared_value(ents[i].fields[j]);
+    }
+  }
+  
+  if (verbose>1 && n_def>0) {
+    std::cout << "Defined " << n_def << " macros." << std::endl;
+  }
+  return n_def;
+}
+
+void bib_file::warn_repeated_fields(bibtex_entry &bt) {
+  
+  // Warn if some fields don't occur multiple times
+  for(size_t j=0;j<bt.fields.size();j++) {
+    for(size_t k=j+1;k<bt.fields.size();k++) {
+      std::string field_j=lower_string(bt.fields[j].first);
+      std::string field_k=lower_string(bt.fields[k].first);
+      if (field_j==field_k && (field_j==((string)"title") ||
+			       field_j==((string)"doi") ||
+			       field_j==((string)"year") ||
+			       field_j==((string)"volume") ||
+			       field_j==((string)"pages") ||
+			       field_j==((string)"author") ||
+			       field_j==((string)"journal") ||
+			       field_j==((string)"month"))) {
+	cerr << "Warning: field " << field_j << " occurs twice "
+	     << "in entry " << *bt.key << endl;
+      }
+    }
+  }
+  return;
+}
+
+void bib_file::set_source(std::string fname,
+			  const std::vector<bibtex::BibTeXEntry> &ents) {
+  
+  source_entry.clear();
+  source_hash.clear();
+  if (source_map.spans.size()!=ents.size()) {
+    // The file was read from the cache or had entries which
+    // could not be parsed
+    source_fname.clear();
+    source_map.clear();
+    return;
+  }
+  
+  source_fname=fname;
+  source_entry.resize(ents.size());
+  for(size_t i=0;i<ents.size();i++) {
+    if (lower_string(ents[i].tag)==((string)"string")) {
+      source_entry[i]=std::string::npos;
+    } else {
+      source_entry[i]=source_hash.size();
+      source_hash.push_back(bibtex::entry_hash(ents[i]));
+    }
+  }
+  return;
+}
+
+bool bib_file::reparse_bib(std::string fname) {
+
+  // The entries must be as they were read, and in the same order
+  if (source_hash.size()!=entries.size()) return false;
+  for(size_t i=0;i<entries.size();i++) {
+    if (bibtex::entry_hash(entries[i])!=source_hash[i]) return false;
+  }
+
+  bibtex::MappedFile mf;
+  std::string buf;
+  const char *first, *last;
+  if (read_buffer(fname,mf,buf,first,last)!=0) return false;
+
+  // Re-parse the entries which changed. The spans [b,e) are
+  // replaced by the entries in 'mid'.
+  size_t b, e;
+  std::vector<bibtex::BibTeXEntry> mid;
+  bibtex::SourceMap smap;
+  bool parsed;
+  {
+    bibtex::EntryArenaScope eas(arena.get());
+    parsed=bibtex::reparse(source_map,first,last,b,e,mid,smap);
+  }
+  if (!parsed) {
+    return false;
+  }
+
+  // Changes to the @string definitions require a full parse, 
+  // since they may affect any entry
+  for(size_t i=b;i<e;i++) {
+    if (source_entry[i]==std::string::npos) return false;
+  }
+  for(size_t i=0;i<mid.size();i++) {
+    if (lower_string(mid[i].tag)==((string)"string")) return false;
+    if (!mid[i].key) return false;
+  }
+
+  // The range of replaced entries in 'entries'
+  size_t eb=entries.size();
+  for(size_t i=b;i<source_entry.size();i++) {
+    if (source_entry[i]!=std::string::npos) {
+      eb=source_entry[i];
+      break;
+    }
+  }
+  size_t ee=eb+(e-b);
+
+  // Match old and new entries by key. Duplicate keys, or new keys
+  // which are used by other entries, require a full parse to
+  // obtain the same warnings and key index.
+  std::map<std::string,size_t> old_keys, new_keys;
+  for(size_t i=eb;i<ee;i++) {
+    if (!entries[i].key ||
+	!old_keys.insert(make_pair(*entries[i].key,i)).second ||
+	key_index.find(*entries[i].key)!=i) {
+      return false;
+    }
+  }
+  for(size_t i=0;i<mid.size();i++) {
+    if (!new_keys.insert(make_pair(*mid[i].key,i)).second) {
+      return false;
+    }
+    if (old_keys.find(*mid[i].key)==old_keys.end() &&
+	key_index.find(*mid[i].key)!=bibtex::KeyIndex::npos) {
+      return false;
+    }
+  }
+  for(std::map<std::string,size_t>::iterator it=old_keys.begin();
+      it!=old_keys.end();it++) {
+    std::map<std::string,size_t>::iterator it2=new_keys.find(it->first);
+    if (it2==new_keys.end()) {
+      keys_removed.push_back(it->first);
+    } else if (!(entries[it->second]==mid[it2->second])) {
+      keys_modified.push_back(it->first);
+    }
+  }
+  for(std::map<std::string,size_t>::iterator it=new_keys.begin();
+      it!=new_keys.end();it++) {
+    if (old_keys.find(it->first)==old_keys.end()) {
+      keys_added.push_back(it->first);
+    }
+  }
+
+  // Replace the entries and update the key index in place
+  for(size_t i=0;i<mid.size();i++) {
+    for(size_t j=0;j<mid[i].fields.size();j++) {
+      macros.link(mid[i].fields[j].second);
+      bibtex::encode_shared_value(mid[i].fields[j]);
+    }
+    warn_repeated_fields(static_cast<bibtex_entry &>(mid[i]));
+  }
+  for(size_t i=eb;i<ee;i++) {
+    key_index.erase(*entries[i].key);
+  }
+  size_t n_mid=mid.size();
+  if (n_mid!=ee-eb) {
+    key_index.shift(ee,((std::ptrdiff_t)n_mid)-((std::ptrdiff_t)(ee-eb)));
+  }
+  history.splice(entries,eb,ee-eb,mid,arena);
+  for(size_t i=eb;i<eb+n_mid;i++) {
+    key_index.insert(*entries[i].key,i);
+  }
+
+  // Update the record of the source
+  std::vector<size_t> entry2(smap.spans.size());
+  for(size_t i=0;i<b;i++) entry2[i]=source_entry[i];
+  for(size_t i=0;i<n_mid;i++) entry2[b+i]=eb+i;
+  for(size_t i=e;i<source_entry.size();i++) {
+    if (source_entry[i]==std::string::npos) {
+      entry2[i-e+b+n_mid]=std::string::npos;
+    } else {
+      entry2[i-e+b+n_mid]=source_entry[i]+n_mid-(ee-eb);
+    }
+  }
+  std::swap(source_entry,entry2);
+  std::swap(source_map,smap);
+  source_hash.erase(source_hash.begin()+eb,source_hash.begin()+ee);
+  std::vector<uint64_t> hash_mid(n_mid);
+  for(size_t i=0;i<n_mid;i++) {
+    hash_mid[i]=bibtex::entry_hash(entries[eb+i]);
+  }
+  source_hash.insert(source_hash.begin()+eb,hash_mid.begin(),
+		     hash_mid.end());
+  parse_errors.clear();
+
+  if (verbose>0) {
+    std::cout << "Re-parsed " << n_mid << " of " << entries.size()
+	      << " entries from file " << fname << ": "
+	      << keys_added.size() << " added, " << keys_removed.size()
+	      << " removed, " << keys_modified.size() << " modified."
+	      << std::endl;
+    for(size_t i=0;i<keys_added.size();i++) {
+      std::cout << "  Added: " << keys_added[i] << std::endl;
+    }
+    for(size_t i=0;i<keys_removed.size();i++) {
+      std::cout << "  Removed: " << keys_removed[i] << std::endl;
+    }
+    for(size_t i=0;i<keys_modified.size();i++) {
+      std::cout << "  Modified: " << keys_modified[i] << std::endl;
+    }
+  }
+  
+  return true;
+}
+
+void bib_file::clear() {
+  std::vector<bibtex::BibTeXEntry> none;
+  history.splice(entries,0,entries.size(),none,arena);
+  removed.clear();
+  n_removed=0;
+  key_index.clear();
+  invalidate_indexes();
+  reset_views();
+  source_fname.clear();
+  source_map.clear();
+  source_entry.clear();
+  source_hash.clear();
+  arena.reset();
+  return;
+}
+
 void bib_file::parse_bib(std::string fname) {
+  compact();
+  invalidate_indexes();
+  reset_views();
 
-  // Open file
+  // Parse the file
   wordexp_single_file(fname);
-  std::ifstream in(fname.c_str());
-  if (!in) {
+  keys_added.clear();
+  keys_removed.clear();
+  keys_modified.clear();
+
+  // If this file was parsed before, try to re-parse only the
+  // entries which changed
+  if (fname==source_fname && reparse_bib(fname)) {
+    if (use_text_index) text_index.build(entries,threads);
+    return;
+  }
+  
+  // Read the new entries into a new arena, which replaces the
+  // current one once the current entries are gone
+  if (entries.size()==0) arena.reset();
+  std::shared_ptr<bibtex::EntryArena> ents_arena
+    =std::make_shared<bibtex::EntryArena>();
+  std::vector<bibtex::BibTeXEntry> ents;
+  std::vector<size_t> sort_ix;
+  bibtex::SourceMap smap;
+  int ret;
+  {
+    bibtex::EntryArenaScope eas(*ents_arena);
+    ret=read_entries(fname,ents,&sort_ix,&smap);
+  }
+  if (ret!=0) {
+    source_fname.clear();
     std::cerr << "File open failed. Wrong filename?" << std::endl;
     return;
   }
+  std::swap(source_map,smap);
+  set_source(fname,ents);
+  
+  // Replace current entries and macros
+  macros.clear();
+  define_macros(ents);
+  history.splice(entries,0,entries.size(),ents,arena);
+  arena.reset(ents_arena);
 
-  // Erase current entries
-  if (entries.size()>0) {
-    entries.clear();
-    sort.clear();
+  // Index the keys. If the index was cached, the key order is
+  // already known.
+  key_index.rebuild(entries);
+  if (sort_ix.size()==key_index.size()) {
+    key_index.set_sorted(sort_ix);
   }
-      
-  // Parse and close the file
-  if (verbose>1) std::cout << "Starting bibtex::read()." << std::endl;
-  bibtex::read(in,entries); 
-  if (verbose>1) std::cout << "Done with bibtex::read()." << std::endl;
-  in.close();
 
   // Loop over entries in order to check and sort
   for(size_t i=0;i<entries.size();i++) {
       
     bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
     
-    // Double check that the value list doesn't have
-    // more than one entry
-    for(size_t j=0;j<bt.fields.size();j++) {
-      if (bt.fields[j].second.size()>1) {
-	O2SCL_ERR((((string)"Entry ")+*bt.key+
-		   " resulted in a value list "+
-		   "with more than one entry.").c_str(),o2scl::exc_esanity);
-      }
-    }
-
-    // Warn if some fields don't occur multiple times
-    for(size_t j=0;j<bt.fields.size();j++) {
-      for(size_t k=j+1;k<bt.fields.size();k++) {
-	std::string field_j=lower_string(bt.fields[j].first);
-	std::string field_k=lower_string(bt.fields[k].first);
-	if (field_j==field_k && (field_j==((string)"title") ||
-				 field_j==((string)"doi") ||
-				 field_j==((string)"year") ||
-				 field_j==((string)"volume") ||
-				 field_j==((string)"pages") ||
-				 field_j==((string)"author") ||
-				 field_j==((string)"journal") ||
-				 field_j==((string)"month"))) {
-	  cerr << "Warning: field " << field_j << " occurs twice "
-	       << "in entry " << *bt.key << endl;
-	}
-      }
-    }
+    warn_repeated_fields(bt);
     
-    // Insert to the map for sorting
+    // Only the first entry with each key is in the index
     if (bt.key) {
-      if (sort.find(*bt.key)==sort.end()) {
-	sort.insert(make_pair(*bt.key,i));
-      } else {
+      if (key_index.find(*bt.key)!=i) {
 	std::cerr << "Warning: multiple entries with key "
 		  << *bt.key << ". Keeping only the first entry."
 		  << std::endl;
@@ -1500,9 +2192,9 @@ void bib_file::parse_bib(std::string fname) {
      the same key. We currently allow this, thus this 
      test must be removed. 
   */
-  if (false && entries.size()!=sort.size()) {
+  if (false && entries.size()!=key_index.size()) {
     std::cout << "Entries: " << entries.size() << " sort: "
-	      << sort.size() << std::endl;
+	      << key_index.size() << std::endl;
     O2SCL_ERR2("Entries and sort structures mismatched in ",
 	       "bib_file::parse_bib().",o2scl::exc_efailed);
   }
@@ -1515,49 +2207,49 @@ void bib_file::parse_bib(std::string fname) {
   // Just for debugging
   if (false) {
     std::cout << "Sort: " << std::endl;
-    for(std::map<std::string,size_t,
-	  std::greater<std::string> >::iterator it=sort.begin();
-	it!=sort.end();it++) {
-      std::cout << it->first << " " << it->second << std::endl;
+    const std::vector<size_t> &ix=key_index.sorted();
+    for(size_t i=0;i<ix.size();i++) {
+      std::cout << *entries[ix[i]].key << " " << ix[i] << std::endl;
     }
   }
+
+  // Index the words of the text fields
+  if (use_text_index) text_index.build(entries,threads);
       
   return;
 }
     
 void bib_file::refresh_sort() {
-  sort.clear();
-  // Go through all entries
-  for(size_t i=0;i<entries.size();i++) {
-    bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
-    // If the key is not already in the sort map, add it
-    if (sort.find(*bt.key)==sort.end()) {
-      sort.insert(make_pair(*bt.key,i));
-    }
+  if (n_removed>0) {
+    if (removed.size()<entries.size()) removed.resize(entries.size(),0);
+    key_index.rebuild(entries,&removed);
+  } else {
+    key_index.rebuild(entries);
   }
   return;
 }
     
 void bib_file::sort_bib() {
+  compact();
+  invalidate_indexes();
+  reset_views();
 
-  if (entries.size()!=sort.size()) {
+  if (entries.size()!=key_index.size()) {
     O2SCL_ERR("Cannot sort when two entries have the same key.",
 	      o2scl::exc_efailed);
   }
       
-  std::vector<bibtex::BibTeXEntry> entries2;
-  for(std::map<std::string,size_t,
-	std::greater<std::string> >::iterator it=sort.begin();
-      it!=sort.end();it++) {
-    entries2.push_back(entries[it->second]);
-  }
-  std::swap(entries,entries2);
+  std::vector<size_t> ix=key_index.sorted();
+  history.select(entries,ix,arena);
   refresh_sort();
       
   return;
 }
 
 void bib_file::sort_by_date(bool descending) {
+  compact();
+  invalidate_indexes();
+  reset_views();
 
   if (descending) {
     
@@ -1722,12 +2414,12 @@ void bib_file::sort_by_date(bool descending) {
       cout << "Here: " << sortable_date << " " << i << endl;
     }
   
-    std::vector<bibtex::BibTeXEntry> entries2;
+    std::vector<size_t> ix;
     for(sbdit=sbd.begin();sbdit!=sbd.end();sbdit++) {
-      entries2.push_back(entries[sbdit->second]);
+      ix.push_back(sbdit->second);
     }
 
-    std::swap(entries,entries2);
+    history.select(entries,ix,arena);
     refresh_sort();
     
   }
@@ -1736,12 +2428,16 @@ void bib_file::sort_by_date(bool descending) {
 }
 
 void bib_file::reverse_bib() {
+  compact();
+  invalidate_indexes();
+  reset_views();
 
-  std::vector<bibtex::BibTeXEntry> entries2(entries.size());
+  std::vector<size_t> ix(entries.size());
   for(size_t j=0;j<entries.size();j++) {
-    entries2[entries.size()-1-j]=entries[j];
+    ix[entries.size()-1-j]=j;
   }
-  std::swap(entries,entries2);
+  history.select(entries,ix,arena);
+  refresh_sort();
       
   return;
 }
@@ -1753,10 +2449,14 @@ void bib_file::bib_output_one(std::ostream &outs, bibtex_entry &bt) {
   if (bt.key) outs << *bt.key;
   outs << "," << std::endl;
       
+  std::string stmp;
   for(size_t j=0;j<bt.fields.size();j++) {
 
     if (bt.fields[j].second.size()>0) {
 
+      // The field value with any macros expanded
+      const std::string &val=bibtex::expand(bt.fields[j].second,stmp);
+
       // Construct and output field string, including spaces to
       // make it 16 characters. This is the same as the default
       // emacs formatting.
@@ -1769,9 +2469,9 @@ void bib_file::bib_output_one(std::ostream &outs, bibtex_entry &bt) {
       if (bt.fields[j].first=="year") {
 	with_braces=false;
       }
-      if (bt.fields[j].second[0][0]=='{' &&
-	  bt.fields[j].second[0][bt.fields[j].second[0].size()-1]=='}' &&
-	  bt.fields[j].second[0].find('{',1)==std::string::npos) {
+      if (val[0]=='{' &&
+	  val[val.size()-1]=='}' &&
+	  val.find('{',1)==std::string::npos) {
 	with_braces=false;
       }
       // Don't surround purely numeric values with braces
@@ -1784,11 +2484,11 @@ void bib_file::bib_output_one(std::ostream &outs, bibtex_entry &bt) {
 	   bt.fields[j].first=="citations" ||
 	   bt.fields[j].first=="adscites" ||
 	   bt.fields[j].first=="number") &&
-	  bt.fields[j].second[0].size()>0 &&
-	  bt.fields[j].second[0][0]!='0') {
+	  val.size()>0 &&
+	  val[0]!='0') {
 	bool has_nonnum=false;
-	for(size_t i=0;i<bt.fields[j].second[0].size();i++) {
-	  if (!isdigit(bt.fields[j].second[0][i])) {
+	for(size_t i=0;i<val.size();i++) {
+	  if (!isdigit(val[i])) {
 	    has_nonnum=true;
 	  }
 	}
@@ -1801,15 +2501,15 @@ void bib_file::bib_output_one(std::ostream &outs, bibtex_entry &bt) {
       // comma, as necessary
       if (with_braces==false) {
 	if (j+1==bt.fields.size()) {
-	  outs << bt.fields[j].second[0] << std::endl;
+	  outs << val << std::endl;
 	} else {
-	  outs << bt.fields[j].second[0] << "," << std::endl;
+	  outs << val << "," << std::endl;
 	}
       } else {
 	if (j+1==bt.fields.size()) {
-	  outs << "{" << bt.fields[j].second[0] << "}" << std::endl;
+	  outs << "{" << val << "}" << std::endl;
 	} else {
-	  outs << "{" << bt.fields[j].second[0] << "}," << std::endl;
+	  outs << "{" << val << "}," << std::endl;
 	}
       }
     }
@@ -2171,7 +2871,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
       if (count_field_occur(bt_left,bt_left.fields[j].first)==1 &&
           count_field_occur(bt_right,bt_left.fields[j].first)==1) {
         
-        std::string comp_left=bt_left.fields[j].second[0];
+        std::string comp_left=bibtex::expand(bt_left.fields[j].second);
         thin_whitespace(comp_left);
         std::string comp_right=get_field(bt_right,bt_left.fields[j].first);
         thin_whitespace(comp_right);
@@ -2183,7 +2883,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
           outs.setf(ios::left);
           outs << bt_left.fields[j].first << " = {";
           outs.unsetf(ios::left);
-          outs << bt_left.fields[j].second[0] << "}," << endl;
+          outs << bibtex::expand(bt_left.fields[j].second) << "}," << endl;
         } else {
           outs << "  ";
           outs.width(13);
@@ -2191,7 +2891,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
           outs << bt_left.fields[j].first << " = {";
           outs.unsetf(ios::left);
           outs << ter.cyan_fg();
-          outs << bt_left.fields[j].second[0];
+          outs << bibtex::expand(bt_left.fields[j].second);
           outs << ter.default_fgbg();
           outs << "}," << endl;
         }
@@ -2224,7 +2924,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
         outs.setf(ios::left);
         outs << bt_right.fields[j].first << " = {";
         outs.unsetf(ios::left);
-        outs << bt_right.fields[j].second[0] << "}," << endl;
+        outs << bibtex::expand(bt_right.fields[j].second) << "}," << endl;
       } else {
         outs << "  ";
         outs.width(13);
@@ -2232,7 +2932,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
         outs << bt_right.fields[j].first << " = {";
         outs.unsetf(ios::left);
         outs << ter.cyan_fg();
-        outs << bt_right.fields[j].second[0];
+        outs << bibtex::expand(bt_right.fields[j].second);
         outs << ter.default_fgbg();
         outs << "}," << endl;
       }
@@ -2296,14 +2996,10 @@ void bib_file::bib_output_twoup(std::ostream &outs,
 	
 	// If the value in the field is not empty, construct the string
 	// stmpl from the value in the field
-	if (bt_left.fields[j].second.size()==1) {
+	if (bt_left.fields[j].second.size()>0) {
 	  format_field_value(bt_left.fields[j].first,
-			     bt_left.fields[j].second[0],stmpl);
+			     bibtex::expand(bt_left.fields[j].second),stmpl);
 	  thin_whitespace(stmpl);
-	} else if (bt_left.fields[j].second.size()>1) {
-	  O2SCL_ERR((((string)"Entry ")+*bt_left.key+
-		     " resulted in a value list "+
-		     "with more than one entry.").c_str(),o2scl::exc_esanity);
 	} else {
 	  stmpl="";
 	}
@@ -2370,7 +3066,7 @@ void bib_file::bib_output_twoup(std::ostream &outs,
 	
 	if (bt_right.fields[j].second.size()>0) {
 	  format_field_value(bt_right.fields[j].first,
-			     bt_right.fields[j].second[0],stmpr);
+			     bibtex::expand(bt_right.fields[j].second),stmpr);
 	}
 	
 	format_and_output(stmpl,stmpr,outs,false,sep2);
@@ -2409,7 +3105,7 @@ void bib_file::ident_or_addl_fields(bibtex_entry &bt_left,
       // If the values are not equal, then exit, indicating they
       // are different
       thin_whitespace(rx);
-      string rx2=bt_left.fields[j].second[0];
+      string rx2=bibtex::expand(bt_left.fields[j].second);
       thin_whitespace(rx2);
       if (rx2!=rx) {
 	result=ia_diff;
@@ -2439,6 +3135,7 @@ void bib_file::ident_or_addl_fields(bibtex_entry &bt_left,
 
 void bib_file::merge_to_left(bibtex_entry &bt_left,
 			     bibtex_entry &bt_right) {
+  invalidate_indexes();
 
   // Loop through all fields on the RHS
   for(size_t j=0;j<bt_right.fields.size();j++) {
@@ -2446,7 +3143,7 @@ void bib_file::merge_to_left(bibtex_entry &bt_left,
     // If this field not present on the LHS, then add it
     if (!is_field_present(bt_left,bt_right.fields[j].first)) {
       set_field_value(bt_left,bt_right.fields[j].first,
-		      bt_right.fields[j].second[0]);
+		      bibtex::expand(bt_right.fields[j].second));
     }
   }
 
@@ -2455,25 +3152,14 @@ void bib_file::merge_to_left(bibtex_entry &bt_left,
 
 int bib_file::possible_duplicate(bibtex_entry &bt,
 				 bibtex_entry &bt2) {
-  std::string lower_tag1=bt.tag, lower_tag2=bt2.tag;
-  std::string lower_key1=*bt.key, lower_key2=*bt2.key;
-  for (size_t k=0;k<lower_tag1.size();k++) {
-    lower_tag1[k]=std::tolower(lower_tag1[k]);
-  }
-  for (size_t k=0;k<lower_tag2.size();k++) {
-    lower_tag2[k]=std::tolower(lower_tag2[k]);
-  }
-  for (size_t k=0;k<lower_key1.size();k++) {
-    lower_key1[k]=std::tolower(lower_key1[k]);
-  }
-  for (size_t k=0;k<lower_key2.size();k++) {
-    lower_key2[k]=std::tolower(lower_key2[k]);
-  }
-  if (lower_tag1==lower_tag2 && lower_key1==lower_key2) {
+  // Tags are symbols, so comparing them ignoring case is a
+  // pointer comparison
+  bool same_tag=bt.tag.equal_folded(bt2.tag);
+  if (same_tag && bibtex::field_name_equal(*bt.key,*bt2.key)) {
     return 1;
   }
   // First, check to see if tag, journal, volume and first page all match
-  if (lower_tag1==lower_tag2 &&
+  if (same_tag &&
       is_field_present(bt,"volume") &&
       is_field_present(bt,"pages") &&
       is_field_present(bt2,"volume") &&
@@ -2485,7 +3171,10 @@ int bib_file::possible_duplicate(bibtex_entry &bt,
     if (is_field_present(bt,"journal") &&
 	is_field_present(bt2,"journal")) {
       std::string j1=bt.get_field("journal");
-      std::string j2=get_field(bt2,"journal");
+      std::string j2=bt2.get_field("journal");
+      if (j1==j2) {
+	return 2;
+      }
       // If we can, get the standard abbreviation for each
       if (journals.size()>0) {
 	find_abbrev(j1,j1);
@@ -2512,20 +3201,88 @@ void bib_file::list_possible_duplicates(bibtex_entry &bt,
   return;
 }
     
+void bib_file::find_duplicates(std::vector<std::pair<size_t,size_t> > &pairs,
+			       std::vector<int> &dup_vals) {
+  compact();
+  pairs.clear();
+  dup_vals.clear();
+
+  // Group the entries by two blocking keys: the tag and key ignoring
+  // case, and the tag, journal abbreviation, volume and first page.
+  // Any two entries for which possible_duplicate() is nonzero share
+  // one of these keys, so only the entries in a group are compared.
+  std::unordered_map<std::string,std::vector<size_t> > blocks;
+  std::unordered_map<std::string,std::string> abbrevs;
+  std::string bkey;
+  for(size_t i=0;i<entries.size();i++) {
+    bibtex_entry &bt=static_cast<bibtex_entry &>(entries[i]);
+    std::string tag=bt.tag.folded().str();
+    if (bt.key) {
+      bkey="k"+tag+'\0'+lower_string(*bt.key);
+      blocks[bkey].push_back(i);
+    }
+    if (is_field_present(bt,"volume") &&
+	is_field_present(bt,"pages") &&
+	is_field_present(bt,"journal")) {
+      // Look up each journal name in the journal list only once
+      std::string jour=bt.get_field("journal");
+      std::unordered_map<std::string,std::string>::iterator it=
+	abbrevs.find(jour);
+      if (it==abbrevs.end()) {
+	std::string abbrev=jour;
+	if (journals.size()>0) find_abbrev(jour,abbrev);
+	it=abbrevs.insert(std::make_pair(jour,abbrev)).first;
+      }
+      bkey="j"+tag+'\0'+it->second+'\0'+bt.get_field("volume")+'\0'+
+	first_page(bt.get_field("pages"));
+      blocks[bkey].push_back(i);
+    }
+  }
+
+  // All pairs within a group, in the order of the entries
+  for(std::unordered_map<std::string,std::vector<size_t> >::iterator
+	it=blocks.begin();it!=blocks.end();it++) {
+    const std::vector<size_t> &ix=it->second;
+    for(size_t k=0;k<ix.size();k++) {
+      for(size_t m=k+1;m<ix.size();m++) {
+	pairs.push_back(std::make_pair(ix[k],ix[m]));
+      }
+    }
+  }
+  std::sort(pairs.begin(),pairs.end());
+  pairs.erase(std::unique(pairs.begin(),pairs.end()),pairs.end());
+
+  // Keep the pairs which are possible duplicates
+  size_t n=0;
+  for(size_t k=0;k<pairs.size();k++) {
+    bibtex_entry &bt=static_cast<bibtex_entry &>(entries[pairs[k].first]);
+    bibtex_entry &bt2=static_cast<bibtex_entry &>
+      (entries[pairs[k].second]);
+    int dup_val=possible_duplicate(bt,bt2);
+    if (dup_val!=0) {
+      pairs[n++]=pairs[k];
+      dup_vals.push_back(dup_val);
+    }
+  }
+  pairs.resize(n);
+  
+  return;
+}
+
 void bib_file::text_output_one(std::ostream &outs, bibtex_entry &bt) {
   outs << "tag: " << bt.tag << std::endl;
   if (bt.key) outs << "key: " << *bt.key << std::endl;
   for(size_t j=0;j<bt.fields.size();j++) {
     outs << bt.fields[j].first << ": ";
     if (bt.fields[j].second.size()>0) {
-      outs << bt.fields[j].second[0] << std::endl;
+      outs << bibtex::expand(bt.fields[j].second) << std::endl;
     } else {
       outs << "(none)" << std::endl;
     }
     if (bt.fields[j].first==((std::string)"author")) {
       if (bt.fields[j].second.size()>0) {
 	outs << "author (reformat): " 
-	     << author_firstlast(bt.fields[j].second[0])
+	     << author_firstlast(bibtex::expand(bt.fields[j].second))
 	     << std::endl;
       }
     }
@@ -2534,15 +3291,24 @@ void bib_file::text_output_one(std::ostream &outs, bibtex_entry &bt) {
 }
     
 void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
+  compact();
+  invalidate_indexes();
 
   std::vector<bibtex::BibTeXEntry> entries2;
 
   // Main parse call
   if (verbose>1) std::cout << "Main parse call." << std::endl;
   wordexp_single_file(fname);
-  std::ifstream in(fname.c_str());
-  bibtex::read(in,entries2); 
-  in.close();
+  int ret;
+  {
+    bibtex::EntryArenaScope eas(arena.get());
+    ret=read_entries(fname,entries2);
+  }
+  if (ret!=0) {
+    std::cerr << "File open failed. Wrong filename?" << std::endl;
+    return;
+  }
+  define_macros(entries2);
   if (verbose>1) std::cout << "Done with main parse call." << std::endl;
 
   size_t n_orig=entries.size();
@@ -2572,11 +3338,11 @@ void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
         cout << "Not adding entry with key " << *bt.key
              << " because it is already present." << endl;
       } else {
-        entries.push_back(bt);
-	sort.insert(make_pair(*bt.key,entries.size()-1));
+	key_index.insert(*bt.key,entries.size());
         if (verbose>0 && bt.key) {
           cout << "Directly added entry " << *bt.key << endl;
         }
+        push_entry(bt);
         n_add++;
       }
       
@@ -2652,15 +3418,16 @@ void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
       
 	if (ch=='a' || ch=='A') {
 	  n_add++;
-	  entries.push_back(bt);
+	  bibtex::BibTeXEntry copy(bt);
+	  push_entry(copy);
 	
 	  if (!bt.key) {
 	    O2SCL_ERR("This class does not support keyless entries.",
 		      o2scl::exc_efailed);
 	  }
 	
-	  // Insert to the map for sorting
-	  sort.insert(make_pair(*bt.key,entries.size()-1));
+	  // Add to the key index
+	  key_index.insert(*bt.key,entries.size()-1);
 	
 	  if (verbose>1) {
 	    std::cout << "Entry " << i+1 << " of " << entries2.size();
@@ -2670,6 +3437,7 @@ void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
 	} else if (list.size()==1 && (ch=='>' || ch=='.')) {
 	  std::cout << "Replacing " << *(entries[list[0]].key)
 		    << " with " << *bt.key << std::endl;
+	  modify_entry(entries[list[0]]);
 	  entries[list[0]]=bt;
 	  n_mod++;
 	} else if (ch=='<' || ch==',') {
@@ -2723,7 +3491,7 @@ void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
     
     std::cout << "Read " << entries2.size() << " entries from file \""
 	      << fname << "\". Now " << entries.size() 
-	      << " total entries with " << sort.size()
+	      << " total entries with " << key_index.size()
 	      << " sortable entries." << std::endl;
   }
 
@@ -2731,32 +3499,187 @@ void bib_file::add_bib(std::string fname, bool prompt_duplicates) {
 }
 
 bool bib_file::is_key_present(std::string key) {
-  if (sort.find(key)==sort.end()) return false;
+  if (key_index.find(key)==bibtex::KeyIndex::npos) return false;
   return true;
 }
 
 bibtex_entry &bib_file::get_entry_by_key(std::string key) {
-  bibtex::BibTeXEntry &b=entries[sort.find(key)->second];
-  return static_cast<bibtex_entry &>(b);
-  
+  size_t ix=key_index.find(key);
+  if (ix==bibtex::KeyIndex::npos) {
+    O2SCL_ERR((((std::string)"Key ")+key+
+	       " not found in get_entry_by_key().").c_str(),
+	      o2scl::exc_einval);
+    return static_cast<bibtex_entry &>(entries[0]);
+  }
+  return static_cast<bibtex_entry &>(entries[ix]);
 }
 
 void bib_file::change_key(std::string key1, std::string key2) {
-  size_t ix=sort.find(key1)->second;
-  if (sort.find(key2)!=sort.end()) {
+  size_t ix=key_index.find(key1);
+  if (ix==bibtex::KeyIndex::npos) {
+    O2SCL_ERR("Key 1 not present in change_key().",
+	      o2scl::exc_einval);
+    return;
+  }
+  if (key_index.find(key2)!=bibtex::KeyIndex::npos) {
     O2SCL_ERR("Key 2 already present in change_key().",
 	      o2scl::exc_einval);
+    return;
+  }
+  // Rename the entry in place. The columns do not hold keys, so
+  // they remain valid, as do the views.
+  bool dups=(key_index.size()<entries.size());
+  modify_entry(entries[ix]);
+  *entries[ix].key=key2;
+  key_index.rename(key1,key2);
+
+  // If another entry has the old key, it is now the first one
+  if (dups) {
+    for(size_t i=ix+1;i<entries.size();i++) {
+      if (entries[i].key && *entries[i].key==key1) {
+	key_index.insert(key1,i);
+	break;
+      }
+    }
   }
-  bibtex::BibTeXEntry bt=entries[ix];      
-  entries.erase(entries.begin()+ix);
-  *bt.key=key2;
-  entries.push_back(bt);
-  refresh_sort();
   return;
 }
     
 size_t bib_file::get_index_by_key(std::string key) {
-  return sort.find(key)->second;
+  return key_index.find(key);
+}
+
+std::string bib_file::propose_key(bibtex_entry &bt) {
+
+  // Ensure title, year, and author are present
+  if (!is_field_present(bt,"title") ||
+      !is_field_present(bt,"year") ||
+      !is_field_present(bt,"author")) {
+    return "";
+  }
+
+  // Separate the title into words
+  std::string title=bt.get_field("title");
+  std::vector<std::string> title_words;
+  o2scl::split_string(title,title_words);
+  if (title.length()<=5 || title_words.size()<=1) return "";
+
+  std::string year=bt.get_field("year");
+  if (year.length()<2) return "";
+
+  // Start with the last name of the first author, removing
+  // non-alphabetic characters. Only the first author is parsed,
+  // since author lists can be long.
+  std::string auth=bt.get_field("author");
+  for(size_t j=1;j+4<auth.length();j++) {
+    if (std::isspace(auth[j-1]) && auth.compare(j,3,"and")==0 &&
+	std::isspace(auth[j+3])) {
+      auth.resize(j-1);
+      break;
+    }
+  }
+  std::vector<std::string> firstv, lastv;
+  parse_author(auth,firstv,lastv);
+  if (lastv.size()==0) return "";
+  std::string key;
+  for(size_t j=0;j<lastv[0].length();j++) {
+    if (std::isalpha(lastv[0][j])) key+=lastv[0][j];
+  }
+
+  // Add the year
+  key+=year.substr(2,2);
+
+  // Add the first characters of the first two title words which
+  // begin with alphabetic characters
+  int nadd=0;
+  for(size_t j=0;j<title_words.size() && nadd<2;j++) {
+    if (std::isalpha(title_words[j][0])) {
+      key+=(char)std::tolower(title_words[j][0]);
+      nadd++;
+    }
+  }
+  
+  return key;
+}
+
+size_t bib_file::auto_keys(std::vector<std::pair<std::string,
+			   std::string> > &changes) {
+  compact();
+  changes.clear();
+  
+  // Compute the proposed keys, splitting the view into one block
+  // of at least 1000 entries per thread
+  size_t n=view_size();
+  std::vector<std::string> prop(n);
+  size_t nt=1;
+  if (threads>1) {
+    nt=std::min((size_t)threads,(n+999)/1000);
+    if (nt<1) nt=1;
+  }
+  auto propose_range=[&](size_t k0, size_t k1) {
+    for(size_t k=k0;k<k1;k++) {
+      // Entries which cause an error keep their keys
+      try {
+	prop[k]=propose_key(view_entry(k));
+      } catch (...) {
+	prop[k].clear();
+      }
+    }
+  };
+  if (nt==1) {
+    propose_range(0,n);
+  } else {
+    // The macro expansions are cached when first used, so compute
+    // them here before the threads share them
+    for(size_t k=0;k<n;k++) {
+      bibtex::cache_expansions(view_entry(k));
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(nt);
+    for(size_t t=0;t<nt;t++) {
+      workers.push_back(std::thread(propose_range,n*t/nt,n*(t+1)/nt));
+    }
+    for(size_t t=0;t<nt;t++) {
+      workers[t].join();
+    }
+  }
+
+  // The keys of the entries which are not renamed are taken
+  std::vector<char> renamed(entries.size(),0);
+  for(size_t k=0;k<n;k++) {
+    if (prop[k].length()>0) renamed[view_index(k)]=1;
+  }
+  std::unordered_set<std::string> taken;
+  taken.reserve(entries.size());
+  for(size_t i=0;i<entries.size();i++) {
+    if (!renamed[i] && entries[i].key) taken.insert(*entries[i].key);
+  }
+
+  // Assign the keys in order, adding a suffix to resolve collisions
+  for(size_t k=0;k<n;k++) {
+    if (prop[k].length()==0) continue;
+    std::string key=prop[k];
+    for(size_t m=1;taken.find(key)!=taken.end();m++) {
+      if (m<26) {
+	key=prop[k]+((char)('a'+m));
+      } else {
+	key=prop[k]+o2scl::szttos(m+1);
+      }
+    }
+    taken.insert(key);
+    bibtex::BibTeXEntry &bt=entries[view_index(k)];
+    if (!bt.key || *bt.key!=key) {
+      changes.push_back(make_pair(bt.key ? *bt.key : "",key));
+      modify_entry(bt);
+      bt.key=key;
+    }
+  }
+
+  // The entries keep their positions, so the views and columns
+  // remain valid
+  if (changes.size()>0) key_index.rebuild(entries);
+  
+  return changes.size();
 }
 
 std::string bib_file::spec_char_to_latex(std::string s_in) {
@@ -2850,13 +3773,13 @@ void bib_file::parse_author(std::string s_in,
 
     // If a comma is found, assume "last, first and" notation
 	
-    std::istringstream *is=new std::istringstream(s_in.c_str());
+    std::istringstream is(s_in);
     std::string stmp;
-    while ((*is) >> stmp) {
+    while (is >> stmp) {
       std::string first, last=stmp;
       bool done=false;
       while (done==false && stmp[stmp.length()-1]!=',') {
-	if (!((*is) >> stmp)) {
+	if (!(is >> stmp)) {
 	  done=true;
 	} else {
 	  last+=((std::string)" ")+stmp;
@@ -2866,7 +3789,7 @@ void bib_file::parse_author(std::string s_in,
 	firstv.push_back("(none)");
 	lastv.push_back(last);
       } else {
-	while ((*is) >> stmp && stmp!=((std::string)"and")) {
+	while (is >> stmp && stmp!=((std::string)"and")) {
 	  if (first.length()==0) {
 	    first=stmp;
 	  } else {
@@ -2885,17 +3808,17 @@ void bib_file::parse_author(std::string s_in,
 
     // Assume "first last and" notation
 	
-    std::istringstream *is=new std::istringstream(s_in.c_str());
+    std::istringstream is(s_in);
     std::string stmp;
     std::string stmp2;
-    (*is) >> stmp;
+    is >> stmp;
     firstv.push_back("");
-    while ((*is) >> stmp2) {
+    while (is >> stmp2) {
       if (stmp2==(std::string)"and") {
 	lastv.push_back(stmp);
 	firstv.push_back("");
 	stmp=stmp2;
-	(*is) >> stmp2;
+	is >> stmp2;
       } else {
 	if (firstv[firstv.size()-1].length()>0) {
 	  firstv[firstv.size()-1]+=((std::string)" ")+stmp;
@@ -3004,121 +3927,68 @@ std::string bib_file::author_firstlast(std::string s_in,
   return s_in;
 }
     
-size_t bib_file::count_field_occur(bibtex_entry &bt, std::string field) {
+size_t bib_file::count_field_occur(bibtex_entry &bt,
+				  const std::string &field) {
   size_t cnt=0;
-  for(size_t j=0;j<bt.fields.size();j++) {
-    std::string lower=bt.fields[j].first;
-    for(size_t k=0;k<lower.size();k++) {
-      lower[k]=std::tolower(lower[k]);
-    }
-    for(size_t k=0;k<field.size();k++) {
-      field[k]=std::tolower(field[k]);
-    }
-    if (lower==field && bt.fields[j].second.size()>0) {
-      cnt++;
-    }
+  for(size_t j=bt.find_present(field);j!=bibtex::BibTeXEntry::npos;
+      j=bt.find_field(field,j+1)) {
+    if (bt.fields[j].second.size()>0) cnt++;
   }
   return cnt;
 }
 
-bool bib_file::is_field_present(bibtex_entry &bt, std::string field) {
-  for(size_t j=0;j<bt.fields.size();j++) {
-    std::string lower=bt.fields[j].first;
-    for(size_t k=0;k<lower.size();k++) {
-      lower[k]=std::tolower(lower[k]);
-    }
-    for(size_t k=0;k<field.size();k++) {
-      field[k]=std::tolower(field[k]);
-    }
-    if (lower==field && bt.fields[j].second.size()>0) {
-      return true;
-    }
-  } 
-  return false;
+bool bib_file::is_field_present(bibtex_entry &bt, const std::string &field) {
+  return bt.find_present(field)!=bibtex::BibTeXEntry::npos;
 }
 
-bool bib_file::is_field_present(bibtex_entry &bt, std::string field1,
-				std::string field2) {
-  for(size_t j=0;j<bt.fields.size();j++) {
-    std::string lower=bt.fields[j].first;
-    for(size_t k=0;k<lower.size();k++) {
-      lower[k]=std::tolower(lower[k]);
-    }
-    for(size_t k=0;k<field1.size();k++) {
-      field1[k]=std::tolower(field1[k]);
-    }
-    for(size_t k=0;k<field2.size();k++) {
-      field2[k]=std::tolower(field2[k]);
-    }
-    if ((lower==field1 || lower==field2) && bt.fields[j].second.size()>0) {
-      return true;
-    }
-  }
-  return false;
+bool bib_file::is_field_present(bibtex_entry &bt, const std::string &field1,
+				const std::string &field2) {
+  return bt.is_field_present_or(field1,field2);
 }
   
-std::string &bib_file::get_field(bibtex_entry &bt, std::string field) {
-  for(size_t j=0;j<bt.fields.size();j++) {
-    std::string lower=bt.fields[j].first;
-    for(size_t k=0;k<lower.size();k++) {
-      lower[k]=std::tolower(lower[k]);
-    }
-    for(size_t k=0;k<field.size();k++) {
-      field[k]=std::tolower(field[k]);
-    }
-    if (lower==field) {
-      if (bt.fields[j].second.size()==1) {
-	return bt.fields[j].second[0];
-      } else if (bt.fields[j].second.size()>1) {
-	O2SCL_ERR("Field had multiple entries.",
-		  o2scl::exc_esanity);
-      } else {
-	O2SCL_ERR("Field found but value vector was empty.",
-		  o2scl::exc_einval);
-      }
+std::string bib_file::get_field(bibtex_entry &bt,
+				const std::string &field) {
+  size_t j=bt.find_field(field);
+  if (j!=bibtex::BibTeXEntry::npos) {
+    if (bt.fields[j].second.size()>0) {
+      // The value is expanded into a copy, so that macro references
+      // and concatenations in the entry are kept
+      return bibtex::expand(bt.fields[j].second);
+    } else {
+      O2SCL_ERR("Field found but value vector was empty.",
+		o2scl::exc_einval);
     }
   }
   if (!bt.key) {
-    O2SCL_ERR((((std::string)"Field ")+field+
+    O2SCL_ERR((((std::string)"Field ")+lower_string(field)+
 	       " not found in entry with no key ").c_str(),
 	      o2scl::exc_einval);
     return trans_latex[0];
   }
-  O2SCL_ERR((((std::string)"Field ")+field+
+  O2SCL_ERR((((std::string)"Field ")+lower_string(field)+
 	     " not found in entry with key "+(*bt.key).c_str()).c_str(),
 	    o2scl::exc_einval);
   return trans_latex[0];
 }
  
-void bib_file::get_field_all(bibtex_entry &bt, std::string field,
+void bib_file::get_field_all(bibtex_entry &bt, const std::string &field,
 			     vector<string> &list) {
   list.clear();
-  for(size_t j=0;j<bt.fields.size();j++) {
-    std::string lower=bt.fields[j].first;
-    for(size_t k=0;k<lower.size();k++) {
-      lower[k]=std::tolower(lower[k]);
-    }
-    for(size_t k=0;k<field.size();k++) {
-      field[k]=std::tolower(field[k]);
-    }
-    if (lower==field) {
-      if (bt.fields[j].second.size()==1) {
-	list.push_back(bt.fields[j].second[0]);
-      } else if (bt.fields[j].second.size()>1) {
-	O2SCL_ERR("Field had multiple entries.",
-		  o2scl::exc_esanity);
-      }
+  for(size_t j=bt.find_present(field);j!=bibtex::BibTeXEntry::npos;
+      j=bt.find_field(field,j+1)) {
+    if (bt.fields[j].second.size()>0) {
+      list.push_back(bibtex::expand(bt.fields[j].second));
     }
   }
   if (!bt.key) {
-    O2SCL_ERR((((std::string)"Field ")+field+
+    O2SCL_ERR((((std::string)"Field ")+lower_string(field)+
 	       " not found in entry with no key ").c_str(),
 	      o2scl::exc_einval);
   }
   return;
 }
 
-std::vector<std::string> &bib_file::get_field_list
+bibtex::ValueVector &bib_file::get_field_list
 (bibtex_entry &bt, std::string field) {
   for(size_t j=0;j<bt.fields.size();j++) {
     if (bt.fields[j].first==field) {
@@ -3126,7 +3996,8 @@ std::vector<std::string> &bib_file::get_field_list
     }
   }
   O2SCL_ERR("Field not found.",o2scl::exc_einval);
-  return trans_latex;
+  static bibtex::ValueVector empty;
+  return empty;
 }
 
 void bib_file::tilde_to_space(std::string &s) {
@@ -3160,8 +4031,41 @@ void bib_file::output_latex(std::ostream &os, bibtex_entry &bt) {
 }
 
 void bib_file::add_entry(bibtex_entry &bt) {
-  entries.push_back(bt);
-  if (bt.key) sort.insert(make_pair(*bt.key,entries.size()-1));
+  compact();
+  invalidate_indexes();
+  bibtex::BibTeXEntry copy(bt);
+  push_entry(copy);
+  if (bt.key) key_index.insert(*bt.key,entries.size()-1);
+  return;
+}
+
+void bib_file::modify_entry(bibtex::BibTeXEntry &bt) {
+  std::less<const bibtex::BibTeXEntry *> lt;
+  if (entries.size()>0 && !lt(&bt,entries.data()) &&
+      lt(&bt,entries.data()+entries.size())) {
+    history.modify(entries,&bt-entries.data(),arena);
+  }
+  return;
+}
+
+void bib_file::push_entry(bibtex::BibTeXEntry &bt) {
+  std::vector<bibtex::BibTeXEntry> one;
+  one.push_back(std::move(bt));
+  history.splice(entries,entries.size(),0,one,arena);
+  return;
+}
+
+void bib_file::invalidate_indexes() {
+  columns.clear();
+  text_index.clear();
+  author_index.clear();
+  return;
+}
+
+void bib_file::invalidate_indexes(const std::vector<char> &keep) {
+  columns.select(keep,entries);
+  text_index.clear();
+  author_index.clear();
   return;
 }
 
@@ -34,6 +34,18 @@
 #include <boost/algorithm/string.hpp>
 
 #include <bt_reader.h>
+#include <bt_mapped_file.h>
+#include <bt_macro.h>
+#include <bt_cache.h>
+#include <bt_incremental.h>
+#include <bt_columns.h>
+#include <bt_arena.h>
+#include <bt_snapshot.h>
+#include <bt_key_index.h>
+#include <bt_query.h>
+#include <bt_expr.h>
+#include <bt_text_index.h>
+#include <bt_author_index.h>
 #include <map>
 
 #include <o2scl/err_hnd.h>
@@ -64,22 +76,28 @@ namespace btmanip {
     bibtex_entry() {
     }
 
+    /** \brief Return the index of the first field named \c field
+        (case-insensitive) which has a value, or \c npos
+    */
+    size_t find_present(const std::string &field) const;
+    
     /** \brief Get field named \c field (case-insensitive)
      */
-    std::string get_field(std::string field);
+    std::string get_field(const std::string &field);
       
     /** \brief Get field named \c field (case-insensitive)
      */
-    std::string &get_field_ref(std::string field);
+    std::string &get_field_ref(const std::string &field);
       
     /** \brief Return true if field \c field is present (case-insensitive)
      */
-    bool is_field_present(std::string field);
+    bool is_field_present(const std::string &field);
     
     /** \brief Return true if field \c field1 or field \c field2 is 
         present (case-insensitive)
     */
-    bool is_field_present_or(std::string field1, std::string field2);
+    bool is_field_present_or(const std::string &field1,
+                             const std::string &field2);
 
   };
   
@@ -151,6 +169,176 @@ namespace btmanip {
     typedef std::map<std::string,std::vector<std::string>,
                      std::greater<std::string> >::iterator journal_it;
 
+    /// \name Source of the entries read by \ref parse_bib()
+    //@{
+    /** \brief The file name, or empty if the entries cannot be
+	reloaded incrementally
+    */
+    std::string source_fname;
+    /** \brief The byte range and hash of each entry in the file,
+	including the \@string entries
+    */
+    bibtex::SourceMap source_map;
+    /** \brief For each span in \ref source_map, the index of the
+	entry in \ref entries, or <tt>std::string::npos</tt> for
+	an \@string entry
+    */
+    std::vector<size_t> source_entry;
+    /** \brief For each entry, the value of
+	<tt>bibtex::entry_hash()</tt> when it was read
+    */
+    std::vector<uint64_t> source_hash;
+    //@}
+
+    /** \brief Obtain the contents of file \c fname as the
+	buffer from \c first to \c last, stored in either \c mf
+	or \c buf depending on \ref use_mmap
+    */
+    int read_buffer(std::string fname, bibtex::MappedFile &mf,
+		    std::string &buf, const char *&first,
+		    const char *&last);
+
+    /** \brief Record the source of the entries just read by
+	\ref parse_bib() from the raw entries \c ents
+    */
+    void set_source(std::string fname,
+		    const std::vector<bibtex::BibTeXEntry> &ents);
+
+    /** \brief Update \ref entries from file \c fname by
+	re-parsing only the entries which changed since the last
+	call to \ref parse_bib(), returning false if the file must
+	be parsed again in full
+    */
+    bool reparse_bib(std::string fname);
+
+    /** \brief Warn if fields which should occur only once occur
+	twice in \c bt
+    */
+    void warn_repeated_fields(bibtex_entry &bt);
+
+    /** \brief Column-oriented copies of the fields scanned by
+	\ref search_or(), \ref search_and() and \ref remove_or()
+	when \ref use_columns is true
+
+	Functions which modify, reorder or add entries clear the
+	columns, and the searches filter them along with
+	\ref entries.
+    */
+    bibtex::ColumnStore columns;
+
+    /** \brief Inverted index of the words in the titles, abstracts
+	and authors, used by \ref find_text()
+
+	The index is built by \ref parse_bib() when \ref
+	use_text_index is true, and otherwise on the first call to
+	\ref find_text(). It is cleared along with \ref columns.
+    */
+    bibtex::TextIndex text_index;
+
+    /** \brief Index from the names of the authors to the entries,
+	used by \ref view_author()
+
+	The index is built on the first call to \ref view_author()
+	from the names given by \ref parse_author(), and is cleared
+	along with \ref columns.
+    */
+    bibtex::AuthorIndex author_index;
+
+    /** \brief The memory for the field lists of \ref entries
+
+	Entries read by \ref parse_bib(), \ref add_bib() and the
+	re-parse of a modified file allocate their fields from this
+	arena, so that \ref clear() and a new \ref parse_bib()
+	release them at once. After an assignment to this object
+	the previous arena is kept until then, since the assigned
+	entries may still use it. This must be declared before \ref
+	entries, so that it is destroyed after them.
+    */
+    bibtex::EntryArenaHandle arena;
+
+    /** \brief Compile the field and pattern pairs in \c args into a
+	query whose terms are combined according to \c mode
+    */
+    bibtex::Query make_query(std::vector<std::string> &args,
+			     bibtex::Query::Mode mode);
+
+    /** \brief Set <tt>match[i]</tt> to 1 for each entry \c i which
+	matches \c q and to 0 for the others, in one pass
+
+	If \c subset is not null, only the entries with the indexes
+	in \c subset are considered. The columns are used if \ref
+	use_columns is true.
+    */
+    void match_query(const bibtex::Query &q, std::vector<char> &match,
+		     const std::vector<size_t> *subset=0);
+
+    /** \brief Keep only the entries \c i with <tt>keep[i]</tt>
+	nonzero, in order, and return their number
+
+	The entries are moved in place in one pass. The columns are
+	filtered in the same way, the key index is rebuilt and the
+	views are removed.
+    */
+    size_t keep_entries(const std::vector<char> &keep);
+
+    /** \brief The stack of views created by \ref view_or() and
+	\ref view_and()
+
+	Each view is a list of indexes in \ref entries, in
+	increasing order, and is a subset of the view below it.
+	Functions which reorder or remove entries remove all views.
+    */
+    std::vector<std::vector<size_t> > views;
+
+    /** \brief The search which created each view in \ref views
+     */
+    std::vector<std::string> view_descs;
+
+    /** \brief Push the view \c ix described by \c desc, or
+	report that no entry matched if \c ix is empty
+    */
+    int push_view(std::vector<size_t> &ix, std::string desc);
+
+    /** \brief For each entry, nonzero if it was removed by
+	\ref remove_entry() since the last \ref compact()
+
+	This may be shorter than \ref entries if entries were added
+	since, and is all zero when \ref n_removed is zero.
+    */
+    std::vector<char> removed;
+
+    /** \brief The number of nonzero elements of \ref removed
+     */
+    size_t n_removed;
+
+    /** \brief The snapshots restored by \ref undo() and \ref redo()
+
+	Every change to \ref entries is made through this object, or
+	after a call to \ref modify_entry(), so that it can be
+	undone.
+    */
+    bibtex::SnapshotHistory history;
+
+    /** \brief Replace the views by those in snapshot \c s, leaving
+	the views of \c s empty, and rebuild the key index
+    */
+    void restore_snapshot(bibtex::Snapshot &s);
+
+    /** \brief Move \c bt to the end of \ref entries
+     */
+    void push_entry(bibtex::BibTeXEntry &bt);
+
+    /** \brief Clear \ref columns, \ref text_index and \ref
+	author_index after the entries are modified
+    */
+    void invalidate_indexes();
+
+    /** \brief Keep the columns of the entries for which \c keep is
+	nonzero, after the others are removed from \ref entries, and
+	clear \ref text_index and \ref author_index
+    */
+    void invalidate_indexes(const std::vector<char> &keep);
+
   public:
     
     /** \brief Output two entries in a tabular format
@@ -174,9 +362,13 @@ namespace btmanip {
      */
     std::vector<bibtex::BibTeXEntry> entries;
 
-    /** \brief A sorted list of keys and indexes
-     */
-    std::map<std::string,size_t,std::less<std::string> > sort;
+    /** \brief The index in \ref entries of the first entry with
+	each key
+
+	The keys in key order are given by
+	<tt>key_index.sorted()</tt>.
+    */
+    bibtex::KeyIndex key_index;
 
     /// \name Special character handling (default is <tt>sc_allow_all</tt>)
     //@{
@@ -233,6 +425,52 @@ namespace btmanip {
     /** \brief Verbosity parameter
      */
     int verbose;
+    /** \brief Number of threads used to parse .bib files, to
+	build \ref text_index and to compute keys in \ref
+	auto_keys() (default 1)
+    */
+    int threads;
+    /** \brief If true, memory-map .bib files rather than reading
+	them through a stream (default true)
+    */
+    bool use_mmap;
+    /** \brief If true, skip entries which cannot be parsed and
+	continue with the next entry, otherwise stop parsing at
+	the first such entry (default true)
+    */
+    bool skip_bad_entries;
+    /** \brief Entries which could not be parsed in the most recent
+	call to \ref parse_bib() or \ref add_bib()
+    */
+    std::vector<bibtex::ParseError> parse_errors;
+    /** \brief Use of the <tt>.btcache</tt> file stored next to
+	each .bib file: <tt>"off"</tt>, <tt>"read"</tt> or
+	<tt>"rw"</tt> (default <tt>"off"</tt>)
+
+	In <tt>"read"</tt> mode a cache file which matches the size,
+	modification time and contents of the .bib file is loaded
+	instead of parsing the file. In <tt>"rw"</tt> mode the cache
+	file is also rewritten whenever the .bib file has to be
+	parsed.
+    */
+    std::string cache;
+    /** \brief If true, \ref search_or(), \ref search_and() and
+	\ref remove_or() scan column-oriented copies of the fields
+	they match against (default false)
+
+	The columns are built on the first search of each field and
+	reused by later searches until the entries are modified.
+    */
+    bool use_columns;
+    /** \brief If true, \ref parse_bib() builds \ref text_index
+	for \ref find_text() (default false)
+
+	The index is built with \ref threads threads.
+    */
+    bool use_text_index;
+    /** \brief The \@string macros defined in the parsed files
+     */
+    bibtex::MacroTable macros;
 
     /** \brief Month names
      */
@@ -314,7 +552,7 @@ namespace btmanip {
     std::string first_page(std::string pages);
 
     /** \brief Search for a pattern, setting ``list`` equal
-	to the set of keys which match
+	to the set of keys in the current view which match
     */
     void search_keys(std::string pattern,
 		     std::vector<std::string> &list);
@@ -339,6 +577,236 @@ namespace btmanip {
 	an odd number, then the error handler is called.
     */
     void search_and(std::vector<std::string> &args);
+
+    /// \name Views of the entries
+    //@{
+    /** \brief Create a view of the entries in the current view
+	which match any of the field and pattern pairs in \c args,
+	and return the number of matching entries
+
+	The view is pushed on top of the current view, unless no
+	entry matches. The entries themselves are not modified. If
+	the number of arguments to this function is zero or an odd
+	number, then the error handler is called.
+    */
+    int view_or(std::vector<std::string> &args);
+
+    /** \brief Create a view of the entries in the current view
+	which match all of the field and pattern pairs in \c args,
+	and return the number of matching entries
+
+	The view is pushed on top of the current view, unless no
+	entry matches. The entries themselves are not modified. If
+	the number of arguments to this function is zero or an odd
+	number, then the error handler is called.
+    */
+    int view_and(std::vector<std::string> &args);
+
+    /** \brief Create a view of the entries in the current view
+	which match the expression \c expr, and return the number of
+	matching entries
+
+	See \ref bibtex::Expression for the syntax. The expression
+	is parsed once and then evaluated in a single pass over the
+	entries. The view is pushed on top of the current view,
+	unless no entry matches. If \c expr cannot be parsed, then
+	the error handler is called.
+    */
+    int view_expr(std::string expr);
+
+    /** \brief Create a view of the entries in the current view
+	which contain all of \c words, and set \c results to the
+	matching entries ranked by relevance
+
+	Each element of \c words which contains several words is
+	searched for as a phrase. The search ignores case and
+	accents, see \ref bibtex::TextIndex. Each element of \c
+	results is a score and the index of an entry, by decreasing
+	score. The view is pushed on top of the current view, unless
+	no entry matches, and the number of matching entries is
+	returned. If \c words is empty, then the error handler is
+	called.
+    */
+    int find_text(std::vector<std::string> &words,
+		  std::vector<std::pair<double,size_t> > &results);
+
+    /** \brief Create a view of the entries in the current view
+	with any of the authors in \c names, and return the number
+	of matching entries
+
+	Each name may be given as in an author field, e.g.
+	<tt>"M{\\"u}ller, J."</tt>, <tt>"J. Muller"</tt> or just
+	<tt>"Muller"</tt>. Case, accents and the von and Jr parts of
+	the names are ignored, and the initials match if those of one
+	name begin with those of the other, see \ref
+	bibtex::AuthorIndex. The index is built on the first call,
+	so that later calls do not scan the entries. The view is
+	pushed on top of the current view, unless no entry matches.
+	If \c names is empty or a name cannot be read, then the
+	error handler is called.
+    */
+    int view_author(std::vector<std::string> &names);
+
+    /** \brief Remove the current view, returning to the one below
+     */
+    void pop_view();
+
+    /** \brief Remove all views, returning to the full list of
+	entries
+    */
+    void reset_views();
+
+    /** \brief Remove the entries which are not in the current view
+	and then remove all views
+
+	This is what \ref search_or() and \ref search_and() do
+	directly, and is used before commands which modify the
+	entries.
+    */
+    void apply_view();
+
+    /** \brief The number of views on the stack
+     */
+    size_t n_views() {
+      return views.size();
+    }
+
+    /** \brief The search which created view \c k, counting from
+	the bottom of the stack
+    */
+    const std::string &view_desc(size_t k) {
+      return view_descs[k];
+    }
+
+    /** \brief The number of entries in view \c k, counting from
+	the bottom of the stack
+    */
+    size_t view_count(size_t k) {
+      return views[k].size();
+    }
+
+    /** \brief The number of entries in the current view, or in
+	\ref entries if there is no view
+    */
+    size_t view_size() {
+      if (views.size()==0) return entries.size();
+      return views.back().size();
+    }
+
+    /** \brief The index in \ref entries of entry \c i of the
+	current view
+    */
+    size_t view_index(size_t i) {
+      if (views.size()==0) return i;
+      return views.back()[i];
+    }
+
+    /** \brief Entry \c i of the current view
+     */
+    bibtex_entry &view_entry(size_t i) {
+      return static_cast<bibtex_entry &>(entries[view_index(i)]);
+    }
+    //@}
+
+    /// \name Removal of entries
+    //@{
+    /** \brief Mark entry \c i as removed, in constant time
+
+	The entry stays in \ref entries, so that the other entries
+	keep their indexes and \ref key_index, the views and lists
+	of indexes held by the caller remain valid. Only its key is
+	removed from \ref key_index. The removed entries are
+	deleted by \ref compact(), which must be called before the
+	entries are used otherwise. The functions which search,
+	reorder or add entries call it first.
+    */
+    void remove_entry(size_t i);
+
+    /** \brief Return true if entry \c i was removed by \ref
+	remove_entry() and \ref compact() has not been called since
+    */
+    bool is_removed(size_t i) {
+      return n_removed>0 && i<removed.size() && removed[i];
+    }
+
+    /** \brief Delete the entries removed by \ref remove_entry() in
+	one pass, keeping the others in order
+
+	The indexes in \ref key_index, the views and the columns
+	are updated to the new positions, and views which are left
+	empty are kept.
+    */
+    void compact();
+    //@}
+
+    /// \name Snapshots of the entries
+    //@{
+    /** \brief The maximum number of snapshots kept for \ref undo()
+	and for \ref redo() (default 20)
+    */
+    int undo_levels;
+
+    /** \brief Save the entries and the views so that \ref undo()
+	can restore them, describing the change which follows by
+	\c desc
+
+	The entries are not copied. Instead, each entry is copied
+	when it is first modified after the snapshot, and entries
+	which are removed are kept. This removes the snapshots which
+	\ref redo() could restore.
+    */
+    void snapshot(std::string desc);
+
+    /** \brief Record entry \c bt for \ref undo() before it is
+	modified in place
+
+	This must be called before an entry in \ref entries is
+	modified other than by the functions of this class. Other
+	entries are ignored.
+    */
+    void modify_entry(bibtex::BibTeXEntry &bt);
+
+    /** \brief Restore the entries and the views saved by the last
+	\ref snapshot(), returning false if there is none
+    */
+    bool undo();
+
+    /** \brief Restore the entries and the views as they were
+	before the last \ref undo(), returning false if there is
+	nothing to redo
+    */
+    bool redo();
+
+    /** \brief The number of snapshots which \ref undo() can restore
+     */
+    size_t n_undo() {
+      return history.undo_size();
+    }
+
+    /** \brief The number of snapshots which \ref redo() can restore
+     */
+    size_t n_redo() {
+      return history.redo_size();
+    }
+
+    /** \brief The change which \ref undo() would revert
+     */
+    const std::string &undo_desc() {
+      return history.undo_top().desc;
+    }
+
+    /** \brief The change which \ref redo() would repeat
+     */
+    const std::string &redo_desc() {
+      return history.redo_top().desc;
+    }
+
+    /** \brief Remove all snapshots
+     */
+    void clear_history() {
+      history.clear();
+    }
+    //@}
     
     /** \brief Check entry for required fields
      */
@@ -377,19 +845,79 @@ namespace btmanip {
     int set_field_value(std::string key, std::string field,
 			std::string value);
     
+    /** \brief Read all entries in file \c fname and append them
+	to \c ents without any additional processing
+
+	If \ref use_mmap is true, the file is memory-mapped and the
+	parser runs directly over the mapped bytes, otherwise it is
+	first read into memory through an <tt>std::ifstream</tt>.
+	Entries which cannot be parsed are recorded in \ref
+	parse_errors and reported to <tt>std::cerr</tt>, and \ref
+	skip_bad_entries determines whether parsing continues after
+	them. This function returns 0 on success and
+	<tt>o2scl::exc_efilenotfound</tt> if the file could not be
+	opened, in which case \c ents is unchanged.
+
+	The parse is read from or written to a cache file as
+	specified by \ref cache. If \c sort_index is not null, it is
+	set to the cached result of <tt>bibtex::sort_index()</tt>
+	when the cache is used and cleared otherwise. If \c smap is
+	not null, it is set to the source map of the entries when
+	the file is parsed without errors and cleared otherwise.
+    */
+    int read_entries(std::string fname,
+		     std::vector<bibtex::BibTeXEntry> &ents,
+		     std::vector<size_t> *sort_index=0,
+		     bibtex::SourceMap *smap=0);
+
+    /** \brief Move the \@string entries in \c ents into \ref
+	macros and link the macro references in the remaining
+	entries
+
+	Fields keep their unexpanded, <tt>'#'</tt>-separated
+	components. The value of a field which refers to macros is
+	expanded when it is needed, and the expansion of each macro
+	is computed only once. This function returns the number of
+	macros defined.
+    */
+    size_t define_macros(std::vector<bibtex::BibTeXEntry> &ents);
+    
     /** \brief Parse a BibTeX file and perform some extra reformatting
-     */
+
+	The byte range and hash of each entry in the file are
+	recorded. If the same file is parsed again and \ref entries
+	have not been modified in the meantime, only the entries
+	whose bytes changed are parsed, and \ref entries and \ref
+	key_index are updated in place. The keys of the entries which
+	were added, removed or modified are then stored in \ref
+	keys_added, \ref keys_removed and \ref keys_modified.
+    */
     void parse_bib(std::string fname);
+
+    /** \brief Remove all entries and release the memory of the
+	fields of those read from files at once
+
+	The snapshots for \ref undo() are kept, see \ref
+	clear_history().
+    */
+    void clear();
+
+    /// \name Changes found by the last incremental \ref parse_bib()
+    //@{
+    std::vector<std::string> keys_added;
+    std::vector<std::string> keys_removed;
+    std::vector<std::string> keys_modified;
+    //@}
     
-    /** \brief Refresh the \ref sort object which contains a set
-	of keys an indexes for the \ref entries array
+    /** \brief Rebuild \ref key_index from \ref entries
     */
     void refresh_sort();
     
     /** \brief Sort the bibliography by key
 
-	Because the indexes for a sorted list are always maintained in
-	\ref sort, this is a \f${\cal O}(N)\f$ operation.
+	The order of the keys is computed by \ref key_index when
+	it is first needed after a change, and read from the cache
+	when the entries were loaded from one.
 
 	\note This will call the error handler if more than one
 	entry has the same key
@@ -426,6 +954,21 @@ namespace btmanip {
     void list_possible_duplicates(bibtex_entry &bt,
 				  std::vector<size_t> &list);
 
+    /** \brief Find the pairs of entries which are possible
+	duplicates
+
+	Each element of \c pairs holds the indexes of two entries,
+	the first one smaller, for which \ref possible_duplicate()
+	returns the nonzero value in the same element of \c
+	dup_vals. The pairs are in the order of the entries. Rather
+	than comparing all pairs, the entries are grouped by hashes
+	of their tag and key and of their tag, journal, volume and
+	first page, and only entries in the same group are compared,
+	so the time is nearly linear in the number of entries.
+    */
+    void find_duplicates(std::vector<std::pair<size_t,size_t> > &pairs,
+			 std::vector<int> &dup_vals);
+
     /** \brief Output one entry \c bt to stream \c outs in 
 	plain text
     */
@@ -436,19 +979,52 @@ namespace btmanip {
     */
     void add_bib(std::string fname, bool prompt_duplicates=true);
     
-    /** \brief Get entry by key name
+    /** \brief Return true if an entry has key \c key
      */
     bool is_key_present(std::string key);
 
     /** \brief Get entry by key name
+
+	If no entry has key \c key, the error handler is called.
      */
     bibtex_entry &get_entry_by_key(std::string key);
 
     /** \brief Change an entry's key
+
+	The entry keeps its position, so this takes constant time
+	and the views and columns remain valid. If \c key1 is not
+	present or \c key2 is, the error handler is called.
      */
     void change_key(std::string key1, std::string key2);    
 
-    /** \brief Get index of entry by key name
+    /** \brief Return a key for \c bt made of the last name of the
+	first author, a two-digit year, and the first letters of the
+	first two title words which begin with a letter
+
+	An empty string is returned if \c bt has no author, year or
+	title, or if the title is too short.
+    */
+    std::string propose_key(bibtex_entry &bt);
+
+    /** \brief Set the keys of the entries in the current view to
+	those given by \ref propose_key() and return the number
+	of keys changed
+
+	The keys are computed in parallel using \ref threads
+	threads. If a proposed key is used by an entry outside the
+	view, or was given to an earlier entry in the view, the
+	letters "b", "c", ... (and then numbers) are appended until
+	the key is unused. Entries for which no key can be proposed
+	keep their keys. The keys are then changed at once and
+	\ref key_index is rebuilt once. The old and new keys of the
+	entries whose keys changed are stored in \c changes, in the
+	order of the entries.
+    */
+    size_t auto_keys(std::vector<std::pair<std::string,
+		     std::string> > &changes);
+
+    /** \brief Get index of entry by key name, or
+	<tt>bibtex::KeyIndex::npos</tt> if no entry has key \c key
      */
     size_t get_index_by_key(std::string key);
     
@@ -510,32 +1086,36 @@ namespace btmanip {
 	differences in field name capitalization) is present in entry
 	\c bt
     */
-    bool is_field_present(bibtex_entry &bt, std::string field);
+    bool is_field_present(bibtex_entry &bt, const std::string &field);
 
     /** \brief Count the number of times that field \c field occurs
 	in the entry
     */
-    size_t count_field_occur(bibtex_entry &bt, std::string field);
+    size_t count_field_occur(bibtex_entry &bt, const std::string &field);
     
     /** \brief Return true if field named \c field1 or field named \c
 	field2 is present in entry \c bt
     */
-    bool is_field_present(bibtex_entry &bt, std::string field1,
-			  std::string field2);
+    bool is_field_present(bibtex_entry &bt, const std::string &field1,
+			  const std::string &field2);
     
     /** \brief Get field named \c field from entry \c bt (assuming
 	the field occurs only once)
+
+	The value is returned with its macros and <tt>#</tt>
+	concatenations expanded, without modifying the entry. Use
+	\ref bibtex_entry::get_field_ref() to modify a value.
     */
-    std::string &get_field(bibtex_entry &bt, std::string field);
+    std::string get_field(bibtex_entry &bt, const std::string &field);
     
     /** \brief Get all values for field named \c field from entry \c bt
      */
-    void get_field_all(bibtex_entry &bt, std::string field,
+    void get_field_all(bibtex_entry &bt, const std::string &field,
                        std::vector<std::string> &list);
     
     /** \brief Get field named \c field from entry \c bt
      */
-    std::vector<std::string> &get_field_list
+    bibtex::ValueVector &get_field_list
     (bibtex_entry &bt, std::string field);
 
     /** \brief Convert tildes to spaces
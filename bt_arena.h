@@ -0,0 +1,283 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_arena.h
+    \brief Arena allocation for the fields of a list of entries
+*/
+#ifndef BT_ARENA_H
+#define BT_ARENA_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "bt_entry.h"
+
+namespace bibtex {
+
+/**
+ * @brief Memory for the field lists of a list of entries, returned
+ *        to the heap all at once when the arena is destroyed.
+ *
+ * A monotonic resource which hands out consecutive pieces of large
+ * chunks and ignores deallocation.  It suits the field lists of
+ * parsed entries, which are allocated once with their final size
+ * and then rarely change.  A list which grows later leaves its old
+ * block unused until the arena is destroyed.
+ *
+ * Unlike @c std::pmr::monotonic_buffer_resource, the chunks do not
+ * grow, which bounds the space left unused in the last one, and
+ * the arena is thread-safe, so that it can be used by the parallel
+ * reader.  It must outlive every list allocated from it.
+ */
+class EntryArena : public std::pmr::memory_resource
+{
+public:
+
+    /// Size of each chunk in bytes.
+    static constexpr std::size_t chunk_size = 256 * 1024;
+
+    EntryArena()
+        : next_(0), left_(0), bytes_(0)
+    {
+    }
+
+    EntryArena(const EntryArena&) = delete;
+    EntryArena& operator=(const EntryArena&) = delete;
+
+    /// @brief Number of bytes handed out.
+    std::size_t bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    /// @brief Number of chunks taken from the heap.
+    std::size_t chunks() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return chunks_.size();
+    }
+
+private:
+
+    void* do_allocate(std::size_t n, std::size_t align) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes_ += n;
+        void* p = next_;
+        std::size_t space = left_;
+        if (std::align(align, n, p, space)) {
+            next_ = static_cast<char*>(p) + n;
+            left_ = space - n;
+            return p;
+        }
+        // Large blocks get a chunk of their own, so that the rest of
+        // the current chunk is not wasted
+        if (n + align > chunk_size / 4) {
+            space = n + align;
+            chunks_.push_back(std::unique_ptr<char[]>(new char[space]));
+            p = chunks_.back().get();
+            return std::align(align, n, p, space);
+        }
+        chunks_.push_back(std::unique_ptr<char[]>(new char[chunk_size]));
+        p = chunks_.back().get();
+        space = chunk_size;
+        std::align(align, n, p, space);
+        next_ = static_cast<char*>(p) + n;
+        left_ = space - n;
+        return p;
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override
+    {
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other)
+        const noexcept override
+    {
+        return this == &other;
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<char[]> > chunks_;
+    char* next_;
+    std::size_t left_;
+    std::size_t bytes_;
+};
+
+/**
+ * @brief Allocate the fields of the entries created in the scope
+ *        from @p arena.
+ *
+ * This sets entry_resource() to the arena.  Within the scope, the
+ * default memory resource is a pool which holds the lists the
+ * parser builds before copying them to the entries with their
+ * final size, and which is released at the end of the scope.
+ * Lists which are not the fields of an entry must therefore not be
+ * created in the scope and kept beyond it.  Both settings are
+ * global and apply to all threads.
+ */
+class EntryArenaScope
+{
+public:
+
+    explicit EntryArenaScope(EntryArena& arena)
+        : scratch_(std::pmr::new_delete_resource()),
+          old_default_(std::pmr::set_default_resource(&scratch_)),
+          old_entry_(set_entry_resource(&arena))
+    {
+    }
+
+    ~EntryArenaScope()
+    {
+        set_entry_resource(old_entry_);
+        std::pmr::set_default_resource(old_default_);
+    }
+
+    EntryArenaScope(const EntryArenaScope&) = delete;
+    EntryArenaScope& operator=(const EntryArenaScope&) = delete;
+
+private:
+
+    std::pmr::synchronized_pool_resource scratch_;
+    std::pmr::memory_resource* old_default_;
+    std::pmr::memory_resource* old_entry_;
+};
+
+/**
+ * @brief The arena of a list of entries, shared by its copies.
+ *
+ * Assigning to a handle makes it share the arena of the other
+ * handle, but keeps its previous arena alive, since the entries of
+ * a list which is assigned to keep their memory.  The owner of the
+ * list calls reset() once it has removed all entries, to release
+ * the arenas no longer in use.
+ */
+class EntryArenaHandle
+{
+public:
+
+    EntryArenaHandle()
+    {
+    }
+
+    EntryArenaHandle(const EntryArenaHandle& h)
+        : arena_(h.arena_)
+    {
+    }
+
+    EntryArenaHandle(EntryArenaHandle&& h) noexcept
+        : arena_(std::move(h.arena_)), retired_(std::move(h.retired_))
+    {
+    }
+
+    EntryArenaHandle& operator=(const EntryArenaHandle& h)
+    {
+        if (this != &h) {
+            retire();
+            arena_ = h.arena_;
+        }
+        return *this;
+    }
+
+    EntryArenaHandle& operator=(EntryArenaHandle&& h) noexcept
+    {
+        if (this != &h) {
+            retire();
+            arena_ = std::move(h.arena_);
+            for (std::size_t i = 0; i < h.retired_.size(); ++i) {
+                retired_.push_back(std::move(h.retired_[i]));
+            }
+            h.retired_.clear();
+        }
+        return *this;
+    }
+
+    /// @brief The current arena, creating it if necessary.
+    EntryArena& get()
+    {
+        if (!arena_) {
+            arena_ = std::make_shared<EntryArena>();
+        }
+        return *arena_;
+    }
+
+    /// @brief Use @p a, and release all other arenas.
+    void reset(std::shared_ptr<EntryArena> a = std::shared_ptr<EntryArena>())
+    {
+        arena_ = std::move(a);
+        retired_.clear();
+    }
+
+    /**
+     * @brief Also keep the arenas of @p h until the next reset(),
+     *        for entries moved from a list which uses them.
+     */
+    void share(const EntryArenaHandle& h)
+    {
+        keep(h.arena_);
+        for (std::size_t i = 0; i < h.retired_.size(); ++i) {
+            keep(h.retired_[i]);
+        }
+    }
+
+    /// @brief Number of bytes handed out by the current arena.
+    std::size_t bytes() const
+    {
+        return arena_ ? arena_->bytes() : 0;
+    }
+
+private:
+
+    /// @brief Keep the current arena until the next reset().
+    void retire()
+    {
+        if (arena_) {
+            retired_.push_back(std::move(arena_));
+        }
+    }
+
+    /// @brief Keep @p a until the next reset(), if it is not kept.
+    void keep(const std::shared_ptr<EntryArena>& a)
+    {
+        if (!a || a == arena_
+            || std::find(retired_.begin(), retired_.end(), a)
+               != retired_.end()) {
+            return;
+        }
+        retired_.push_back(a);
+    }
+
+    std::shared_ptr<EntryArena> arena_;
+    std::vector<std::shared_ptr<EntryArena> > retired_;
+};
+
+} // namespace bibtex
+
+#endif // BT_ARENA_H
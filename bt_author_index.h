@@ -0,0 +1,375 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_author_index.h
+    \brief Index from author names to the entries of a list
+*/
+#ifndef BT_AUTHOR_INDEX_H
+#define BT_AUTHOR_INDEX_H
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_entry.h"
+#include "bt_macro.h"
+#include "bt_text_index.h"
+
+namespace bibtex {
+
+/**
+ * @brief Index from the normalized names of the authors of a list of
+ *        entries to the entries.
+ *
+ * Each name is reduced to a last name and a string of initials by
+ * normalize(): the von part (e.g. "van der") and the Jr part are
+ * dropped, and the letters are folded to lower case without accents
+ * as in for_each_word(), so that <tt>M{\\"u}ller, J.</tt>,
+ * <tt>J. Müller</tt> and <tt>Muller, Johann</tt> all give @c muller
+ * with initials @c j.  A lookup gives the entries with an author
+ * of that last name whose initials agree with the ones asked for,
+ * i.e. one string of initials is a prefix of the other, so that
+ * "J." finds "J. M." and the reverse.
+ *
+ * The index does not split names into first and last parts itself:
+ * build() takes a function which does, so that the index follows
+ * bib_file::parse_author().  Like TextIndex it records the address
+ * and length of the entry list it was built from, and the owner
+ * must call clear() after modifying entries in place.
+ */
+class AuthorIndex
+{
+public:
+
+    AuthorIndex()
+        : data_(0), size_(0), built_(false)
+    {
+    }
+
+    /// @brief Remove the index.
+    void clear()
+    {
+        names_.clear();
+        data_ = 0;
+        size_ = 0;
+        built_ = false;
+    }
+
+    /// @brief True if the index was built from @p ents.
+    bool current(const std::vector<BibTeXEntry>& ents) const
+    {
+        return built_ && ents.data() == data_ && ents.size() == size_;
+    }
+
+    /// @brief Number of distinct last names.
+    std::size_t size() const
+    {
+        return names_.size();
+    }
+
+    /**
+     * @brief Split the value of an author field into the names of
+     *        the authors.
+     *
+     * The names are separated by the word "and" outside braces,
+     * and the name "others" of <tt>and others</tt> is dropped.
+     */
+    static void split_names(const std::string& in,
+                            std::vector<std::string>& names)
+    {
+        names.clear();
+        std::string cur, word;
+        int depth = 0;
+        auto end_word = [&]() {
+            if (word.empty()) {
+                return;
+            }
+            if (word.size() == 3 && std::tolower(word[0]) == 'a'
+                && std::tolower(word[1]) == 'n'
+                && std::tolower(word[2]) == 'd') {
+                if (!cur.empty()) {
+                    names.push_back(cur);
+                }
+                cur.clear();
+            } else {
+                if (!cur.empty()) {
+                    cur += ' ';
+                }
+                cur += word;
+            }
+            word.clear();
+        };
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            char c = in[i];
+            if (c == '{') {
+                ++depth;
+            } else if (c == '}' && depth > 0) {
+                --depth;
+            }
+            if (depth == 0 && std::isspace(static_cast<unsigned char>(c))) {
+                end_word();
+            } else {
+                word += c;
+            }
+        }
+        end_word();
+        if (!cur.empty() && cur != "others") {
+            names.push_back(cur);
+        }
+    }
+
+    /**
+     * @brief Reduce a name split into @p first and @p last parts to
+     *        a last name @p key and initials @p initials, returning
+     *        false if no last name is left.
+     *
+     * A Jr part after a second comma at the start of @p first
+     * (<tt>von Last, Jr, First</tt>) or making up all of @p last
+     * (<tt>First Last Jr.</tt>) is dropped, as are the words
+     * beginning with a lower-case letter at the start of @p last or
+     * at the end of @p first, which make up the von part.
+     */
+    static bool normalize(std::string first, std::string last,
+                          std::string& key, std::string& initials)
+    {
+        key.clear();
+        initials.clear();
+        if (first == "(none)") {
+            first.clear();
+        }
+        std::size_t comma = first.rfind(',');
+        if (comma != std::string::npos) {
+            first = first.substr(comma + 1);
+        }
+        std::vector<std::string> fw = split_words(first);
+        std::vector<std::string> lw = split_words(last);
+        if (lw.size() == 1 && !fw.empty() && is_suffix(lw[0])) {
+            lw[0] = fw.back();
+            fw.pop_back();
+        }
+        while (lw.size() > 1 && starts_lower(lw[0])) {
+            lw.erase(lw.begin());
+        }
+        while (!fw.empty() && starts_lower(fw.back())) {
+            fw.pop_back();
+        }
+        for (std::size_t k = 0; k < lw.size(); ++k) {
+            for_each_word(lw[k], [&key](const std::string& w) {
+                key += w;
+            });
+        }
+        for (std::size_t k = 0; k < fw.size(); ++k) {
+            for_each_word(fw[k], [&initials](const std::string& w) {
+                initials += w[0];
+            });
+        }
+        return !key.empty();
+    }
+
+    /**
+     * @brief Reduce the name @p name to a last name @p key and
+     *        initials @p initials as in normalize(), where
+     *        <tt>split(name, firstv, lastv)</tt> appends the first and
+     *        last parts of @p name to @p firstv and @p lastv,
+     *        returning false if this fails.
+     *
+     * A name without a comma in which braces hold spaces, such as
+     * <tt>{LIGO Collaboration}</tt> or <tt>A. {Van Leeuwen}</tt>, is
+     * split at its last space outside braces instead.
+     */
+    template<class Split>
+    static bool normalize_name(const std::string& name, Split split,
+                               std::string& key, std::string& initials)
+    {
+        std::vector<std::string> words = split_words(name);
+        std::size_t n_spaces = 0;
+        for (std::size_t i = 0; i < name.size(); ++i) {
+            if (std::isspace(static_cast<unsigned char>(name[i]))
+                && (i == 0 || !std::isspace(
+                        static_cast<unsigned char>(name[i - 1])))) {
+                ++n_spaces;
+            }
+        }
+        if (name.find(',') == std::string::npos
+            && n_spaces >= words.size() && !words.empty()) {
+            std::string first;
+            for (std::size_t k = 0; k + 1 < words.size(); ++k) {
+                first += (k > 0 ? " " : "") + words[k];
+            }
+            return normalize(first, words.back(), key, initials);
+        }
+        std::vector<std::string> firstv, lastv;
+        split(name, firstv, lastv);
+        if (firstv.size() != 1 || lastv.size() != 1) {
+            return false;
+        }
+        return normalize(firstv[0], lastv[0], key, initials);
+    }
+
+    /**
+     * @brief Index the author fields of @p ents, where
+     *        <tt>split(name, firstv, lastv)</tt> appends the first and
+     *        last parts of @p name to @p firstv and @p lastv.
+     */
+    template<class Split>
+    void build(const std::vector<BibTeXEntry>& ents, Split split)
+    {
+        clear();
+        std::vector<std::string> names;
+        std::string scratch, key, initials;
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            const BibTeXEntry& e = ents[i];
+            for (std::size_t j = e.find_field("author");
+                 j != BibTeXEntry::npos;
+                 j = e.find_field("author", j + 1)) {
+                split_names(expand(e.fields[j].second, scratch), names);
+                for (std::size_t k = 0; k < names.size(); ++k) {
+                    if (!normalize_name(names[k], split, key, initials)) {
+                        continue;
+                    }
+                    std::vector<Posting>& list = names_[key];
+                    // Authors named twice in one entry are kept once
+                    if (list.empty() || list.back().entry != i
+                        || list.back().initials != initials) {
+                        Posting p;
+                        p.initials = initials;
+                        p.entry = static_cast<std::uint32_t>(i);
+                        list.push_back(p);
+                    }
+                }
+            }
+        }
+        data_ = ents.data();
+        size_ = ents.size();
+        built_ = true;
+    }
+
+    /**
+     * @brief Append to @p out the entries with an author with last
+     *        name @p key whose initials agree with @p initials, both
+     *        as given by normalize(), in increasing order.
+     *
+     * The entries found for one name are in increasing order, but
+     * @p out is not sorted when several names are looked up.
+     */
+    void find(const std::string& key, const std::string& initials,
+              std::vector<std::size_t>& out) const
+    {
+        std::unordered_map<std::string, std::vector<Posting> >::
+            const_iterator it = names_.find(key);
+        if (it == names_.end()) {
+            return;
+        }
+        const std::vector<Posting>& list = it->second;
+        for (std::size_t k = 0; k < list.size(); ++k) {
+            const std::string& ini = list[k].initials;
+            std::size_t n = std::min(ini.size(), initials.size());
+            if (ini.compare(0, n, initials, 0, n) == 0
+                && (out.empty() || out.back() != list[k].entry)) {
+                out.push_back(list[k].entry);
+            }
+        }
+    }
+
+private:
+
+    /// An author of an entry.
+    struct Posting
+    {
+        std::string initials;
+        std::uint32_t entry;
+    };
+
+    /// Split @p s at spaces outside braces.
+    static std::vector<std::string> split_words(const std::string& s)
+    {
+        std::vector<std::string> words;
+        std::string w;
+        int depth = 0;
+        for (std::size_t i = 0; i < s.size(); ++i) {
+            char c = s[i];
+            if (c == '{') {
+                ++depth;
+            } else if (c == '}' && depth > 0) {
+                --depth;
+            }
+            if (depth == 0 && std::isspace(static_cast<unsigned char>(c))) {
+                if (!w.empty()) {
+                    words.push_back(w);
+                }
+                w.clear();
+            } else {
+                w += c;
+            }
+        }
+        if (!w.empty()) {
+            words.push_back(w);
+        }
+        return words;
+    }
+
+    /**
+     * True if @p w begins with a lower-case letter.  A word which
+     * begins with a brace, such as <tt>{van}</tt>, does not, which
+     * differs from BibTeX but keeps braced last names whole.
+     */
+    static bool starts_lower(const std::string& w)
+    {
+        if (w.empty() || w[0] == '{') {
+            return false;
+        }
+        return std::islower(static_cast<unsigned char>(w[0])) != 0;
+    }
+
+    /// True if @p w is a Jr part such as "Jr." or "III".
+    static bool is_suffix(const std::string& w)
+    {
+        if (w.size() > 5) {
+            return false;
+        }
+        std::string f;
+        for_each_word(w, [&f](const std::string& x) {
+            f += x;
+        });
+        return f == "jr" || f == "sr" || f == "ii" || f == "iii"
+            || f == "iv";
+    }
+
+    /// The entries of each last name, in increasing order.
+    std::unordered_map<std::string, std::vector<Posting> > names_;
+    /// Address of the entry list the index was built from.
+    const BibTeXEntry* data_;
+    /// Length of the entry list the index was built from.
+    std::size_t size_;
+    /// True if build() was called since clear().
+    bool built_;
+};
+
+} // namespace bibtex
+
+#endif // BT_AUTHOR_INDEX_H
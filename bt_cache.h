@@ -0,0 +1,403 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_cache.h
+    \brief Binary parse cache files stored next to .bib files
+*/
+#ifndef BT_CACHE_H
+#define BT_CACHE_H
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "bt_reader.h"
+#include "bt_mapped_file.h"
+
+namespace bibtex {
+
+/**
+ * @brief The properties of a .bib file which a cache must match.
+ */
+struct CacheStamp
+{
+    CacheStamp()
+        : size(0), mtime_sec(0), mtime_nsec(0), hash(0), flags(0)
+    {
+    }
+
+    /// File size in bytes.
+    std::uint64_t size;
+    /// Modification time, seconds.
+    std::int64_t mtime_sec;
+    /// Modification time, nanoseconds.
+    std::int64_t mtime_nsec;
+    /// content_hash() of the file.
+    std::uint64_t hash;
+    /// Parser options which affect the cached result.
+    std::uint32_t flags;
+};
+
+/**
+ * @brief Fill the size and modification time of @p stamp from file
+ *        @p fname.
+ *
+ * @return @c false if the file could not be examined.
+ */
+inline bool stat_file(const std::string& fname, CacheStamp& stamp)
+{
+    struct stat st;
+    if (::stat(fname.c_str(), &st) != 0) {
+        return false;
+    }
+    stamp.size = static_cast<std::uint64_t>(st.st_size);
+    stamp.mtime_sec = static_cast<std::int64_t>(st.st_mtime);
+#if defined(__APPLE__)
+    stamp.mtime_nsec = static_cast<std::int64_t>(st.st_mtimespec.tv_nsec);
+#else
+    stamp.mtime_nsec = static_cast<std::int64_t>(st.st_mtim.tv_nsec);
+#endif
+    return true;
+}
+
+/**
+ * @brief Return the name of the cache file for @p fname.
+ *
+ * A trailing <tt>.bib</tt> is replaced by <tt>.btcache</tt>, any
+ * other name has <tt>.btcache</tt> appended.
+ */
+inline std::string cache_file_name(const std::string& fname)
+{
+    if (fname.size() > 4
+        && fname.compare(fname.size() - 4, 4, ".bib") == 0) {
+        return fname.substr(0, fname.size() - 4) + ".btcache";
+    }
+    return fname + ".btcache";
+}
+
+/**
+ * @brief Return the positions, in key order, of the first entry with
+ *        each key among the entries of @p ents which are not
+ *        @c \@string definitions.
+ *
+ * Positions count only the entries which remain after the
+ * @c \@string entries are removed, which is the index stored in
+ * the @c sort map of a bib_file.
+ */
+inline std::vector<std::size_t>
+sort_index(const std::vector<BibTeXEntry>& ents)
+{
+    std::map<std::string, std::size_t> m;
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < ents.size(); ++i) {
+        const std::string& tag = ents[i].tag;
+        if (tag.size() == 6) {
+            std::string t(tag);
+            for (std::size_t j = 0; j < t.size(); ++j) {
+                t[j] = static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(t[j])));
+            }
+            if (t == "string") {
+                continue;
+            }
+        }
+        if (ents[i].key) {
+            m.insert(std::make_pair(*ents[i].key, n));
+        }
+        ++n;
+    }
+    std::vector<std::size_t> ix;
+    ix.reserve(m.size());
+    for (std::map<std::string, std::size_t>::const_iterator it = m.begin();
+         it != m.end(); ++it) {
+        ix.push_back(it->second);
+    }
+    return ix;
+}
+
+namespace detail {
+
+/// Identifies a cache file and its layout.
+const char cacheMagic[8] = { 'B', 'T', 'C', 'A', 'C', 'H', 'E', '1' };
+
+/// Marks the byte order and word sizes of the writer.
+const std::uint32_t cacheByteOrder = 0x01020304;
+
+/**
+ * @brief Appends fixed-width integers and length-prefixed strings to
+ *        a buffer.
+ */
+struct CacheWriter
+{
+    std::string buf;
+
+    template <typename T>
+    void put(T v)
+    {
+        buf.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void put(const std::string& s)
+    {
+        put(static_cast<std::uint32_t>(s.size()));
+        buf.append(s);
+    }
+};
+
+/**
+ * @brief Reads back what CacheWriter wrote, failing instead of
+ *        reading past the end of the input.
+ */
+struct CacheReader
+{
+    CacheReader(const char* f, const char* l)
+        : p(f), last(l), ok(true)
+    {
+    }
+
+    const char* p;
+    const char* last;
+    bool ok;
+
+    template <typename T>
+    T get()
+    {
+        T v = T();
+        if (ok && static_cast<std::size_t>(last - p) >= sizeof(T)) {
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+        } else {
+            ok = false;
+        }
+        return v;
+    }
+
+    void get(std::string& s)
+    {
+        std::uint32_t n = get<std::uint32_t>();
+        if (ok && static_cast<std::size_t>(last - p) >= n) {
+            s.assign(p, n);
+            p += n;
+        } else {
+            ok = false;
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Write the parse of a .bib file to cache file @p cname.
+ *
+ * The file holds @p stamp, @p ents exactly as they were parsed
+ * (including @c \@string entries and the unexpanded components of
+ * every field), the parse errors @p errors and the index @p sort
+ * computed by sort_index().  It is first written under a temporary
+ * name and then renamed, so a reader never sees a partial file.
+ *
+ * @return @c false if the file could not be written.
+ */
+inline bool write_cache(const std::string& cname, const CacheStamp& stamp,
+                        const std::vector<BibTeXEntry>& ents,
+                        const std::vector<ParseError>& errors,
+                        const std::vector<std::size_t>& sort)
+{
+    detail::CacheWriter w;
+    w.buf.append(detail::cacheMagic, sizeof(detail::cacheMagic));
+    w.put(detail::cacheByteOrder);
+    w.put(stamp.flags);
+    w.put(stamp.size);
+    w.put(stamp.mtime_sec);
+    w.put(stamp.mtime_nsec);
+    w.put(stamp.hash);
+
+    w.put(static_cast<std::uint64_t>(ents.size()));
+    for (std::size_t i = 0; i < ents.size(); ++i) {
+        const BibTeXEntry& e = ents[i];
+        w.put(e.tag.str());
+        w.put(static_cast<std::uint8_t>(e.key ? 1 : 0));
+        if (e.key) {
+            w.put(*e.key);
+        }
+        w.put(static_cast<std::uint32_t>(e.fields.size()));
+        for (std::size_t j = 0; j < e.fields.size(); ++j) {
+            w.put(e.fields[j].first.str());
+            const ValueVector& vals = e.fields[j].second;
+            w.put(static_cast<std::uint32_t>(vals.size()));
+            for (std::size_t k = 0; k < vals.size(); ++k) {
+                w.put(static_cast<std::uint8_t>(vals[k].bare ? 1 : 0));
+                w.put(vals[k].text());
+            }
+        }
+    }
+
+    w.put(static_cast<std::uint64_t>(errors.size()));
+    for (std::size_t i = 0; i < errors.size(); ++i) {
+        w.put(static_cast<std::uint64_t>(errors[i].offset));
+        w.put(static_cast<std::uint64_t>(errors[i].line));
+        w.put(static_cast<std::uint64_t>(errors[i].column));
+        w.put(errors[i].text);
+    }
+
+    w.put(static_cast<std::uint64_t>(sort.size()));
+    for (std::size_t i = 0; i < sort.size(); ++i) {
+        w.put(static_cast<std::uint64_t>(sort[i]));
+    }
+
+    std::string tmp = cname + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(w.buf.data(), static_cast<std::streamsize>(w.buf.size()));
+        if (!out) {
+            out.close();
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), cname.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Read cache file @p cname if it matches @p stamp.
+ *
+ * The cache is mapped into memory and decoded directly.  On success
+ * the cached entries are appended to @p ents, and @p errors and
+ * @p sort are replaced.  If the file is missing, damaged, or was
+ * written for a different size, modification time, content hash or
+ * set of parser options, nothing is modified.
+ *
+ * @return @c true if the cache was used.
+ */
+inline bool read_cache(const std::string& cname, const CacheStamp& stamp,
+                       std::vector<BibTeXEntry>& ents,
+                       std::vector<ParseError>& errors,
+                       std::vector<std::size_t>& sort)
+{
+    MappedFile mf(cname);
+    if (!mf.is_open()) {
+        return false;
+    }
+    detail::CacheReader r(mf.begin(), mf.end());
+    std::uint64_t magic;
+    std::memcpy(&magic, detail::cacheMagic, sizeof(magic));
+    if (r.get<std::uint64_t>() != magic
+        || r.get<std::uint32_t>() != detail::cacheByteOrder
+        || r.get<std::uint32_t>() != stamp.flags
+        || r.get<std::uint64_t>() != stamp.size
+        || r.get<std::int64_t>() != stamp.mtime_sec
+        || r.get<std::int64_t>() != stamp.mtime_nsec
+        || r.get<std::uint64_t>() != stamp.hash || !r.ok) {
+        return false;
+    }
+
+    std::vector<BibTeXEntry> ents2;
+    std::uint64_t n = r.get<std::uint64_t>();
+    // Every entry takes at least nine bytes, so a damaged count
+    // cannot trigger a huge allocation
+    if (n > static_cast<std::uint64_t>(r.last - r.p) / 9) {
+        return false;
+    }
+    ents2.resize(static_cast<std::size_t>(n));
+    for (std::size_t i = 0; r.ok && i < ents2.size(); ++i) {
+        BibTeXEntry& e = ents2[i];
+        std::string tag;
+        r.get(tag);
+        e.tag = tag;
+        if (r.get<std::uint8_t>() != 0) {
+            std::string key;
+            r.get(key);
+            e.key = key;
+        }
+        std::uint32_t nf = r.get<std::uint32_t>();
+        for (std::uint32_t j = 0; r.ok && j < nf; ++j) {
+            e.fields.push_back(KeyValue());
+            KeyValue& kv = e.fields.back();
+            std::string name;
+            r.get(name);
+            kv.first = name;
+            std::uint32_t nv = r.get<std::uint32_t>();
+            for (std::uint32_t k = 0; r.ok && k < nv; ++k) {
+                bool bare = r.get<std::uint8_t>() != 0;
+                std::string s;
+                r.get(s);
+                kv.second.push_back(Value(std::move(s), bare));
+            }
+        }
+    }
+
+    std::vector<ParseError> errors2;
+    std::uint64_t ne = r.get<std::uint64_t>();
+    for (std::uint64_t i = 0; r.ok && i < ne; ++i) {
+        ParseError pe;
+        pe.offset = static_cast<std::size_t>(r.get<std::uint64_t>());
+        pe.line = static_cast<std::size_t>(r.get<std::uint64_t>());
+        pe.column = static_cast<std::size_t>(r.get<std::uint64_t>());
+        r.get(pe.text);
+        errors2.push_back(pe);
+    }
+
+    std::vector<std::size_t> sort2;
+    std::uint64_t ns = r.get<std::uint64_t>();
+    if (ns > n) {
+        return false;
+    }
+    sort2.reserve(static_cast<std::size_t>(ns));
+    for (std::uint64_t i = 0; r.ok && i < ns; ++i) {
+        std::uint64_t ix = r.get<std::uint64_t>();
+        if (ix >= n) {
+            return false;
+        }
+        sort2.push_back(static_cast<std::size_t>(ix));
+    }
+    if (!r.ok || r.p != r.last) {
+        return false;
+    }
+
+    ents.reserve(ents.size() + ents2.size());
+    for (std::size_t i = 0; i < ents2.size(); ++i) {
+        ents.push_back(std::move(ents2[i]));
+    }
+    errors.swap(errors2);
+    sort.swap(sort2);
+    return true;
+}
+
+} // namespace bibtex
+
+#endif // BT_CACHE_H
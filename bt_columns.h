@@ -0,0 +1,277 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_columns.h
+    \brief Column-oriented copies of single fields of a list of entries
+*/
+#ifndef BT_COLUMNS_H
+#define BT_COLUMNS_H
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bt_entry.h"
+#include "bt_macro.h"
+
+namespace bibtex {
+
+/**
+ * @brief Column-oriented copies of some fields of a list of entries.
+ *
+ * Each column holds, for every entry, the offset of the expanded
+ * value of one field in a character buffer shared by all columns.
+ * Values are terminated by a null character, so that they can be
+ * passed directly to C string functions like @c fnmatch().  A scan
+ * over one field then reads two contiguous arrays rather than every
+ * entry and its fields.
+ *
+ * Numeric columns hold the leading number of the first value of
+ * one field, parsed once with to_number(), e.g. for comparisons of
+ * years or citation counts.
+ *
+ * Columns are built on first use.  The store records the address
+ * and length of the entry list it was built from and starts again
+ * when either changes, but modifying, adding, removing or
+ * reordering entries in place is not detected: the owner must call
+ * clear() (or select() when entries are filtered) after doing so.
+ */
+class ColumnStore
+{
+public:
+
+    /// Offset of a missing value.
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    /// @brief One field of every entry.
+    struct Column
+    {
+        /**
+         * @brief Offset of the value of the first field of each
+         *        entry with this name which has a value, or @ref npos.
+         */
+        std::vector<std::size_t> offset;
+        /// Entries with more than one field of this name, in order.
+        std::vector<std::size_t> repeated;
+    };
+
+    ColumnStore()
+        : data_(0), size_(0)
+    {
+    }
+
+    /// @brief Remove all columns.
+    void clear()
+    {
+        columns_.clear();
+        numbers_.clear();
+        text_.clear();
+        data_ = 0;
+        size_ = 0;
+    }
+
+    /// @brief Number of columns currently stored.
+    std::size_t size() const
+    {
+        return columns_.size() + numbers_.size();
+    }
+
+    /// @brief Return the value at offset @p off of a column.
+    const char* text(std::size_t off) const
+    {
+        return text_.data() + off;
+    }
+
+    /**
+     * @brief Return the column for field @p name (ignoring case) of
+     *        @p ents, building it if necessary.
+     */
+    const Column& column(const std::string& name,
+                         const std::vector<BibTeXEntry>& ents)
+    {
+        if (ents.data() != data_ || ents.size() != size_) {
+            clear();
+            data_ = ents.data();
+            size_ = ents.size();
+        }
+        Symbol key = Symbol(name).folded();
+        std::map<Symbol, Column>::iterator it = columns_.find(key);
+        if (it != columns_.end()) {
+            return it->second;
+        }
+        Column& c = columns_[key];
+        c.offset.resize(ents.size(), npos);
+        std::string scratch;
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            const BibTeXEntry& e = ents[i];
+            for (std::size_t j = e.find_field(name);
+                 j != BibTeXEntry::npos; j = e.find_field(name, j + 1)) {
+                if (e.fields[j].second.empty()) {
+                    continue;
+                }
+                if (c.offset[i] != npos) {
+                    c.repeated.push_back(i);
+                    break;
+                }
+                c.offset[i] = text_.size();
+                text_ += expand(e.fields[j].second, scratch);
+                text_ += '\0';
+            }
+        }
+        return c;
+    }
+
+    /**
+     * @brief Return the numeric column for field @p name (ignoring
+     *        case) of @p ents, building it if necessary.
+     *
+     * The value is not-a-number for entries without the field or
+     * whose value does not begin with a number.
+     */
+    const std::vector<double>& numbers(const std::string& name,
+                                       const std::vector<BibTeXEntry>& ents)
+    {
+        if (ents.data() != data_ || ents.size() != size_) {
+            clear();
+            data_ = ents.data();
+            size_ = ents.size();
+        }
+        Symbol key = Symbol(name).folded();
+        std::map<Symbol, std::vector<double> >::iterator it =
+            numbers_.find(key);
+        if (it != numbers_.end()) {
+            return it->second;
+        }
+        std::vector<double>& c = numbers_[key];
+        c.resize(ents.size(), std::numeric_limits<double>::quiet_NaN());
+        std::string scratch;
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            std::size_t j = ents[i].find_field(name);
+            if (j != BibTeXEntry::npos) {
+                c[i] = to_number(expand(ents[i].fields[j].second, scratch));
+            }
+        }
+        return c;
+    }
+
+    /**
+     * @brief The number at the beginning of @p s, after spaces and
+     *        braces, or not-a-number.
+     *
+     * The number is an optional sign, digits and an optional
+     * fraction, so that e.g. <tt>2015a</tt> gives 2015.
+     */
+    static double to_number(const std::string& s)
+    {
+        std::size_t i = 0;
+        while (i < s.size() && (s[i] == ' ' || s[i] == '{' || s[i] == '\t'
+                                || s[i] == '\n')) {
+            ++i;
+        }
+        bool neg = false;
+        if (i < s.size() && (s[i] == '-' || s[i] == '+')) {
+            neg = (s[i] == '-');
+            ++i;
+        }
+        double x = 0.0;
+        bool digits = false;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+            x = x * 10.0 + (s[i] - '0');
+            digits = true;
+        }
+        if (i < s.size() && s[i] == '.') {
+            double f = 0.1;
+            for (++i; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+                x += f * (s[i] - '0');
+                f *= 0.1;
+                digits = true;
+            }
+        }
+        if (!digits) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return neg ? -x : x;
+    }
+
+    /**
+     * @brief Keep the rows @c i with @p keep[i] nonzero, after the
+     *        entries have been filtered in the same way to give
+     *        @p ents.
+     */
+    void select(const std::vector<char>& keep,
+                const std::vector<BibTeXEntry>& ents)
+    {
+        for (std::map<Symbol, Column>::iterator it = columns_.begin();
+             it != columns_.end(); ++it) {
+            Column& c = it->second;
+            std::size_t n = 0, r = 0;
+            std::vector<std::size_t> repeated;
+            for (std::size_t i = 0; i < c.offset.size(); ++i) {
+                while (r < c.repeated.size() && c.repeated[r] < i) {
+                    ++r;
+                }
+                if (keep[i]) {
+                    if (r < c.repeated.size() && c.repeated[r] == i) {
+                        repeated.push_back(n);
+                    }
+                    c.offset[n++] = c.offset[i];
+                }
+            }
+            c.offset.resize(n);
+            c.repeated.swap(repeated);
+        }
+        for (std::map<Symbol, std::vector<double> >::iterator it =
+                 numbers_.begin(); it != numbers_.end(); ++it) {
+            std::vector<double>& c = it->second;
+            std::size_t n = 0;
+            for (std::size_t i = 0; i < c.size(); ++i) {
+                if (keep[i]) {
+                    c[n++] = c[i];
+                }
+            }
+            c.resize(n);
+        }
+        data_ = ents.data();
+        size_ = ents.size();
+    }
+
+private:
+
+    /// The values of all columns.
+    std::string text_;
+    /// The columns, keyed by lower-case field name.
+    std::map<Symbol, Column> columns_;
+    /// The numeric columns, keyed by lower-case field name.
+    std::map<Symbol, std::vector<double> > numbers_;
+    /// Address of the entry list the columns were built from.
+    const BibTeXEntry* data_;
+    /// Length of the entry list the columns were built from.
+    std::size_t size_;
+};
+
+} // namespace bibtex
+
+#endif // BT_COLUMNS_H
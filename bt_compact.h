@@ -0,0 +1,647 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_compact.h
+    \brief A compact, string_view based representation of parsed
+    BibTeX entries
+*/
+#ifndef BT_COMPACT_H
+#define BT_COMPACT_H
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bt_reader.h"
+#include "bt_mapped_file.h"
+
+namespace bibtex {
+
+//------------------------------------------------------------------
+// StringArena
+//------------------------------------------------------------------
+
+/**
+ * @brief Append-only storage for strings which cannot point into
+ *        the source buffer.
+ *
+ * Strings are copied into large blocks and released all at once by
+ * clear() or the destructor.  Views returned by copy() stay valid
+ * until then.
+ */
+class StringArena
+{
+public:
+    StringArena()
+        : cur_(0), left_(0), bytes_(0)
+    {
+    }
+
+    /// @brief Copy @p s into the arena and return a view of the copy.
+    std::string_view copy(std::string_view s)
+    {
+        if (s.empty()) {
+            return std::string_view();
+        }
+        if (s.size() > left_) {
+            std::size_t n = s.size() > block_size / 4
+                ? s.size() : block_size;
+            blocks_.push_back(std::unique_ptr<char[]>(new char[n]));
+            if (n == block_size) {
+                cur_ = blocks_.back().get();
+                left_ = n;
+            } else {
+                // Oversized strings get a block of their own
+                std::memcpy(blocks_.back().get(), s.data(), s.size());
+                bytes_ += s.size();
+                return std::string_view(blocks_.back().get(),
+                                        s.size());
+            }
+        }
+        std::memcpy(cur_, s.data(), s.size());
+        std::string_view ret(cur_, s.size());
+        cur_ += s.size();
+        left_ -= s.size();
+        bytes_ += s.size();
+        return ret;
+    }
+
+    /// @brief Release all strings.
+    void clear()
+    {
+        blocks_.clear();
+        cur_ = 0;
+        left_ = 0;
+        bytes_ = 0;
+    }
+
+    /// @brief Number of string bytes held by the arena.
+    std::size_t bytes() const
+    {
+        return bytes_;
+    }
+
+private:
+    static const std::size_t block_size = 65536;
+
+    std::vector<std::unique_ptr<char[]> > blocks_;
+    char* cur_;
+    std::size_t left_;
+    std::size_t bytes_;
+};
+
+//------------------------------------------------------------------
+// CompactEntry
+//------------------------------------------------------------------
+
+/**
+ * @brief A field of a CompactEntry: a name and a run of values in
+ *        CompactEntry::values.
+ */
+struct CompactField
+{
+    /// Field name, e.g. @c author.
+    std::string_view name;
+    /// Index of the first value in CompactEntry::values.
+    std::uint32_t first;
+    /// Number of @c '#'-concatenated values.
+    std::uint32_t count;
+};
+
+/**
+ * @brief A BibTeX entry whose strings are views into the source
+ *        buffer or into the StringArena of the owning
+ *        CompactBibliography.
+ *
+ * An entry holds two vectors regardless of its number of fields,
+ * instead of the several allocations per field of a BibTeXEntry.
+ */
+class CompactEntry
+{
+public:
+    CompactEntry()
+        : has_key(false)
+    {
+    }
+
+    /// Entry type tag, e.g. @c article or @c book.
+    std::string_view tag;
+    /// Citation key, valid if @ref has_key is true.
+    std::string_view key;
+    /// False for @c \@string, @c \@comment etc.
+    bool has_key;
+    /// Ordered list of fields.
+    std::vector<CompactField> fields;
+    /// Values of all fields, in order.
+    std::vector<std::string_view> values;
+
+    /**
+     * @brief Return the index of field @p name (case-insensitive),
+     *        or @c npos if it is not present.
+     */
+    std::size_t find_field(std::string_view name) const
+    {
+        for (std::size_t j = 0; j < fields.size(); ++j) {
+            std::string_view f = fields[j].name;
+            if (f.size() != name.size()) {
+                continue;
+            }
+            std::size_t k = 0;
+            while (k < f.size()
+                   && std::tolower(static_cast<unsigned char>(f[k]))
+                   == std::tolower(static_cast<unsigned char>(name[k]))) {
+                ++k;
+            }
+            if (k == f.size()) {
+                return j;
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * @brief Return the first value of field @p j, or an empty view
+     *        if the field has no values.
+     */
+    std::string_view value(std::size_t j) const
+    {
+        return fields[j].count > 0 ? values[fields[j].first]
+                                   : std::string_view();
+    }
+
+    /// @brief Make an owning copy of this entry.
+    BibTeXEntry to_entry() const
+    {
+        BibTeXEntry e;
+        e.tag = Symbol(tag.data(), tag.size());
+        if (has_key) {
+            e.key = std::string(key.data(), key.size());
+        }
+        e.fields.resize(fields.size());
+        for (std::size_t j = 0; j < fields.size(); ++j) {
+            const CompactField& f = fields[j];
+            e.fields[j].first = Symbol(f.name.data(), f.name.size());
+            e.fields[j].second.reserve(f.count);
+            for (std::uint32_t k = 0; k < f.count; ++k) {
+                std::string_view v = values[f.first + k];
+                e.fields[j].second.push_back(
+                    std::string(v.data(), v.size()));
+            }
+        }
+        return e;
+    }
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+};
+
+//------------------------------------------------------------------
+// Grammar producing CompactEntry objects
+//
+// The rules below recognise exactly the same language as the rules
+// of bt_reader.h, but they have no attributes.  Semantic actions
+// record the raw text of each component as a view into the source
+// buffer.  Only values which the original grammar would transform
+// (escaped braces or quotes, or bare values containing whitespace
+// or comments removed by the skipper) are decoded with the original
+// detail::value rule and copied into the arena.
+//------------------------------------------------------------------
+
+namespace detail {
+
+/// @brief State shared by the compact semantic actions.
+struct CompactBuilder
+{
+    std::vector<CompactEntry>* entries;
+    StringArena* arena;
+    CompactEntry cur;
+    std::string_view name;
+    std::uint32_t first;
+};
+
+struct CompactBuilderId {};
+
+inline std::string_view rawView(
+    boost::iterator_range<const char*> const& r)
+{
+    return std::string_view(r.begin(),
+                            static_cast<std::size_t>(r.size()));
+}
+
+/// @brief Decode a value with the original grammar into the arena.
+inline std::string_view decodeValue(CompactBuilder& b,
+                                    std::string_view raw)
+{
+    Value v;
+    const char* it = raw.data();
+    x3::phrase_parse(it, raw.data() + raw.size(), value,
+                     bibtex::space, v);
+    return b.arena->copy(v.text());
+}
+
+/// @brief Start a new entry.
+struct CompactReset
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        b.cur.tag = std::string_view();
+        b.cur.key = std::string_view();
+        b.cur.has_key = false;
+        b.cur.fields.clear();
+        b.cur.values.clear();
+    }
+};
+
+/// @brief Clear the key and fields before parsing a body.
+struct CompactResetBody
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        b.cur.key = std::string_view();
+        b.cur.fields.clear();
+        b.cur.values.clear();
+    }
+};
+
+/// @brief Generic entries always have a (possibly empty) key.
+struct CompactHasKey
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        x3::get<CompactBuilderId>(ctx).cur.has_key = true;
+    }
+};
+
+struct CompactTag
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        x3::get<CompactBuilderId>(ctx).cur.tag = rawView(x3::_attr(ctx));
+    }
+};
+
+struct CompactKey
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        x3::get<CompactBuilderId>(ctx).cur.key = rawView(x3::_attr(ctx));
+    }
+};
+
+/// @brief Begin a field with the parsed name.
+struct CompactFieldName
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        b.name = rawView(x3::_attr(ctx));
+        b.first = static_cast<std::uint32_t>(b.cur.values.size());
+    }
+};
+
+/// @brief Begin the single unnamed field of a simple entry.
+struct CompactNoName
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        b.name = std::string_view();
+        b.first = static_cast<std::uint32_t>(b.cur.values.size());
+    }
+};
+
+/// @brief Finish the current field.
+struct CompactField_
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        CompactField f;
+        f.name = b.name;
+        f.first = b.first;
+        f.count = static_cast<std::uint32_t>(b.cur.values.size())
+            - b.first;
+        b.cur.fields.push_back(f);
+    }
+};
+
+/// @brief Record a quoted or brace-delimited value.
+struct CompactQuoted
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        std::string_view raw = rawView(x3::_attr(ctx));
+        if (raw.find('\\') != std::string_view::npos) {
+            b.cur.values.push_back(decodeValue(b, raw));
+        } else {
+            b.cur.values.push_back(raw.substr(1, raw.size() - 2));
+        }
+    }
+};
+
+/// @brief Record a bare value.
+struct CompactBare
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        std::string_view raw = rawView(x3::_attr(ctx));
+        bool plain = true;
+        for (std::size_t i = 0; i < raw.size() && plain; ++i) {
+            char c = raw[i];
+            plain = !(c == '%' || std::isspace(
+                          static_cast<unsigned char>(c)));
+        }
+        b.cur.values.push_back(plain ? raw : decodeValue(b, raw));
+    }
+};
+
+/// @brief Append the finished entry.
+struct CompactPush
+{
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        CompactBuilder& b = x3::get<CompactBuilderId>(ctx);
+        b.entries->push_back(std::move(b.cur));
+        b.cur = CompactEntry();
+    }
+};
+
+struct CEscapedTextId    {};
+struct CQuoteTextId      {};
+struct CInnerBraceTextId {};
+struct CInnerQuoteTextId {};
+struct CQuotedId         {};
+struct CValueId          {};
+struct CFieldId          {};
+struct CBodyId           {};
+struct CEntryId          {};
+
+typedef x3::rule<CEscapedTextId>    CEscapedTextRule;
+typedef x3::rule<CQuoteTextId>      CQuoteTextRule;
+typedef x3::rule<CInnerBraceTextId> CInnerBraceTextRule;
+typedef x3::rule<CInnerQuoteTextId> CInnerQuoteTextRule;
+typedef x3::rule<CQuotedId>         CQuotedRule;
+typedef x3::rule<CValueId>          CValueRule;
+typedef x3::rule<CFieldId>          CFieldRule;
+typedef x3::rule<CBodyId>           CBodyRule;
+typedef x3::rule<CEntryId>          CEntryRule;
+
+inline CEscapedTextRule    const cEscapedText    = "escaped text";
+inline CQuoteTextRule      const cQuoteText      = "quote text";
+inline CInnerBraceTextRule const cInnerBraceText = "inner brace text";
+inline CInnerQuoteTextRule const cInnerQuoteText = "inner quote text";
+inline CQuotedRule         const cQuoted         = "quoted value";
+inline CValueRule          const cValue          = "value";
+inline CFieldRule          const cField          = "field";
+inline CBodyRule           const cBody           = "body";
+inline CEntryRule          const cEntry          = "entry";
+
+inline auto const cEscapedText_def =
+    !x3::lit('{')
+    >> +(x3::lit("\\{") | x3::lit("\\}") | ~x3::char_("{}"));
+
+inline auto const cQuoteText_def =
+    +(x3::lit("\\\"") | ~x3::char_("\"{}"));
+
+inline auto const cInnerBraceText_def =
+    ('{' >> *(cInnerBraceText | cEscapedText) >> '}')
+    | cEscapedText;
+
+inline auto const cInnerQuoteText_def =
+    ('{' >> *(cInnerQuoteText | cEscapedText) >> '}')
+    | cQuoteText;
+
+inline auto const cQuoted_def =
+    x3::lexeme[
+        ('"' >> *cInnerQuoteText >> '"')
+        | ('{' >> *cInnerBraceText >> '}')
+    ];
+
+inline auto const cValue_def =
+    x3::raw[cQuoted][CompactQuoted()]
+    | x3::raw[+~x3::char_(",})#")][CompactBare()];
+
+inline auto const cValues =
+    cValue % '#';
+
+inline auto const cField_def =
+    x3::omit[x3::raw[key][CompactFieldName()] >> '=' >> cValues]
+    [CompactField_()];
+
+inline auto const cBody_def =
+    x3::eps[CompactResetBody()]
+    >> -x3::raw[entryKey][CompactKey()] >> ','
+    >> -(cField % ',')
+    >> -x3::lit(',');
+
+inline auto const cGeneric =
+    '@' >> x3::raw[tag][CompactTag()] >> x3::eps[CompactHasKey()]
+    >> (
+        ('{' >> cBody >> '}')
+        | ('(' >> cBody >> ')')
+       );
+
+inline auto const cStringEntry =
+    '@'
+    >> x3::raw[x3::no_case[x3::lit("string")]][CompactTag()]
+    >> (
+        ('{' >> x3::eps[CompactResetBody()] >> cField >> '}')
+        | ('(' >> x3::eps[CompactResetBody()] >> cField >> ')')
+       );
+
+inline auto const cSimple =
+    '@'
+    >> x3::raw[x3::no_case[
+           x3::lit("comment")
+           | x3::lit("include")
+           | x3::lit("preamble")
+       ]][CompactTag()]
+    >> (
+        ('{' >> x3::eps[CompactResetBody()]
+         >> (x3::eps[CompactNoName()] >> cValues)[CompactField_()]
+         >> '}')
+        | ('(' >> x3::eps[CompactResetBody()]
+           >> (x3::eps[CompactNoName()] >> cValues)[CompactField_()]
+           >> ')')
+       );
+
+inline auto const cEntry_def =
+    (x3::eps[CompactReset()] >> cStringEntry)
+    | (x3::eps[CompactReset()] >> cSimple)
+    | (x3::eps[CompactReset()] >> cGeneric);
+
+inline auto const cStart =
+    *(junk >> cEntry[CompactPush()]);
+
+BOOST_SPIRIT_DEFINE(
+    cEscapedText,
+    cQuoteText,
+    cInnerBraceText,
+    cInnerQuoteText,
+    cQuoted,
+    cValue,
+    cField,
+    cBody,
+    cEntry
+)
+
+} // namespace detail
+
+//------------------------------------------------------------------
+// CompactBibliography
+//------------------------------------------------------------------
+
+/**
+ * @brief A list of CompactEntry objects together with the storage
+ *        their views refer to.
+ *
+ * open() maps a file and keeps the mapping alive for the lifetime
+ * of the object, so most strings cost only a view.  Strings which
+ * differ from the source text, and all values assigned through
+ * set_field_value(), are copied into a per-bibliography arena.
+ *
+ * The entries are the same, in the same order, as those produced
+ * by read(); CompactEntry::to_entry() converts back.
+ */
+class CompactBibliography
+{
+public:
+    CompactBibliography()
+    {
+    }
+
+    /// @brief The parsed entries.
+    std::vector<CompactEntry> entries;
+
+    /**
+     * @brief Map file @p fname and parse it, replacing the current
+     *        entries.
+     *
+     * @return @c false if the file could not be opened.
+     */
+    bool open(const std::string& fname)
+    {
+        clear();
+        if (!file_.open(fname)) {
+            return false;
+        }
+        return parse(file_.begin(), file_.end());
+    }
+
+    /**
+     * @brief Parse the buffer [@p first, @p last), appending to the
+     *        current entries.
+     *
+     * The buffer must outlive this object (or the next clear()).
+     * @return @c true on success.
+     */
+    bool parse(const char* first, const char* last)
+    {
+        detail::CompactBuilder b;
+        b.entries = &entries;
+        b.arena = &arena_;
+        b.first = 0;
+        return x3::phrase_parse(
+            first, last,
+            x3::with<detail::CompactBuilderId>(b)
+                [detail::cStart],
+            bibtex::space);
+    }
+
+    /**
+     * @brief Set the value of field @p field (an exact, case-sensitive
+     *        match as in <tt>bib_file::set_field_value()</tt>) in
+     *        @p e, adding the field if it is not present.
+     *
+     * This is the only operation which copies text.
+     */
+    void set_field_value(CompactEntry& e, std::string_view field,
+                         std::string_view value)
+    {
+        std::string_view v = arena_.copy(value);
+        for (std::size_t j = 0; j < e.fields.size(); ++j) {
+            if (e.fields[j].name == field) {
+                if (e.fields[j].count == 1) {
+                    e.values[e.fields[j].first] = v;
+                } else {
+                    e.fields[j].first =
+                        static_cast<std::uint32_t>(e.values.size());
+                    e.fields[j].count = 1;
+                    e.values.push_back(v);
+                }
+                return;
+            }
+        }
+        CompactField f;
+        f.name = arena_.copy(field);
+        f.first = static_cast<std::uint32_t>(e.values.size());
+        f.count = 1;
+        e.fields.push_back(f);
+        e.values.push_back(v);
+    }
+
+    /// @brief Remove all entries and release the mapping and arena.
+    void clear()
+    {
+        entries.clear();
+        arena_.clear();
+        file_.close();
+    }
+
+    /// @brief Number of bytes copied into the arena.
+    std::size_t arena_bytes() const
+    {
+        return arena_.bytes();
+    }
+
+private:
+    CompactBibliography(const CompactBibliography&);
+    CompactBibliography& operator=(const CompactBibliography&);
+
+    MappedFile file_;
+    StringArena arena_;
+};
+
+} // namespace bibtex
+
+#endif // BT_COMPACT_H
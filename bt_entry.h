@@ -47,7 +47,21 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -65,14 +79,735 @@ namespace bibtex {
   // Common types
   //------------------------------------------------------------------
 
-  /// @brief A list of values associated with a single BibTeX field.
-  typedef std::vector<std::string> ValueVector;
+  /**
+   * @brief Case-insensitive hash of the name [@p first, @p last).
+   */
+  inline std::uint32_t field_name_hash(const char* first, const char* last)
+  {
+    std::uint32_t h = 2166136261u;
+    for (; first != last; ++first) {
+      h = (h ^ static_cast<unsigned char>(
+             std::tolower(static_cast<unsigned char>(*first)))) * 16777619u;
+    }
+    return h;
+  }
+
+  /// @brief True if two names are equal ignoring case.
+  inline bool field_name_equal(const std::string& a, const std::string& b)
+  {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (std::tolower(static_cast<unsigned char>(a[i]))
+          != std::tolower(static_cast<unsigned char>(b[i]))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //------------------------------------------------------------------
+  // Symbols
+  //
+  // Entry tags, field names and a few field values with a small
+  // number of distinct values (e.g. journal names) are repeated in
+  // nearly every entry.  They are stored once in a global table and
+  // entries refer to them through a pointer-sized Symbol, so that
+  // equal symbols compare by address.
+  //------------------------------------------------------------------
+
+  /// @brief An interned string, owned by the SymbolTable.
+  struct SymbolNode
+  {
+    /// The text.
+    std::string text;
+    /// Position in the table, starting at one.
+    std::uint32_t id;
+    /// field_name_hash() of the text.
+    std::uint32_t hash;
+    /// The node of the lower-case text (possibly this node).
+    const SymbolNode* folded;
+  };
+
+  /**
+   * @brief The table of interned strings.
+   *
+   * Interning is thread-safe, so that entries may be parsed in
+   * parallel.  Nodes are never removed, and their addresses never
+   * change, so reading a symbol needs no lock.
+   */
+  class SymbolTable
+  {
+  public:
+
+    /// @brief Return the node for [@p s, @p s + @p n), adding it if needed.
+    const SymbolNode* intern(const char* s, std::size_t n)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return intern_locked(std::string_view(s, n));
+    }
+
+    /// @brief Number of distinct strings in the table.
+    std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return nodes_.size();
+    }
+
+  private:
+
+    const SymbolNode* intern_locked(std::string_view s)
+    {
+      std::unordered_map<std::string_view,
+                         const SymbolNode*>::const_iterator it =
+        map_.find(s);
+      if (it != map_.end()) {
+        return it->second;
+      }
+      nodes_.emplace_back();
+      SymbolNode& node = nodes_.back();
+      node.text.assign(s.data(), s.size());
+      node.id = static_cast<std::uint32_t>(nodes_.size());
+      node.hash = field_name_hash(s.data(), s.data() + s.size());
+      node.folded = &node;
+      map_.emplace(std::string_view(node.text), &node);
+      std::string lower(node.text);
+      for (std::size_t i = 0; i < lower.size(); ++i) {
+        lower[i] = static_cast<char>(
+          std::tolower(static_cast<unsigned char>(lower[i])));
+      }
+      if (lower != node.text) {
+        node.folded = intern_locked(lower);
+      }
+      return &node;
+    }
+
+    mutable std::mutex mutex_;
+    /// The nodes, in a deque so that their addresses are stable.
+    std::deque<SymbolNode> nodes_;
+    /// Lookup from text to node, keyed by views of the node text.
+    std::unordered_map<std::string_view, const SymbolNode*> map_;
+  };
+
+  /// @brief The global symbol table.
+  inline SymbolTable& symbols()
+  {
+    static SymbolTable table;
+    return table;
+  }
+
+  /**
+   * @brief A string interned in symbols().
+   *
+   * A symbol reads like a <tt>const std::string</tt>.  Assigning a
+   * string interns it.  The empty string is the null symbol.
+   */
+  class Symbol
+  {
+  public:
+
+    Symbol()
+      : node_(0)
+    {
+    }
+
+    Symbol(const char* s, std::size_t n)
+      : node_(n == 0 ? 0 : symbols().intern(s, n))
+    {
+    }
+
+    Symbol(const std::string& s)
+      : node_(s.empty() ? 0 : symbols().intern(s.data(), s.size()))
+    {
+    }
+
+    Symbol(const char* s)
+      : node_(0)
+    {
+      std::size_t n = std::char_traits<char>::length(s);
+      if (n > 0) {
+        node_ = symbols().intern(s, n);
+      }
+    }
+
+    /// @brief The text.
+    const std::string& str() const
+    {
+      return node_ ? node_->text : empty_string();
+    }
+
+    operator const std::string&() const
+    {
+      return str();
+    }
+
+    const char* c_str() const { return str().c_str(); }
+    const char* data() const { return str().data(); }
+    std::size_t size() const { return str().size(); }
+    std::size_t length() const { return str().size(); }
+    bool empty() const { return node_ == 0; }
+    char operator[](std::size_t i) const { return str()[i]; }
+
+    /// @brief Position in the symbol table, zero for the null symbol.
+    std::uint32_t id() const
+    {
+      return node_ ? node_->id : 0;
+    }
+
+    /// @brief Case-insensitive hash, see field_name_hash().
+    std::uint32_t hash() const
+    {
+      return node_ ? node_->hash : field_name_hash(0, 0);
+    }
+
+    /// @brief The lower-case symbol with the same text.
+    Symbol folded() const
+    {
+      Symbol f;
+      f.node_ = node_ ? node_->folded : 0;
+      return f;
+    }
+
+    /// @brief True if the two symbols are equal ignoring case.
+    bool equal_folded(const Symbol& s) const
+    {
+      return (node_ ? node_->folded : 0) == (s.node_ ? s.node_->folded : 0);
+    }
+
+    friend bool operator==(const Symbol& a, const Symbol& b)
+    {
+      return a.node_ == b.node_;
+    }
+
+  private:
+
+    static const std::string& empty_string()
+    {
+      static const std::string empty;
+      return empty;
+    }
+
+    const SymbolNode* node_;
+  };
+
+  inline bool operator!=(const Symbol& a, const Symbol& b)
+  {
+    return !(a == b);
+  }
+
+  inline bool operator==(const Symbol& a, const std::string& b)
+  {
+    return a.str() == b;
+  }
+
+  inline bool operator==(const std::string& a, const Symbol& b)
+  {
+    return a == b.str();
+  }
+
+  inline bool operator!=(const Symbol& a, const std::string& b)
+  {
+    return a.str() != b;
+  }
+
+  inline bool operator!=(const std::string& a, const Symbol& b)
+  {
+    return a != b.str();
+  }
+
+  inline bool operator==(const Symbol& a, const char* b)
+  {
+    return a.str() == b;
+  }
+
+  inline bool operator!=(const Symbol& a, const char* b)
+  {
+    return a.str() != b;
+  }
+
+  /// @brief Order by text, so that sorting does not depend on interning.
+  inline bool operator<(const Symbol& a, const Symbol& b)
+  {
+    return a != b && a.str() < b.str();
+  }
+
+  inline std::string operator+(const std::string& a, const Symbol& b)
+  {
+    return a + b.str();
+  }
+
+  inline std::string operator+(const Symbol& a, const std::string& b)
+  {
+    return a.str() + b;
+  }
+
+  inline std::string operator+(const char* a, const Symbol& b)
+  {
+    return a + b.str();
+  }
+
+  inline std::string operator+(const Symbol& a, const char* b)
+  {
+    return a.str() + b;
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, const Symbol& s)
+  {
+    return os << s.str();
+  }
+
+  struct MacroDef;
+
+  /**
+   * @brief One @c '#'-separated component of a BibTeX field value.
+   *
+   * The text is the component without its delimiters.  A bare
+   * component, i.e. one which was not enclosed in braces or quotes,
+   * may be a reference to an @c \@string macro, in which case
+   * @ref macro points to its definition (see bt_macro.h).
+   *
+   * A Value reads like a <tt>const std::string</tt> holding its
+   * text.  The text is changed only through assignment or str().
+   */
+  struct Value
+  {
+    Value() : bare(false) {}
+
+    Value(const std::string& s, bool is_bare = false)
+      : bare(is_bare), str_(s) {}
+
+    Value(std::string&& s, bool is_bare = false)
+      : bare(is_bare), str_(std::move(s)) {}
+
+    Value(const char* s)
+      : bare(false), str_(s) {}
+
+    /// @brief Replace with literal text, dropping any macro reference.
+    Value& operator=(const std::string& s)
+    {
+      str_ = s;
+      bare = false;
+      macro.reset();
+      dict_ = Symbol();
+      return *this;
+    }
+
+    /// @brief Replace with literal text, dropping any macro reference.
+    Value& operator=(const char* s)
+    {
+      str_ = s;
+      bare = false;
+      macro.reset();
+      dict_ = Symbol();
+      return *this;
+    }
+
+    /// @brief The text, whether or not it is encoded.
+    const std::string& text() const
+    {
+      return dict_.empty() ? str_ : dict_.str();
+    }
+
+    operator const std::string&() const
+    {
+      return text();
+    }
+
+    /// @brief The text, decoded first so that it may be modified.
+    std::string& str()
+    {
+      decode();
+      return str_;
+    }
+
+    bool empty() const { return text().empty(); }
+    std::size_t size() const { return text().size(); }
+    std::size_t length() const { return text().size(); }
+    const char* c_str() const { return text().c_str(); }
+    char operator[](std::size_t i) const { return text()[i]; }
+
+    /// @brief True if the text is held in the symbol table.
+    bool encoded() const
+    {
+      return !dict_.empty();
+    }
+
+    /**
+     * @brief Move the text into the symbol table.
+     *
+     * This is used for values which are shared by many entries,
+     * like journal names.  The text still reads the same through
+     * text() and the conversion to <tt>const std::string&</tt>.
+     */
+    void encode()
+    {
+      if (!str_.empty()) {
+        dict_ = Symbol(str_);
+        std::string().swap(str_);
+      }
+    }
+
+    /// @brief Move an encoded text back out of the symbol table.
+    void decode()
+    {
+      if (!dict_.empty()) {
+        str_ = dict_.str();
+        dict_ = Symbol();
+      }
+    }
 
-  /// @brief A BibTeX field: a key string paired with its values.
-  typedef std::pair<std::string, ValueVector> KeyValue;
+    /// True if the component was not delimited by braces or quotes.
+    bool bare;
+    /// The macro this component refers to, if any.
+    std::shared_ptr<MacroDef> macro;
 
-  /// @brief An ordered list of BibTeX fields.
-  typedef std::vector<KeyValue> KeyValueVector;
+  private:
+
+    /// The text, unless it has been moved to @ref dict_.
+    std::string str_;
+    /// The text, if it has been moved to the symbol table by encode().
+    Symbol dict_;
+  };
+
+  /// @brief Values compare by their text, encoded or not.
+  inline bool operator==(const Value& a, const Value& b)
+  {
+    return a.text() == b.text();
+  }
+
+  inline bool operator!=(const Value& a, const Value& b)
+  {
+    return !(a == b);
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, const Value& v)
+  {
+    return os << v.text();
+  }
+
+  namespace detail {
+
+    /// @brief Random-access iterator over an indexable container.
+    template<class Container, class T>
+    class IndexIterator
+    {
+    public:
+      typedef std::random_access_iterator_tag iterator_category;
+      typedef typename std::remove_const<T>::type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef T* pointer;
+      typedef T& reference;
+
+      IndexIterator()
+        : c_(0), i_(0)
+      {
+      }
+
+      IndexIterator(Container* c, std::size_t i)
+        : c_(c), i_(i)
+      {
+      }
+
+      reference operator*() const { return (*c_)[i_]; }
+      pointer operator->() const { return &(*c_)[i_]; }
+      reference operator[](difference_type n) const
+      {
+        return (*c_)[i_ + n];
+      }
+
+      IndexIterator& operator++() { ++i_; return *this; }
+      IndexIterator& operator--() { --i_; return *this; }
+      IndexIterator operator++(int) { IndexIterator t(*this); ++i_; return t; }
+      IndexIterator operator--(int) { IndexIterator t(*this); --i_; return t; }
+      IndexIterator& operator+=(difference_type n) { i_ += n; return *this; }
+      IndexIterator& operator-=(difference_type n) { i_ -= n; return *this; }
+
+      IndexIterator operator+(difference_type n) const
+      {
+        return IndexIterator(c_, i_ + n);
+      }
+
+      IndexIterator operator-(difference_type n) const
+      {
+        return IndexIterator(c_, i_ - n);
+      }
+
+      difference_type operator-(const IndexIterator& o) const
+      {
+        return static_cast<difference_type>(i_)
+          - static_cast<difference_type>(o.i_);
+      }
+
+      bool operator==(const IndexIterator& o) const { return i_ == o.i_; }
+      bool operator!=(const IndexIterator& o) const { return i_ != o.i_; }
+      bool operator<(const IndexIterator& o) const { return i_ < o.i_; }
+      bool operator>(const IndexIterator& o) const { return i_ > o.i_; }
+      bool operator<=(const IndexIterator& o) const { return i_ <= o.i_; }
+      bool operator>=(const IndexIterator& o) const { return i_ >= o.i_; }
+
+      /// @brief Position in the container.
+      std::size_t index() const { return i_; }
+
+    private:
+      Container* c_;
+      std::size_t i_;
+    };
+
+  }
+
+  /**
+   * @brief The @c '#'-separated components of a single BibTeX field.
+   *
+   * Nearly every field has exactly one component, so the first is
+   * stored inline and the rest of a concatenation are kept in a
+   * separate vector which is allocated only when they are present.
+   * The interface is the part of @c std::vector used by the parser
+   * and by the rest of btmanip.
+   */
+  class ValueVector
+  {
+  public:
+
+    typedef Value value_type;
+    typedef Value& reference;
+    typedef const Value& const_reference;
+    typedef Value* pointer;
+    typedef const Value* const_pointer;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef detail::IndexIterator<ValueVector, Value> iterator;
+    typedef detail::IndexIterator<const ValueVector, const Value>
+      const_iterator;
+
+    ValueVector()
+      : size_(0)
+    {
+    }
+
+    ValueVector(size_type n, const Value& v)
+      : size_(0)
+    {
+      assign(n, v);
+    }
+
+    ValueVector(const ValueVector& o)
+      : first_(o.first_), size_(o.size_)
+    {
+      if (o.rest_) {
+        rest_.reset(new std::vector<Value>(*o.rest_));
+      }
+    }
+
+    ValueVector(ValueVector&& o) noexcept
+      : first_(std::move(o.first_)), rest_(std::move(o.rest_)),
+        size_(o.size_)
+    {
+      o.size_ = 0;
+    }
+
+    ValueVector& operator=(const ValueVector& o)
+    {
+      if (this != &o) {
+        first_ = o.first_;
+        if (o.rest_) {
+          rest_.reset(new std::vector<Value>(*o.rest_));
+        } else {
+          rest_.reset();
+        }
+        size_ = o.size_;
+      }
+      return *this;
+    }
+
+    ValueVector& operator=(ValueVector&& o) noexcept
+    {
+      first_ = std::move(o.first_);
+      rest_ = std::move(o.rest_);
+      size_ = o.size_;
+      o.size_ = 0;
+      return *this;
+    }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    reference operator[](size_type i)
+    {
+      return i == 0 ? first_ : (*rest_)[i - 1];
+    }
+
+    const_reference operator[](size_type i) const
+    {
+      return i == 0 ? first_ : (*rest_)[i - 1];
+    }
+
+    reference front() { return first_; }
+    const_reference front() const { return first_; }
+    reference back() { return (*this)[size_ - 1]; }
+    const_reference back() const { return (*this)[size_ - 1]; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size_); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+    void push_back(const Value& v)
+    {
+      Value t(v);
+      push_back(std::move(t));
+    }
+
+    void push_back(Value&& v)
+    {
+      if (size_ == 0) {
+        first_ = std::move(v);
+      } else {
+        if (!rest_) {
+          rest_.reset(new std::vector<Value>);
+        }
+        rest_->push_back(std::move(v));
+      }
+      ++size_;
+    }
+
+    /// @brief Insert @p v before @p pos.
+    iterator insert(iterator pos, Value v)
+    {
+      std::size_t i = pos.index();
+      push_back(std::move(v));
+      for (std::size_t j = size_ - 1; j > i; --j) {
+        std::swap((*this)[j], (*this)[j - 1]);
+      }
+      return iterator(this, i);
+    }
+
+    /// @brief Insert [@p first, @p last) before @p pos.
+    template<class InputIterator>
+    void insert(iterator pos, InputIterator first, InputIterator last)
+    {
+      for (std::size_t i = pos.index(); first != last; ++first, ++i) {
+        insert(iterator(this, i), Value(*first));
+      }
+    }
+
+    void assign(size_type n, const Value& v)
+    {
+      Value t(v);
+      clear();
+      for (size_type i = 0; i < n; ++i) {
+        push_back(t);
+      }
+    }
+
+    void reserve(size_type n)
+    {
+      if (n > 1) {
+        if (!rest_) {
+          rest_.reset(new std::vector<Value>);
+        }
+        rest_->reserve(n - 1);
+      }
+    }
+
+    void clear()
+    {
+      first_ = Value();
+      rest_.reset();
+      size_ = 0;
+    }
+
+  private:
+
+    /// The first component, if @ref size_ is not zero.
+    Value first_;
+    /// The other components, or null.
+    std::unique_ptr<std::vector<Value> > rest_;
+    /// Number of components.
+    std::uint32_t size_;
+  };
+
+  inline bool operator==(const ValueVector& a, const ValueVector& b)
+  {
+    if (a.size() != b.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (!(a[i] == b[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  inline bool operator!=(const ValueVector& a, const ValueVector& b)
+  {
+    return !(a == b);
+  }
+
+  /// @brief A BibTeX field: a key symbol paired with its values.
+  typedef std::pair<Symbol, ValueVector> KeyValue;
+
+  /**
+   * @brief An ordered list of BibTeX fields.
+   *
+   * The fields of an entry are allocated from entry_resource(),
+   * other lists from the default memory resource.
+   */
+  typedef std::pmr::vector<KeyValue> KeyValueVector;
+
+  namespace detail {
+
+    /// @brief The resource set by set_entry_resource().
+    inline std::atomic<std::pmr::memory_resource*>& entry_resource_ptr()
+    {
+      static std::atomic<std::pmr::memory_resource*> r(nullptr);
+      return r;
+    }
+
+  }
+
+  /**
+   * @brief The memory resource from which entries created or copied
+   *        now allocate their fields.
+   *
+   * This is the default memory resource unless another was set with
+   * set_entry_resource(), see also EntryArenaScope in bt_arena.h.
+   */
+  inline std::pmr::memory_resource* entry_resource()
+  {
+    std::pmr::memory_resource* r = detail::entry_resource_ptr().load();
+    return r ? r : std::pmr::get_default_resource();
+  }
+
+  /**
+   * @brief Make @p r the resource returned by entry_resource(), or
+   *        the default memory resource if @p r is null.
+   *
+   * The setting is global, so that it also applies to the threads of
+   * the parallel reader.
+   *
+   * @return The previous setting.
+   */
+  inline std::pmr::memory_resource*
+  set_entry_resource(std::pmr::memory_resource* r)
+  {
+    return detail::entry_resource_ptr().exchange(r);
+  }
+
+  /**
+   * @brief Encode the value of @p kv with Value::encode() if it is a
+   *        journal or publisher name given as a single literal.
+   */
+  inline void encode_shared_value(KeyValue& kv)
+  {
+    static const Symbol journal("journal"), publisher("publisher");
+    Symbol name = kv.first.folded();
+    if ((name == journal || name == publisher) && kv.second.size() == 1
+        && !kv.second[0].macro && !kv.second[0].bare) {
+      kv.second[0].encode();
+    }
+  }
 
   //------------------------------------------------------------------
   // Skipper
@@ -126,6 +861,55 @@ namespace bibtex {
   // BibTeXEntry
   //------------------------------------------------------------------
 
+  /**
+   * @brief Lookup table from lower-cased field name to field position.
+   *
+   * The table is built on the first lookup and records the address
+   * and length of the field vector it was built from, and the next
+   * lookup rebuilds it if either has changed.  Since this does not
+   * catch every change (e.g. an erase followed by a push_back
+   * within the capacity, or renaming a field in place), code which
+   * adds, removes or renames fields should call
+   * BibTeXEntry::invalidate_field_index().  Copies start empty.
+   */
+  struct FieldIndex
+  {
+    FieldIndex()
+      : data(0), size(0), built(false)
+    {
+    }
+
+    // Copying never allocates, so that BibTeXEntry stays nothrow
+    // move constructible and vectors of entries move on reallocation
+    FieldIndex(const FieldIndex&) noexcept
+      : data(0), size(0), built(false)
+    {
+    }
+
+    FieldIndex& operator=(const FieldIndex&) noexcept
+    {
+      clear();
+      return *this;
+    }
+
+    /// @brief Forget the table, so that the next lookup rebuilds it.
+    void clear() noexcept
+    {
+      data = 0;
+      size = 0;
+      built = false;
+    }
+
+    /// Address of the field vector the table was built from.
+    const void* data;
+    /// Number of fields when the table was built.
+    std::size_t size;
+    /// True if @ref slots is valid for @ref data and @ref size.
+    bool built;
+    /// (name hash, position) pairs, sorted.
+    std::vector<std::pair<std::uint32_t, std::uint32_t> > slots;
+  };
+
   /**
    * @brief Represents a single BibTeX entry.
    *
@@ -135,12 +919,85 @@ namespace bibtex {
   struct BibTeXEntry
     : boost::equality_comparable<BibTeXEntry>
   {
+    /// Returned by find_field() if there is no such field.
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
     /// Entry type tag, e.g. @c article or @c book.
-    std::string tag;
+    Symbol tag;
     /// Optional citation key, absent for @c \@comment etc.
     boost::optional<std::string> key;
     /// Ordered list of field key/value pairs.
     KeyValueVector fields;
+
+    /// @brief Create an entry whose fields use entry_resource().
+    BibTeXEntry()
+      : fields(entry_resource())
+    {
+    }
+
+    /// @brief Copy @p e, allocating the fields from entry_resource().
+    BibTeXEntry(const BibTeXEntry& e)
+      : tag(e.tag), key(e.key), fields(e.fields, entry_resource())
+    {
+    }
+
+    BibTeXEntry(BibTeXEntry&&) = default;
+    BibTeXEntry& operator=(const BibTeXEntry&) = default;
+    BibTeXEntry& operator=(BibTeXEntry&&) = default;
+
+    /**
+     * @brief Position of the first field at or after @p from whose
+     *        name equals @p name ignoring case, or @ref npos.
+     *
+     * Uses the lazily built field index, and does not allocate once
+     * the index is built.
+     */
+    std::size_t find_field(const std::string& name,
+                           std::size_t from = 0) const
+    {
+      if (!index_.built || index_.data != fields.data()
+          || index_.size != fields.size()) {
+        build_field_index();
+      }
+      std::pair<std::uint32_t, std::uint32_t> lo(
+        field_name_hash(name.data(), name.data() + name.size()),
+        static_cast<std::uint32_t>(from));
+      typedef std::vector<std::pair<std::uint32_t, std::uint32_t> >
+        slot_vector;
+      for (slot_vector::const_iterator it =
+             std::lower_bound(index_.slots.begin(), index_.slots.end(), lo);
+           it != index_.slots.end() && it->first == lo.first; ++it) {
+        if (field_name_equal(fields[it->second].first, name)) {
+          return it->second;
+        }
+      }
+      return npos;
+    }
+
+    /// @brief Force the field index to be rebuilt on the next lookup.
+    void invalidate_field_index() const
+    {
+      index_.clear();
+    }
+
+  private:
+
+    /// @brief Rebuild the field index from @ref fields.
+    void build_field_index() const
+    {
+      index_.slots.resize(fields.size());
+      for (std::size_t i = 0; i < fields.size(); ++i) {
+        index_.slots[i].first = fields[i].first.hash();
+        index_.slots[i].second = static_cast<std::uint32_t>(i);
+      }
+      std::sort(index_.slots.begin(), index_.slots.end());
+      index_.data = fields.data();
+      index_.size = fields.size();
+      index_.built = true;
+    }
+
+    /// The field index, see find_field().
+    mutable FieldIndex index_;
   };
 
   /**
@@ -164,7 +1021,7 @@ namespace bibtex {
 
 BOOST_FUSION_ADAPT_STRUCT(
   bibtex::BibTeXEntry,
-  (std::string, tag)
+  (bibtex::Symbol, tag)
   (boost::optional<std::string>, key)
   (bibtex::KeyValueVector, fields)
 )
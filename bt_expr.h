@@ -0,0 +1,627 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_expr.h
+    \brief Boolean expressions over the fields of entries
+*/
+#ifndef BT_EXPR_H
+#define BT_EXPR_H
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "bt_columns.h"
+#include "bt_entry.h"
+#include "bt_macro.h"
+#include "bt_query.h"
+
+namespace bibtex {
+
+/**
+ * @brief A boolean expression over the fields of an entry, parsed
+ *        once and evaluated in one pass over a list of entries.
+ *
+ * The grammar is, with keywords in any case:
+ *
+ * @code
+ * expr   := term { "or" term }
+ * term   := factor { "and" factor }
+ * factor := "not" factor | "(" expr ")" | "has" field | pred
+ * pred   := field ("=" | "!=" | "~" | "!~") pattern
+ *         | field "=~" regex
+ *         | field ("<" | "<=" | ">" | ">=" | "==") number
+ *         | field "between" number "and" number
+ * @endcode
+ *
+ * A field is a field name or @c key or @c tag, which refer to the
+ * key and the type of the entry.  A pattern is a glob as in
+ * GlobMatcher, matched with @c = and ignoring case with @c ~.  An
+ * entry matches if any field with the name matches; @c != and
+ * @c !~ match entries for which no field matches.  A regex is
+ * written @c /re/ or @c /re/i to ignore case, or as a quoted string,
+ * and may match any part of the value.  Numeric comparisons use the
+ * leading number of the first field with the name, see
+ * ColumnStore::to_number(), and never match entries without one;
+ * @c between includes both ends.
+ *
+ * Patterns and regexes are compiled by parse(), and the numeric
+ * values are read from numeric columns built before the pass over
+ * the entries, so that evaluation does not parse anything.
+ *
+ * Words end at spaces, parentheses, quotes and the characters
+ * @c <, @c >, @c = and @c ~, so patterns which contain these must
+ * be quoted with single or double quotes.
+ */
+class Expression
+{
+public:
+
+    Expression()
+        : root_(0)
+    {
+    }
+
+    /// @brief The text given to parse().
+    const std::string& text() const
+    {
+        return text_;
+    }
+
+    /**
+     * @brief Parse @p text, replacing the previous expression.
+     *
+     * @return @c false, setting @p error to a description of the
+     *         problem, if @p text is not a valid expression.
+     */
+    bool parse(const std::string& text, std::string& error)
+    {
+        text_ = text;
+        nodes_.clear();
+        attrs_.clear();
+        toks_.clear();
+        cur_ = 0;
+        error_.clear();
+        if (tokenize(text)) {
+            if (peek().kind == tok_end) {
+                fail("Empty expression");
+            } else {
+                root_ = parse_or();
+                if (error_.empty() && peek().kind != tok_end) {
+                    fail("Unexpected '" + peek().text + "'");
+                }
+            }
+        }
+        toks_.clear();
+        error = error_;
+        if (!error_.empty()) {
+            nodes_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Set @p match[i] to 1 for each entry @c i of @p ents
+     *        which matches the expression, and to 0 for the others.
+     *
+     * If @p subset is not null, only the entries with the indexes in
+     * @p subset are considered and the others are left unchanged.
+     * The numeric columns are taken from @p columns if it is not
+     * null, and otherwise built for this call only.
+     */
+    void evaluate(const std::vector<BibTeXEntry>& ents,
+                  std::vector<char>& match,
+                  const std::vector<std::size_t>* subset = 0,
+                  ColumnStore* columns = 0) const
+    {
+        if (nodes_.empty()) {
+            return;
+        }
+        ColumnStore local;
+        ColumnStore& cs = (columns ? *columns : local);
+        std::vector<const double*> nums(attrs_.size());
+        for (std::size_t k = 0; k < attrs_.size(); ++k) {
+            nums[k] = cs.numbers(attrs_[k], ents).data();
+        }
+        std::size_t n = (subset ? subset->size() : ents.size());
+        std::string scratch;
+        for (std::size_t k = 0; k < n; ++k) {
+            std::size_t i = (subset ? (*subset)[k] : k);
+            match[i] = eval(root_, ents[i], i, nums, scratch);
+        }
+    }
+
+private:
+
+    enum TokenKind
+    {
+        tok_word,
+        tok_string,
+        tok_regex,
+        tok_op,
+        tok_lparen,
+        tok_rparen,
+        tok_end
+    };
+
+    struct Token
+    {
+        TokenKind kind;
+        std::string text;
+        /// The flags after a regex.
+        std::string flags;
+        /// Position in the text.
+        std::size_t pos;
+    };
+
+    enum NodeKind
+    {
+        node_or,
+        node_and,
+        node_not,
+        node_has,
+        node_glob,
+        node_regex,
+        node_range
+    };
+
+    /// Which part of the entry a predicate refers to.
+    enum Target
+    {
+        target_field,
+        target_key,
+        target_tag
+    };
+
+    struct Node
+    {
+        Node()
+            : kind(node_has), target(target_field), negate(false),
+              attr(0), lo(0.0), hi(0.0), lo_open(false), hi_open(false)
+        {
+        }
+
+        NodeKind kind;
+        /// The operands of @ref node_or, @ref node_and and
+        /// @ref node_not.
+        std::vector<std::size_t> args;
+        Target target;
+        /// The folded field name, for @ref target_field.
+        Symbol field;
+        /// True for @c != and @c !~.
+        bool negate;
+        GlobMatcher glob;
+        std::regex re;
+        /// Index in @ref attrs_ of the field of a @ref node_range.
+        std::size_t attr;
+        double lo;
+        double hi;
+        bool lo_open;
+        bool hi_open;
+    };
+
+    static bool is_op_char(char c)
+    {
+        return c == '<' || c == '>' || c == '=' || c == '~';
+    }
+
+    /// Split @p t into @ref toks_.
+    bool tokenize(const std::string& t)
+    {
+        static const char* ops[] = {
+            "!=", "!~", "=~", "==", "<=", ">=", "=", "~", "<", ">"
+        };
+        std::size_t i = 0;
+        while (true) {
+            while (i < t.size() && std::isspace(
+                       static_cast<unsigned char>(t[i]))) {
+                ++i;
+            }
+            Token tok;
+            tok.pos = i;
+            if (i == t.size()) {
+                tok.kind = tok_end;
+                toks_.push_back(tok);
+                return true;
+            }
+            char c = t[i];
+            if (c == '(' || c == ')') {
+                tok.kind = (c == '(' ? tok_lparen : tok_rparen);
+                tok.text = c;
+                ++i;
+            } else if (c == '"' || c == '\'' || c == '/') {
+                tok.kind = (c == '/' ? tok_regex : tok_string);
+                for (++i; i < t.size() && t[i] != c; ++i) {
+                    if (t[i] == '\\' && i + 1 < t.size() && t[i + 1] == c) {
+                        ++i;
+                    }
+                    tok.text += t[i];
+                }
+                if (i == t.size()) {
+                    error_ = "Unterminated " + std::string(1, c)
+                        + " at position " + std::to_string(tok.pos);
+                    return false;
+                }
+                ++i;
+                if (c == '/') {
+                    while (i < t.size() && std::isalpha(
+                               static_cast<unsigned char>(t[i]))) {
+                        tok.flags += t[i++];
+                    }
+                }
+            } else {
+                tok.kind = tok_word;
+                for (std::size_t k = 0; k < sizeof(ops) / sizeof(ops[0]);
+                     ++k) {
+                    if (t.compare(i, std::char_traits<char>::length(ops[k]),
+                                  ops[k]) == 0) {
+                        tok.kind = tok_op;
+                        tok.text = ops[k];
+                        i += tok.text.size();
+                        break;
+                    }
+                }
+                if (tok.kind == tok_word) {
+                    while (i < t.size()
+                           && !std::isspace(static_cast<unsigned char>(t[i]))
+                           && t[i] != '(' && t[i] != ')' && t[i] != '"'
+                           && t[i] != '\'' && !is_op_char(t[i])
+                           && !(t[i] == '!' && i + 1 < t.size()
+                                && (t[i + 1] == '=' || t[i + 1] == '~'))) {
+                        tok.text += t[i++];
+                    }
+                }
+            }
+            toks_.push_back(tok);
+        }
+    }
+
+    const Token& peek() const
+    {
+        return toks_[cur_];
+    }
+
+    const Token& next()
+    {
+        const Token& t = toks_[cur_];
+        if (t.kind != tok_end) {
+            ++cur_;
+        }
+        return t;
+    }
+
+    /// True if the next token is the keyword @p kw.
+    bool at_keyword(const char* kw) const
+    {
+        if (peek().kind != tok_word) {
+            return false;
+        }
+        const std::string& w = peek().text;
+        std::size_t n = std::char_traits<char>::length(kw);
+        if (w.size() != n) {
+            return false;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            if (std::tolower(static_cast<unsigned char>(w[i])) != kw[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Record the first error, at the position of the next token.
+    std::size_t fail(const std::string& msg)
+    {
+        if (error_.empty()) {
+            error_ = msg + " at position " + std::to_string(peek().pos);
+        }
+        return 0;
+    }
+
+    std::size_t add(const Node& n)
+    {
+        nodes_.push_back(n);
+        return nodes_.size() - 1;
+    }
+
+    /// Parse operands separated by keyword @p kw into one node.
+    std::size_t parse_list(const char* kw, NodeKind kind,
+                           std::size_t (Expression::*operand)())
+    {
+        std::size_t first = (this->*operand)();
+        if (!at_keyword(kw)) {
+            return first;
+        }
+        Node n;
+        n.kind = kind;
+        n.args.push_back(first);
+        while (error_.empty() && at_keyword(kw)) {
+            next();
+            n.args.push_back((this->*operand)());
+        }
+        return add(n);
+    }
+
+    std::size_t parse_or()
+    {
+        return parse_list("or", node_or, &Expression::parse_and);
+    }
+
+    std::size_t parse_and()
+    {
+        return parse_list("and", node_and, &Expression::parse_factor);
+    }
+
+    std::size_t parse_factor()
+    {
+        if (!error_.empty()) {
+            return 0;
+        }
+        if (at_keyword("not")) {
+            next();
+            Node n;
+            n.kind = node_not;
+            n.args.push_back(parse_factor());
+            return add(n);
+        }
+        if (peek().kind == tok_lparen) {
+            next();
+            std::size_t e = parse_or();
+            if (peek().kind != tok_rparen) {
+                return fail("Expected ')'");
+            }
+            next();
+            return e;
+        }
+        if (at_keyword("has")) {
+            next();
+            Node n;
+            n.kind = node_has;
+            if (!parse_target(n)) {
+                return 0;
+            }
+            return add(n);
+        }
+        return parse_pred();
+    }
+
+    /// Parse a field name into @p n.
+    bool parse_target(Node& n)
+    {
+        if (peek().kind != tok_word || at_keyword("and")
+            || at_keyword("or") || at_keyword("not")) {
+            fail("Expected a field name");
+            return false;
+        }
+        Symbol f = Symbol(next().text).folded();
+        if (f == "key") {
+            n.target = target_key;
+        } else if (f == "tag") {
+            n.target = target_tag;
+        } else {
+            n.field = f;
+        }
+        return true;
+    }
+
+    /// Parse a number.
+    bool parse_number(double& x)
+    {
+        const Token& t = peek();
+        if (t.kind == tok_word || t.kind == tok_string) {
+            const char* s = t.text.c_str();
+            char* end = 0;
+            x = std::strtod(s, &end);
+            if (!t.text.empty() && *end == '\0') {
+                next();
+                return true;
+            }
+        }
+        fail("Expected a number");
+        return false;
+    }
+
+    std::size_t parse_pred()
+    {
+        Node n;
+        if (!parse_target(n)) {
+            return 0;
+        }
+        if (at_keyword("between")) {
+            next();
+            n.kind = node_range;
+            if (!parse_number(n.lo)) {
+                return 0;
+            }
+            if (!at_keyword("and")) {
+                return fail("Expected 'and'");
+            }
+            next();
+            if (!parse_number(n.hi)) {
+                return 0;
+            }
+            return add_range(n);
+        }
+        if (peek().kind != tok_op) {
+            return fail("Expected an operator");
+        }
+        std::string op = next().text;
+        if (op == "=" || op == "!=" || op == "~" || op == "!~") {
+            if (peek().kind != tok_word && peek().kind != tok_string) {
+                return fail("Expected a pattern");
+            }
+            n.kind = node_glob;
+            n.negate = (op[0] == '!');
+            n.glob.compile(next().text, op.find('~') != std::string::npos);
+            return add(n);
+        }
+        if (op == "=~") {
+            if (peek().kind != tok_regex && peek().kind != tok_string) {
+                return fail("Expected a regular expression");
+            }
+            std::regex::flag_type fl = std::regex::ECMAScript
+                | std::regex::nosubs;
+            const Token& t = peek();
+            for (std::size_t k = 0; k < t.flags.size(); ++k) {
+                if (t.flags[k] == 'i') {
+                    fl |= std::regex::icase;
+                } else {
+                    return fail("Unknown regular expression flag '"
+                                + t.flags.substr(k, 1) + "'");
+                }
+            }
+            try {
+                n.re.assign(t.text, fl);
+            } catch (std::regex_error&) {
+                return fail("Invalid regular expression /" + t.text + "/");
+            }
+            next();
+            n.kind = node_regex;
+            return add(n);
+        }
+        double x;
+        if (!parse_number(x)) {
+            return 0;
+        }
+        n.kind = node_range;
+        n.lo = -std::numeric_limits<double>::infinity();
+        n.hi = std::numeric_limits<double>::infinity();
+        if (op == "<" || op == "<=") {
+            n.hi = x;
+            n.hi_open = (op == "<");
+        } else if (op == ">" || op == ">=") {
+            n.lo = x;
+            n.lo_open = (op == ">");
+        } else {
+            n.lo = x;
+            n.hi = x;
+        }
+        return add_range(n);
+    }
+
+    /// Add numeric comparison @p n, recording its column.
+    std::size_t add_range(Node& n)
+    {
+        if (n.target != target_field) {
+            return fail("Numeric comparisons need a field name");
+        }
+        const std::string& name = n.field.str();
+        std::size_t k = 0;
+        while (k < attrs_.size() && attrs_[k] != name) {
+            ++k;
+        }
+        if (k == attrs_.size()) {
+            attrs_.push_back(name);
+        }
+        n.attr = k;
+        return add(n);
+    }
+
+    /// True if any value of the target of @p n matches @p n.
+    template<class Test>
+    static bool any_value(const Node& n, const BibTeXEntry& e,
+                          std::string& scratch, Test test)
+    {
+        if (n.target == target_key) {
+            return e.key && test(*e.key);
+        }
+        if (n.target == target_tag) {
+            return test(e.tag.str());
+        }
+        for (std::size_t j = 0; j < e.fields.size(); ++j) {
+            if (e.fields[j].first.equal_folded(n.field)
+                && test(expand(e.fields[j].second, scratch))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool eval(std::size_t ix, const BibTeXEntry& e, std::size_t i,
+              const std::vector<const double*>& nums,
+              std::string& scratch) const
+    {
+        const Node& n = nodes_[ix];
+        switch (n.kind) {
+        case node_or:
+            for (std::size_t k = 0; k < n.args.size(); ++k) {
+                if (eval(n.args[k], e, i, nums, scratch)) {
+                    return true;
+                }
+            }
+            return false;
+        case node_and:
+            for (std::size_t k = 0; k < n.args.size(); ++k) {
+                if (!eval(n.args[k], e, i, nums, scratch)) {
+                    return false;
+                }
+            }
+            return true;
+        case node_not:
+            return !eval(n.args[0], e, i, nums, scratch);
+        case node_has:
+            return any_value(n, e, scratch,
+                             [](const std::string&) { return true; });
+        case node_glob:
+            return n.negate != any_value(
+                n, e, scratch, [&n](const std::string& v) {
+                    return n.glob.matches(v);
+                });
+        case node_regex:
+            return any_value(n, e, scratch, [&n](const std::string& v) {
+                return std::regex_search(v, n.re);
+            });
+        case node_range: {
+            double x = nums[n.attr][i];
+            return (n.lo_open ? x > n.lo : x >= n.lo)
+                && (n.hi_open ? x < n.hi : x <= n.hi);
+        }
+        }
+        return false;
+    }
+
+    /// The text given to parse().
+    std::string text_;
+    /// The nodes, with the operands before the nodes using them.
+    std::vector<Node> nodes_;
+    /// The top node.
+    std::size_t root_;
+    /// The fields compared as numbers.
+    std::vector<std::string> attrs_;
+    /// The tokens, while parsing.
+    std::vector<Token> toks_;
+    /// The next token, while parsing.
+    std::size_t cur_;
+    /// The first parse error.
+    std::string error_;
+};
+
+} // namespace bibtex
+
+#endif // BT_EXPR_H
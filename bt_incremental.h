@@ -0,0 +1,258 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_incremental.h
+    \brief Incremental re-parsing of a modified BibTeX buffer
+*/
+#ifndef BT_INCREMENTAL_H
+#define BT_INCREMENTAL_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bt_reader.h"
+
+namespace bibtex {
+
+/**
+ * @brief Where each entry of a parsed buffer came from.
+ *
+ * The spans are contiguous, the first starts at offset zero and
+ * the bytes after the last span (the tail) contain no entries.
+ */
+struct SourceMap
+{
+    SourceMap()
+        : size(0), tail_hash(0)
+    {
+    }
+
+    /// Size of the buffer in bytes.
+    std::size_t size;
+    /// One span per entry, in order.
+    std::vector<EntrySpan> spans;
+    /// content_hash() of the tail.
+    std::uint64_t tail_hash;
+
+    /// @brief Offset of the tail.
+    std::size_t tail() const
+    {
+        return spans.empty() ? 0
+                             : spans.back().offset + spans.back().length;
+    }
+
+    /// @brief Remove all spans.
+    void clear()
+    {
+        size = 0;
+        spans.clear();
+        tail_hash = 0;
+    }
+};
+
+/**
+ * @brief Return a hash of the tag, key and fields of @p e.
+ *
+ * This is used to detect whether an entry has been modified since
+ * it was parsed.
+ */
+inline std::uint64_t entry_hash(const BibTeXEntry& e)
+{
+    const std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+    std::uint64_t h = content_hash(e.tag.data(), e.tag.data() + e.tag.size());
+    if (e.key) {
+        h = (h ^ content_hash(e.key->data(),
+                              e.key->data() + e.key->size())) * k;
+    }
+    for (std::size_t i = 0; i < e.fields.size(); ++i) {
+        const std::string& name = e.fields[i].first;
+        h = (h ^ content_hash(name.data(), name.data() + name.size())) * k;
+        const ValueVector& vals = e.fields[i].second;
+        for (std::size_t j = 0; j < vals.size(); ++j) {
+            const std::string& text = vals[j].text();
+            h = (h ^ content_hash(text.data(),
+                                  text.data() + text.size())) * k;
+            h += vals[j].bare ? 1 : 2;
+        }
+        h = (h ^ vals.size()) * k;
+    }
+    return h;
+}
+
+/**
+ * @brief Create the source map of the buffer [@p first, @p last)
+ *        from the @p spans of its entries.
+ *
+ * @return @c false if the spans do not cover the buffer up to its
+ *         tail, e.g. because some entries failed to parse.
+ */
+inline bool make_source_map(const char* first, const char* last,
+                            const std::vector<EntrySpan>& spans,
+                            SourceMap& map)
+{
+    map.clear();
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < spans.size(); ++i) {
+        if (spans[i].offset != expected) {
+            return false;
+        }
+        expected += spans[i].length;
+    }
+    map.size = static_cast<std::size_t>(last - first);
+    map.spans = spans;
+    map.tail_hash = content_hash(first + expected, last);
+    return true;
+}
+
+/**
+ * @brief Re-parse the parts of a modified buffer which differ from
+ *        the buffer described by @p old.
+ *
+ * The leading entries whose spans are unchanged, and the trailing
+ * entries whose spans and tail are unchanged at the same distance
+ * from the end of the buffer, are kept.  The rest of the new buffer
+ * is parsed starting at the end of the leading entries, until the
+ * parse reaches the start of one of the unchanged trailing spans,
+ * from where the serial parse would yield the old entries again.
+ *
+ * On success, the old entries with indexes in [@p begin, @p end)
+ * must be replaced by @p mid to obtain the entries of the new
+ * buffer, and @p next is the source map of the new buffer.
+ *
+ * @return @c false if an entry in the modified region does not
+ *         parse, in which case the whole buffer should be parsed
+ *         with read_with_errors() to report it.
+ */
+inline bool reparse(const SourceMap& old, const char* first,
+                    const char* last, std::size_t& begin,
+                    std::size_t& end, std::vector<BibTeXEntry>& mid,
+                    SourceMap& next)
+{
+    const std::vector<EntrySpan>& sp = old.spans;
+    std::size_t n = sp.size();
+    std::size_t size = static_cast<std::size_t>(last - first);
+
+    // Unchanged leading spans
+    std::size_t k = 0;
+    while (k < n && sp[k].offset + sp[k].length <= size
+           && content_hash(first + sp[k].offset,
+                           first + sp[k].offset + sp[k].length)
+           == sp[k].hash) {
+        ++k;
+    }
+    std::size_t start =
+        (k > 0) ? sp[k - 1].offset + sp[k - 1].length : 0;
+
+    // Unchanged tail and trailing spans, shifted by the change in size
+    std::size_t j = n;
+    bool tail_same = false;
+    std::size_t old_tail = old.tail();
+    if (old_tail + size >= start + old.size) {
+        std::size_t new_tail = old_tail + size - old.size;
+        tail_same = content_hash(first + new_tail, last) == old.tail_hash;
+    }
+    if (tail_same) {
+        while (j > k) {
+            const EntrySpan& s = sp[j - 1];
+            if (s.offset + size < start + old.size
+                || content_hash(first + s.offset + size - old.size,
+                                first + s.offset + s.length + size
+                                - old.size) != s.hash) {
+                break;
+            }
+            --j;
+        }
+    }
+
+    // Parse from the end of the leading spans until an unchanged
+    // trailing span (or the unchanged tail) begins
+    mid.clear();
+    next.clear();
+    next.spans.assign(sp.begin(), sp.begin() + k);
+    const char* it = first + start;
+    if (k > 0) {
+        // The last leading span ends where skipping whitespace and
+        // comments after its entry stops, which may now be later
+        x3::phrase_parse(it, last, x3::eps, bibtex::space);
+        if (it != first + start) {
+            EntrySpan& s = next.spans.back();
+            s.length = static_cast<std::size_t>(it - first) - s.offset;
+            s.hash = content_hash(first + s.offset, it);
+        }
+    }
+    std::size_t jj = j;
+    for (;;) {
+        std::size_t pos = static_cast<std::size_t>(it - first);
+        if (tail_same) {
+            while (jj < n && sp[jj].offset + size - old.size < pos) {
+                ++jj;
+            }
+            if (jj < n && sp[jj].offset + size - old.size == pos) {
+                break;
+            }
+            if (jj == n && old_tail + size - old.size == pos) {
+                break;
+            }
+        }
+        const char* b = it;
+        BibTeXEntry e;
+        if (!x3::phrase_parse(it, last, detail::start,
+                              bibtex::space, e)) {
+            it = b;
+            x3::phrase_parse(it, last, detail::junk, bibtex::space);
+            if (it != last) {
+                return false;
+            }
+            // No more entries: the rest of the buffer is the tail
+            next.size = size;
+            next.tail_hash = content_hash(b, last);
+            begin = k;
+            end = n;
+            return true;
+        }
+        EntrySpan s;
+        s.offset = static_cast<std::size_t>(b - first);
+        s.length = static_cast<std::size_t>(it - b);
+        s.hash = content_hash(b, it);
+        next.spans.push_back(s);
+        mid.push_back(std::move(e));
+    }
+
+    // The parse rejoined the old buffer at trailing span jj
+    for (std::size_t i = jj; i < n; ++i) {
+        EntrySpan s = sp[i];
+        s.offset = s.offset + size - old.size;
+        next.spans.push_back(s);
+    }
+    next.size = size;
+    next.tail_hash = old.tail_hash;
+    begin = k;
+    end = jj;
+    return true;
+}
+
+} // namespace bibtex
+
+#endif // BT_INCREMENTAL_H
@@ -0,0 +1,353 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_key_index.h
+    \brief Hash index from the keys of a list of entries to positions
+*/
+#ifndef BT_KEY_INDEX_H
+#define BT_KEY_INDEX_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bt_reader.h"
+
+namespace bibtex {
+
+/**
+ * @brief Index from the keys of a list of entries to the position of
+ *        the first entry with each key.
+ *
+ * The keys are stored in an open-addressing hash table with linear
+ * probing.  Removal shifts the following slots back rather than
+ * leaving markers, so lookups never slow down as keys are renamed
+ * or removed.  Lookup, insertion, removal and rename take constant
+ * amortized time.
+ *
+ * The positions in key order, which sorting by key needs, are
+ * computed on demand by sorted() and kept until the index changes.
+ *
+ * The index does not see the entries: the owner must keep it up to
+ * date when entries are added, removed, reordered or re-keyed,
+ * either one key at a time or with rebuild().
+ */
+class KeyIndex
+{
+public:
+
+    /// Position returned for a key which is not present.
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    KeyIndex()
+        : size_(0), sorted_valid_(false)
+    {
+    }
+
+    /// @brief Remove all keys.
+    void clear()
+    {
+        slots_.clear();
+        size_ = 0;
+        sorted_.clear();
+        sorted_valid_ = false;
+    }
+
+    /// @brief Number of keys.
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    /// @brief Make room for @p n keys without rehashing.
+    void reserve(std::size_t n)
+    {
+        std::size_t cap = 16;
+        while (cap * 3 < n * 4) {
+            cap *= 2;
+        }
+        if (cap > slots_.size()) {
+            rehash(cap);
+        }
+    }
+
+    /// @brief The position of the entry with key @p key, or @ref npos.
+    std::size_t find(const std::string& key) const
+    {
+        if (size_ == 0) {
+            return npos;
+        }
+        return slots_[locate(key, hash(key))].ix;
+    }
+
+    /**
+     * @brief Add @p key at position @p ix.
+     *
+     * @return @c false, leaving the index unchanged, if @p key is
+     *         already present.
+     */
+    bool insert(const std::string& key, std::size_t ix)
+    {
+        if ((size_ + 1) * 4 > slots_.size() * 3) {
+            rehash(slots_.empty() ? 16 : slots_.size() * 2);
+        }
+        std::uint64_t h = hash(key);
+        std::size_t s = locate(key, h);
+        if (slots_[s].ix != npos) {
+            return false;
+        }
+        slots_[s].key = key;
+        slots_[s].hash = h;
+        slots_[s].ix = ix;
+        ++size_;
+        sorted_valid_ = false;
+        return true;
+    }
+
+    /**
+     * @brief Remove @p key.
+     *
+     * @return @c false if @p key is not present.
+     */
+    bool erase(const std::string& key)
+    {
+        if (size_ == 0) {
+            return false;
+        }
+        std::size_t i = locate(key, hash(key));
+        if (slots_[i].ix == npos) {
+            return false;
+        }
+        // Move back the following slots which would otherwise no
+        // longer be reached from their home slot
+        std::size_t mask = slots_.size() - 1;
+        std::size_t j = i;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (slots_[j].ix == npos) {
+                break;
+            }
+            std::size_t home = static_cast<std::size_t>(slots_[j].hash)
+                & mask;
+            bool stays = (i <= j) ? (i < home && home <= j)
+                                  : (i < home || home <= j);
+            if (!stays) {
+                slots_[i] = std::move(slots_[j]);
+                i = j;
+            }
+        }
+        slots_[i].key.clear();
+        slots_[i].ix = npos;
+        --size_;
+        sorted_valid_ = false;
+        return true;
+    }
+
+    /**
+     * @brief Give the position of @p from to the new key @p to.
+     *
+     * @return @c false, leaving the index unchanged, if @p from is
+     *         not present or @p to is.
+     */
+    bool rename(const std::string& from, const std::string& to)
+    {
+        std::size_t ix = find(from);
+        if (ix == npos || find(to) != npos) {
+            return false;
+        }
+        erase(from);
+        insert(to, ix);
+        return true;
+    }
+
+    /**
+     * @brief Add @p delta to the positions which are at least
+     *        @p first, after entries were inserted or removed
+     *        before them.
+     *
+     * This takes time proportional to the number of keys, but keeps
+     * the positions in key order.
+     */
+    void shift(std::size_t first, std::ptrdiff_t delta)
+    {
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].ix != npos && slots_[i].ix >= first) {
+                slots_[i].ix += delta;
+            }
+        }
+        for (std::size_t i = 0; i < sorted_.size(); ++i) {
+            if (sorted_[i] >= first) {
+                sorted_[i] += delta;
+            }
+        }
+    }
+
+    /**
+     * @brief Replace each position @c i by @p new_ix[i], after the
+     *        entries were moved without changing their order.
+     *
+     * Every indexed position must have a new position.  This takes
+     * time proportional to the number of keys, without hashing.
+     */
+    void remap(const std::vector<std::size_t>& new_ix)
+    {
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].ix != npos) {
+                slots_[i].ix = new_ix[slots_[i].ix];
+            }
+        }
+        if (!sorted_valid_) {
+            sorted_.clear();
+        }
+        for (std::size_t i = 0; i < sorted_.size(); ++i) {
+            sorted_[i] = new_ix[sorted_[i]];
+        }
+    }
+
+    /**
+     * @brief Index the first entry with each key in @p ents, except
+     *        the entries @c i with @p skip[i] nonzero if @p skip is
+     *        not null.
+     *
+     * @return The number of entries which were not indexed because
+     *         they have no key or an earlier entry has the same key.
+     */
+    std::size_t rebuild(const std::vector<BibTeXEntry>& ents,
+                        const std::vector<char>* skip = 0)
+    {
+        clear();
+        reserve(ents.size());
+        std::size_t n_skip = 0;
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            if (skip && (*skip)[i]) {
+                continue;
+            }
+            if (!ents[i].key || !insert(*ents[i].key, i)) {
+                ++n_skip;
+            }
+        }
+        return n_skip;
+    }
+
+    /**
+     * @brief Set the positions in key order to @p ix, e.g. from a
+     *        cache, instead of sorting them in sorted().
+     */
+    void set_sorted(std::vector<std::size_t>& ix)
+    {
+        sorted_.swap(ix);
+        sorted_valid_ = true;
+    }
+
+    /// @brief The positions of all keys in increasing key order.
+    const std::vector<std::size_t>& sorted()
+    {
+        if (!sorted_valid_) {
+            std::vector<const Slot*> p;
+            p.reserve(size_);
+            for (std::size_t i = 0; i < slots_.size(); ++i) {
+                if (slots_[i].ix != npos) {
+                    p.push_back(&slots_[i]);
+                }
+            }
+            std::sort(p.begin(), p.end(),
+                      [](const Slot* a, const Slot* b) {
+                          return a->key < b->key;
+                      });
+            sorted_.resize(p.size());
+            for (std::size_t i = 0; i < p.size(); ++i) {
+                sorted_[i] = p[i]->ix;
+            }
+            sorted_valid_ = true;
+        }
+        return sorted_;
+    }
+
+private:
+
+    /// One key and its position, or an empty slot.
+    struct Slot
+    {
+        Slot()
+            : hash(0), ix(npos)
+        {
+        }
+
+        std::string key;
+        std::uint64_t hash;
+        /// The position, or @ref npos if the slot is empty.
+        std::size_t ix;
+    };
+
+    static std::uint64_t hash(const std::string& key)
+    {
+        return content_hash(key.data(), key.data() + key.size());
+    }
+
+    /// The slot holding @p key, or the empty slot where it belongs.
+    std::size_t locate(const std::string& key, std::uint64_t h) const
+    {
+        std::size_t mask = slots_.size() - 1;
+        std::size_t i = static_cast<std::size_t>(h) & mask;
+        while (slots_[i].ix != npos
+               && (slots_[i].hash != h || slots_[i].key != key)) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    /// Move the keys to a table of @p cap slots, a power of two.
+    void rehash(std::size_t cap)
+    {
+        std::vector<Slot> old(cap);
+        old.swap(slots_);
+        std::size_t mask = cap - 1;
+        for (std::size_t i = 0; i < old.size(); ++i) {
+            if (old[i].ix != npos) {
+                std::size_t j = static_cast<std::size_t>(old[i].hash)
+                    & mask;
+                while (slots_[j].ix != npos) {
+                    j = (j + 1) & mask;
+                }
+                slots_[j] = std::move(old[i]);
+            }
+        }
+    }
+
+    /// The hash table, whose size is zero or a power of two.
+    std::vector<Slot> slots_;
+    /// Number of keys.
+    std::size_t size_;
+    /// The positions in key order, if @ref sorted_valid_.
+    std::vector<std::size_t> sorted_;
+    /// True if @ref sorted_ is up to date.
+    bool sorted_valid_;
+};
+
+} // namespace bibtex
+
+#endif // BT_KEY_INDEX_H
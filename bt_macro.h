@@ -0,0 +1,334 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_macro.h
+    \brief Interned \@string macros and lazy expansion of field values
+*/
+#ifndef BT_MACRO_H
+#define BT_MACRO_H
+
+#pragma once
+
+#include <cctype>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bt_entry.h"
+
+namespace bibtex {
+
+/**
+ * @brief The definition of one @c \@string macro.
+ *
+ * There is one definition object per (case-insensitive) macro
+ * name, shared by every Value which refers to the macro.  The
+ * expansion is computed on first use and cached until the table
+ * which owns the definition changes.
+ */
+struct MacroDef
+{
+    MacroDef()
+        : defined(false), cached(false), expanding(false)
+    {
+    }
+
+    /// Macro name as it first appeared.
+    std::string name;
+    /// Unexpanded components of the definition.
+    ValueVector tokens;
+    /// False if the macro is referenced but was never defined.
+    bool defined;
+
+    /// True if @ref expansion is valid.
+    bool cached;
+    /// Guard against recursive definitions.
+    bool expanding;
+    /// Memoized expansion.
+    std::string expansion;
+};
+
+/**
+ * @brief Return true if @p vals is a single literal component, i.e.
+ *        its text is the value of the field.
+ */
+inline bool is_plain(const ValueVector& vals)
+{
+    return vals.size() == 1 && !vals[0].macro;
+}
+
+/**
+ * @brief Return the expansion of macro @p def.
+ *
+ * An undefined macro, or one whose definition refers back to
+ * itself, expands to its own name, so that such values are kept
+ * rather than lost.  MacroTable does not link such references, so
+ * this only happens for definitions linked by other means.
+ */
+inline const std::string& expand(MacroDef& def);
+
+/**
+ * @brief Append the expansion of @p vals to @p out.
+ */
+inline void expand_append(const ValueVector& vals, std::string& out)
+{
+    for (std::size_t i = 0; i < vals.size(); ++i) {
+        if (vals[i].macro) {
+            out += expand(*vals[i].macro);
+        } else {
+            out += vals[i].text();
+        }
+    }
+}
+
+namespace detail {
+
+/// Number of times expand() met a macro which was being expanded.
+inline unsigned long& expand_cycles()
+{
+    static thread_local unsigned long n = 0;
+    return n;
+}
+
+} // namespace detail
+
+inline const std::string& expand(MacroDef& def)
+{
+    if (!def.cached) {
+        if (!def.defined || def.expanding) {
+            if (def.expanding) {
+                ++detail::expand_cycles();
+            }
+            return def.name;
+        }
+        unsigned long cycles = detail::expand_cycles();
+        def.expanding = true;
+        std::string out;
+        expand_append(def.tokens, out);
+        def.expanding = false;
+        def.expansion.swap(out);
+        // An expansion cut short by a cycle depends on where the
+        // cycle was entered, so it is not kept
+        def.cached = (detail::expand_cycles() == cycles);
+    }
+    return def.expansion;
+}
+
+/**
+ * @brief Compute and cache the expansion of every macro which the
+ *        fields of @p e refer to.
+ *
+ * expand() writes the cache of a MacroDef, which many entries may
+ * share, so this must be called for each entry on one thread before
+ * the entries are read by several threads at once.
+ */
+inline void cache_expansions(const BibTeXEntry& e)
+{
+    for (std::size_t j = 0; j < e.fields.size(); ++j) {
+        const ValueVector& vals = e.fields[j].second;
+        for (std::size_t k = 0; k < vals.size(); ++k) {
+            if (vals[k].macro) {
+                expand(*vals[k].macro);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Return the text of a field value with all macros and
+ *        @c '#' concatenations expanded.
+ */
+inline std::string expand(const ValueVector& vals)
+{
+    if (vals.size() == 1 && !vals[0].macro) {
+        return vals[0].text();
+    }
+    std::string out;
+    expand_append(vals, out);
+    return out;
+}
+
+/**
+ * @brief Return the text of a field value, using @p scratch as
+ *        storage only when the value must be assembled.
+ *
+ * A literal value or a single macro reference is returned without
+ * copying.
+ */
+inline const std::string& expand(const ValueVector& vals,
+                                 std::string& scratch)
+{
+    if (vals.size() == 1) {
+        return vals[0].macro ? expand(*vals[0].macro) : vals[0].text();
+    }
+    scratch.clear();
+    expand_append(vals, scratch);
+    return scratch;
+}
+
+/**
+ * @brief Replace the components of @p vals by a single literal
+ *        component holding their expansion, and return it.
+ *
+ * This is used before a field value is modified in place with
+ * Value::str().  The value vector must not be empty.
+ */
+inline Value& resolve(ValueVector& vals)
+{
+    if (!is_plain(vals)) {
+        Value v(expand(vals));
+        vals.assign(1, v);
+    }
+    return vals[0];
+}
+
+/**
+ * @brief A table of @c \@string macros keyed by their lowercase
+ *        names.
+ *
+ * Each name is interned once: link() points every bare macro
+ * reference in a field at the single MacroDef for that name, so
+ * entries keep their unexpanded components and share one cached
+ * expansion per macro.
+ */
+class MacroTable
+{
+public:
+    /**
+     * @brief Define (or redefine) macro @p name as @p tokens.
+     *
+     * References in @p tokens are linked to this table.  Cached
+     * expansions are discarded, since they may depend on @p name.
+     */
+    void define(const std::string& name, const ValueVector& tokens)
+    {
+        std::shared_ptr<MacroDef> def = intern(name);
+        def->tokens = tokens;
+        def->defined = true;
+        link(def->tokens);
+        // A reference which leads back to this macro, directly or
+        // through other macros, expands to the name it was written
+        // as, and is left unlinked so that the definitions do not
+        // form a reference cycle
+        for (std::size_t i = 0; i < def->tokens.size(); ++i) {
+            if (def->tokens[i].macro
+                && reaches(*def->tokens[i].macro, def.get())) {
+                def->tokens[i].macro.reset();
+            }
+        }
+        for (std::map<std::string, std::shared_ptr<MacroDef> >::iterator
+                 it = table_.begin(); it != table_.end(); ++it) {
+            it->second->cached = false;
+        }
+    }
+
+    /**
+     * @brief Link the bare components of @p vals which name a macro
+     *        defined in this table.
+     *
+     * Bare numbers and names without a definition are left as
+     * literal text.
+     */
+    void link(ValueVector& vals) const
+    {
+        for (std::size_t i = 0; i < vals.size(); ++i) {
+            Value& v = vals[i];
+            if (!v.bare || v.empty()
+                || std::isdigit(static_cast<unsigned char>(v[0]))) {
+                continue;
+            }
+            std::map<std::string, std::shared_ptr<MacroDef> >::
+                const_iterator it = table_.find(lower(v));
+            if (it != table_.end() && it->second->defined) {
+                v.macro = it->second;
+            }
+        }
+    }
+
+    /// @brief Return the definition of @p name, or null.
+    std::shared_ptr<MacroDef> find(const std::string& name) const
+    {
+        std::map<std::string, std::shared_ptr<MacroDef> >::
+            const_iterator it = table_.find(lower(name));
+        return it == table_.end() ? std::shared_ptr<MacroDef>()
+                                  : it->second;
+    }
+
+    /// @brief Number of macros.
+    std::size_t size() const
+    {
+        return table_.size();
+    }
+
+    /// @brief Remove all macros.
+    void clear()
+    {
+        table_.clear();
+    }
+
+private:
+    /**
+     * True if @p from is @p target or its definition refers to
+     * @p target through linked references.  The links never form a
+     * cycle, so the search ends.
+     */
+    static bool reaches(const MacroDef& from, const MacroDef* target)
+    {
+        if (&from == target) {
+            return true;
+        }
+        for (std::size_t i = 0; i < from.tokens.size(); ++i) {
+            if (from.tokens[i].macro
+                && reaches(*from.tokens[i].macro, target)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static std::string lower(const std::string& s)
+    {
+        std::string r(s);
+        for (std::size_t i = 0; i < r.size(); ++i) {
+            r[i] = static_cast<char>(
+                std::tolower(static_cast<unsigned char>(r[i])));
+        }
+        return r;
+    }
+
+    std::shared_ptr<MacroDef> intern(const std::string& name)
+    {
+        std::shared_ptr<MacroDef>& def = table_[lower(name)];
+        if (!def) {
+            def = std::make_shared<MacroDef>();
+            def->name = name;
+        }
+        return def;
+    }
+
+    std::map<std::string, std::shared_ptr<MacroDef> > table_;
+};
+
+} // namespace bibtex
+
+#endif // BT_MACRO_H
@@ -0,0 +1,170 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_mapped_file.h
+    \brief Read-only memory-mapped input files for the BibTeX parser
+*/
+#ifndef BT_MAPPED_FILE_H
+#define BT_MAPPED_FILE_H
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bibtex {
+
+/**
+ * @brief A read-only memory mapping of an entire file.
+ *
+ * The mapped bytes form one contiguous @c const @c char range, so
+ * the X3 grammar in bt_reader.h can run directly over raw pointers
+ * instead of through a buffering @c multi_pass istream iterator.
+ * The class models a Boost.Range, so it can be passed directly to
+ * the range overloads of @c bibtex::read().
+ *
+ * An empty file is a valid, open, zero-length mapping.
+ */
+class MappedFile
+{
+public:
+    typedef const char* iterator;
+    typedef const char* const_iterator;
+
+    MappedFile()
+        : data_(0), size_(0), mapped_(false), open_(false)
+    {
+    }
+
+    /// @brief Map file @p fname; check is_open() for success.
+    explicit MappedFile(const std::string& fname)
+        : data_(0), size_(0), mapped_(false), open_(false)
+    {
+        open(fname);
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /**
+     * @brief Map file @p fname, unmapping any previous file.
+     *
+     * @return @c false if the file could not be opened or mapped.
+     */
+    bool open(const std::string& fname)
+    {
+        close();
+
+        int fd = ::open(fname.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = ::mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            // The parser makes a single forward pass over the file
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+            mapped_ = true;
+        }
+
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        open_ = true;
+        return true;
+    }
+
+    /// @brief Unmap the file, if any.
+    void close()
+    {
+        if (mapped_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+        data_ = 0;
+        size_ = 0;
+        mapped_ = false;
+        open_ = false;
+    }
+
+    /// @brief Return @c true if a file is currently mapped.
+    bool is_open() const
+    {
+        return open_;
+    }
+
+    /// @brief Pointer to the first mapped byte.
+    const char* begin() const
+    {
+        return mapped_ ? data_ : empty();
+    }
+
+    /// @brief Pointer one past the last mapped byte.
+    const char* end() const
+    {
+        return begin() + size_;
+    }
+
+    /// @brief Number of mapped bytes.
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    /// Non-null pointer used for empty files
+    static const char* empty()
+    {
+        static const char c = '\0';
+        return &c;
+    }
+
+    const char* data_;
+    std::size_t size_;
+    bool mapped_;
+    bool open_;
+};
+
+} // namespace bibtex
+
+#endif // BT_MAPPED_FILE_H
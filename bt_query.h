@@ -0,0 +1,581 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_query.h
+    \brief Glob patterns compiled to automata and searches over the
+    fields of a list of entries
+*/
+#ifndef BT_QUERY_H
+#define BT_QUERY_H
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fnmatch.h>
+
+#include "bt_columns.h"
+#include "bt_entry.h"
+#include "bt_macro.h"
+
+namespace bibtex {
+
+/**
+ * @brief A glob pattern, with the syntax of @c fnmatch() without
+ *        flags, compiled to a deterministic automaton.
+ *
+ * The pattern is first split into items which match one byte from
+ * a set (a literal, @c ? or a bracket expression) or any sequence
+ * (@c *).  The automaton, whose states are the sets of items which
+ * can be reached, is built once with the bytes grouped into classes
+ * which no item distinguishes.  Matching then reads each byte of the
+ * text once, with one table lookup, and stops as soon as the result
+ * no longer depends on the rest of the text, e.g. after the last
+ * literal of @c *Smith*.
+ *
+ * Patterns whose automaton would have more than @ref max_states
+ * states are matched with @c fnmatch() instead.
+ */
+class GlobMatcher
+{
+public:
+
+    /// Largest number of states of an automaton.
+    static constexpr std::size_t max_states = 4096;
+
+    GlobMatcher()
+    {
+        compile("");
+    }
+
+    explicit GlobMatcher(const std::string& pattern, bool icase = false)
+    {
+        compile(pattern, icase);
+    }
+
+    /// @brief The pattern.
+    const std::string& pattern() const
+    {
+        return pattern_;
+    }
+
+    /**
+     * @brief Compile @p pattern, replacing the previous one.
+     *
+     * If @p icase is true, letters match both cases.  Since this
+     * only adds bytes to the sets of the items, it costs nothing
+     * when matching.
+     */
+    void compile(const std::string& pattern, bool icase = false)
+    {
+        pattern_ = pattern;
+        icase_ = icase;
+        std::vector<Item> items;
+        parse(pattern, items);
+        if (icase) {
+            for (std::size_t k = 0; k < items.size(); ++k) {
+                std::vector<char>& set = items[k].set;
+                for (int c = 0; c < 256; ++c) {
+                    if (set[c]) {
+                        set[std::tolower(c)] = 1;
+                        set[std::toupper(c)] = 1;
+                    }
+                }
+            }
+        }
+        build(items);
+    }
+
+    /// @brief True if the null-terminated text @p s matches.
+    bool matches(const char* s) const
+    {
+        if (fallback_) {
+            return fnmatch(pattern_.c_str(), s, icase_ ? FNM_CASEFOLD : 0)
+                == 0;
+        }
+        std::size_t st = start_;
+        while (st < n_run_) {
+            if (skip_[st] != 0) {
+                s = std::strchr(s, skip_[st]);
+                if (!s) {
+                    break;
+                }
+            } else if (*s == '\0') {
+                break;
+            }
+            st = trans_[st * n_classes_
+                        + class_[static_cast<unsigned char>(*s)]];
+            ++s;
+        }
+        return accept_[st] != 0;
+    }
+
+    /// @brief True if the text @p s matches.
+    bool matches(const std::string& s) const
+    {
+        return matches(s.c_str());
+    }
+
+private:
+
+    /// One byte from @ref set, or any sequence if @ref star.
+    struct Item
+    {
+        Item()
+            : star(false), set(256, 0)
+        {
+        }
+
+        bool star;
+        std::vector<char> set;
+    };
+
+    /// Split @p p into items, as @c fnmatch() does.
+    static void parse(const std::string& p, std::vector<Item>& items)
+    {
+        for (std::size_t i = 0; i < p.size(); ++i) {
+            Item it;
+            if (p[i] == '*') {
+                if (!items.empty() && items.back().star) {
+                    continue;
+                }
+                it.star = true;
+            } else if (p[i] == '?') {
+                it.set.assign(256, 1);
+            } else if (p[i] == '[' && parse_bracket(p, i, it.set)) {
+                // i now points to the closing bracket
+            } else if (p[i] == '\\' && i + 1 == p.size()) {
+                // A trailing backslash matches nothing
+            } else {
+                if (p[i] == '\\') {
+                    ++i;
+                }
+                it.set[static_cast<unsigned char>(p[i])] = 1;
+            }
+            items.push_back(it);
+        }
+    }
+
+    /**
+     * Parse the bracket expression starting at @p p[i], setting
+     * @p i to its closing bracket.  Return @c false if it is not
+     * closed, in which case the bracket is a literal.
+     */
+    static bool parse_bracket(const std::string& p, std::size_t& i,
+                              std::vector<char>& set)
+    {
+        std::size_t j = i + 1;
+        bool negate = false;
+        if (j < p.size() && (p[j] == '!' || p[j] == '^')) {
+            negate = true;
+            ++j;
+        }
+        std::vector<char> s(256, 0);
+        bool first = true;
+        for (; j < p.size(); ++j) {
+            if (p[j] == ']' && !first) {
+                for (int c = 0; c < 256; ++c) {
+                    set[c] = (s[c] != 0) != negate;
+                }
+                i = j;
+                return true;
+            }
+            first = false;
+            if (p[j] == '[' && j + 1 < p.size() && p[j + 1] == ':') {
+                std::size_t e = p.find(":]", j + 2);
+                if (e != std::string::npos
+                    && add_class(p.substr(j + 2, e - j - 2), s)) {
+                    j = e + 1;
+                    continue;
+                }
+            }
+            unsigned char lo = static_cast<unsigned char>(p[j]);
+            if (p[j] == '\\' && j + 1 < p.size()) {
+                lo = static_cast<unsigned char>(p[++j]);
+            }
+            unsigned char hi = lo;
+            if (j + 2 < p.size() && p[j + 1] == '-' && p[j + 2] != ']') {
+                j += 2;
+                if (p[j] == '\\' && j + 1 < p.size()) {
+                    ++j;
+                }
+                hi = static_cast<unsigned char>(p[j]);
+            }
+            for (int c = lo; c <= hi; ++c) {
+                s[c] = 1;
+            }
+        }
+        return false;
+    }
+
+    /// Add the bytes of the class @c [:name:] to @p s.
+    static bool add_class(const std::string& name, std::vector<char>& s)
+    {
+        static const char* names[] = {
+            "alnum", "alpha", "blank", "cntrl", "digit", "graph",
+            "lower", "print", "punct", "space", "upper", "xdigit"
+        };
+        static int (*const tests[])(int) = {
+            isalnum, isalpha, isblank, iscntrl, isdigit, isgraph,
+            islower, isprint, ispunct, isspace, isupper, isxdigit
+        };
+        for (std::size_t k = 0; k < sizeof(names) / sizeof(names[0]);
+             ++k) {
+            if (name == names[k]) {
+                for (int c = 0; c < 256; ++c) {
+                    if (tests[k](c)) {
+                        s[c] = 1;
+                    }
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Add item @p p, and the items after it if it is a star, to @p s.
+    static void close(const std::vector<Item>& items, std::size_t p,
+                      std::string& s)
+    {
+        for (; p <= items.size(); ++p) {
+            s[p] = 1;
+            if (p == items.size() || !items[p].star) {
+                break;
+            }
+        }
+    }
+
+    /// Build the automaton of @p items by subset construction.
+    void build(const std::vector<Item>& items)
+    {
+        fallback_ = false;
+        trans_.clear();
+        accept_.clear();
+        skip_.clear();
+
+        // Group the bytes which every item treats in the same way
+        std::map<std::string, unsigned char> classes;
+        for (int c = 0; c < 256; ++c) {
+            std::string sig;
+            for (std::size_t k = 0; k < items.size(); ++k) {
+                if (!items[k].star) {
+                    sig += items[k].set[c];
+                }
+            }
+            std::map<std::string, unsigned char>::iterator it =
+                classes.find(sig);
+            if (it == classes.end()) {
+                it = classes.insert(std::make_pair(
+                    sig, static_cast<unsigned char>(classes.size()))).first;
+            }
+            class_[c] = it->second;
+        }
+        n_classes_ = classes.size();
+        std::vector<int> rep(n_classes_);
+        for (int c = 255; c >= 0; --c) {
+            rep[class_[c]] = c;
+        }
+
+        // Each state is the set of items reached, as one byte per
+        // item plus one for the end of the pattern
+        std::vector<std::string> states;
+        std::map<std::string, std::size_t> ids;
+        std::string s(items.size() + 1, 0);
+        close(items, 0, s);
+        states.push_back(s);
+        ids[s] = 0;
+        for (std::size_t st = 0; st < states.size(); ++st) {
+            if (states.size() > max_states) {
+                fallback_ = true;
+                return;
+            }
+            for (std::size_t k = 0; k < n_classes_; ++k) {
+                std::string next(items.size() + 1, 0);
+                for (std::size_t p = 0; p < items.size(); ++p) {
+                    if (!states[st][p]) {
+                        continue;
+                    }
+                    if (items[p].star) {
+                        close(items, p, next);
+                    } else if (items[p].set[rep[k]]) {
+                        close(items, p + 1, next);
+                    }
+                }
+                std::map<std::string, std::size_t>::iterator it =
+                    ids.find(next);
+                if (it == ids.end()) {
+                    it = ids.insert(std::make_pair(next,
+                                                   states.size())).first;
+                    states.push_back(next);
+                }
+                trans_.push_back(it->second);
+            }
+        }
+
+        // A state which only leads to itself decides the result.
+        // These states are numbered last, so that matching stops
+        // at the first state number which is at least n_run_.
+        std::size_t n = states.size();
+        std::vector<char> stops(n, 1);
+        for (std::size_t st = 0; st < n; ++st) {
+            for (std::size_t k = 0; k < n_classes_; ++k) {
+                if (trans_[st * n_classes_ + k] != st) {
+                    stops[st] = 0;
+                }
+            }
+        }
+        std::vector<std::size_t> order;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (std::size_t st = 0; st < n; ++st) {
+                if (stops[st] == pass) {
+                    order.push_back(st);
+                }
+            }
+            if (pass == 0) {
+                n_run_ = order.size();
+            }
+        }
+        std::vector<std::size_t> id(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            id[order[k]] = k;
+        }
+        start_ = id[0];
+
+        // The number of bytes in each class, other than the null
+        // character which ends the text
+        std::vector<int> class_size(n_classes_, 0);
+        for (int c = 1; c < 256; ++c) {
+            ++class_size[class_[c]];
+        }
+
+        // A state which leaves itself only on one byte skips to it
+        std::vector<std::size_t> old;
+        old.swap(trans_);
+        trans_.resize(old.size());
+        accept_.resize(n);
+        skip_.assign(n, 0);
+        for (std::size_t k = 0; k < n; ++k) {
+            std::size_t st = order[k];
+            accept_[k] = states[st][items.size()];
+            std::size_t n_out = 0, out = 0;
+            for (std::size_t c = 0; c < n_classes_; ++c) {
+                trans_[k * n_classes_ + c] = id[old[st * n_classes_ + c]];
+                if (old[st * n_classes_ + c] != st) {
+                    ++n_out;
+                    out = c;
+                }
+            }
+            if (n_out == 1 && class_size[out] == 1) {
+                for (int c = 1; c < 256; ++c) {
+                    if (class_[c] == out) {
+                        skip_[k] = static_cast<char>(c);
+                    }
+                }
+            }
+        }
+    }
+
+    /// The pattern, used by @c fnmatch() if @ref fallback_.
+    std::string pattern_;
+    /// True if letters match both cases.
+    bool icase_;
+    /// True if the automaton has too many states.
+    bool fallback_;
+    /// The class of each byte.
+    unsigned char class_[256];
+    /// Number of byte classes.
+    std::size_t n_classes_;
+    /// The next state for each state and byte class.
+    std::vector<std::size_t> trans_;
+    /// Nonzero for the accepting states.
+    std::vector<char> accept_;
+    /// The only byte on which a state changes, or zero.
+    std::vector<char> skip_;
+    /// The first state.
+    std::size_t start_;
+    /// The number of states which do not only lead to themselves.
+    std::size_t n_run_;
+};
+
+/**
+ * @brief A search for entries whose fields match glob patterns,
+ *        compiled once and evaluated in one pass over the entries.
+ *
+ * Each term of the query is a field name, resolved to a folded
+ * Symbol so that fields are compared by address, and a GlobMatcher.
+ * The field name @c key refers to the key of the entry.  An entry
+ * matches a term if any field with that name matches the pattern,
+ * and matches the query if it matches any term (@ref any) or every
+ * term (@ref all).  The terms are tried in order and the others are
+ * skipped once the result is known.
+ */
+class Query
+{
+public:
+
+    /// How the terms are combined.
+    enum Mode
+    {
+        any,
+        all
+    };
+
+    explicit Query(Mode mode = any)
+        : mode_(mode)
+    {
+    }
+
+    /// @brief Add the term field @p field matches @p pattern.
+    void add(const std::string& field, const std::string& pattern)
+    {
+        Term t;
+        t.field = Symbol(field).folded();
+        t.is_key = (t.field == "key");
+        t.glob.compile(pattern);
+        terms_.push_back(t);
+    }
+
+    /// @brief Number of terms.
+    std::size_t size() const
+    {
+        return terms_.size();
+    }
+
+    /// @brief True if entry @p e matches the query.
+    bool matches(const BibTeXEntry& e, std::string& scratch) const
+    {
+        for (std::size_t k = 0; k < terms_.size(); ++k) {
+            if (term_matches(terms_[k], e, scratch) == (mode_ == any)) {
+                return mode_ == any;
+            }
+        }
+        return mode_ == all;
+    }
+
+    /**
+     * @brief Set @p match[i] to 1 for each entry @c i of @p ents
+     *        which matches the query, and to 0 for the others.
+     *
+     * If @p subset is not null, only the entries with the indexes in
+     * @p subset, in increasing order, are considered and the others
+     * are left unchanged.  If @p columns is not null, the values of
+     * fields which occur once in an entry are read from its columns
+     * instead of from the entries.
+     */
+    void evaluate(const std::vector<BibTeXEntry>& ents,
+                  std::vector<char>& match,
+                  const std::vector<std::size_t>* subset = 0,
+                  ColumnStore* columns = 0) const
+    {
+        std::size_t n = (subset ? subset->size() : ents.size());
+        std::string scratch;
+        if (!columns) {
+            for (std::size_t k = 0; k < n; ++k) {
+                std::size_t i = (subset ? (*subset)[k] : k);
+                match[i] = matches(ents[i], scratch);
+            }
+            return;
+        }
+
+        // The column of each term, and the position in its list of
+        // repeated fields
+        std::vector<const ColumnStore::Column*> cols(terms_.size(), 0);
+        std::vector<std::size_t> rep(terms_.size(), 0);
+        for (std::size_t t = 0; t < terms_.size(); ++t) {
+            if (!terms_[t].is_key) {
+                cols[t] = &columns->column(terms_[t].field.str(), ents);
+            }
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            std::size_t i = (subset ? (*subset)[k] : k);
+            bool m = (mode_ == all);
+            for (std::size_t t = 0; t < terms_.size(); ++t) {
+                const ColumnStore::Column* c = cols[t];
+                bool tm;
+                if (c) {
+                    while (rep[t] < c->repeated.size()
+                           && c->repeated[rep[t]] < i) {
+                        ++rep[t];
+                    }
+                }
+                if (!c || (rep[t] < c->repeated.size()
+                           && c->repeated[rep[t]] == i)) {
+                    tm = term_matches(terms_[t], ents[i], scratch);
+                } else {
+                    tm = c->offset[i] != ColumnStore::npos
+                        && terms_[t].glob.matches(
+                            columns->text(c->offset[i]));
+                }
+                if (tm == (mode_ == any)) {
+                    m = !m;
+                    break;
+                }
+            }
+            match[i] = m;
+        }
+    }
+
+private:
+
+    /// A field name and a pattern.
+    struct Term
+    {
+        Term()
+            : is_key(false)
+        {
+        }
+
+        /// The folded field name.
+        Symbol field;
+        /// True if the term refers to the key.
+        bool is_key;
+        GlobMatcher glob;
+    };
+
+    static bool term_matches(const Term& t, const BibTeXEntry& e,
+                             std::string& scratch)
+    {
+        if (t.is_key) {
+            return e.key && t.glob.matches(*e.key);
+        }
+        for (std::size_t j = 0; j < e.fields.size(); ++j) {
+            if (e.fields[j].first.equal_folded(t.field)
+                && t.glob.matches(expand(e.fields[j].second, scratch))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Mode mode_;
+    std::vector<Term> terms_;
+};
+
+} // namespace bibtex
+
+#endif // BT_QUERY_H
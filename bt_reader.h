@@ -47,8 +47,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <istream>
+#include <iterator>
 #include <numeric>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <boost/variant.hpp>
 #include <string>
@@ -132,11 +146,18 @@ struct AssignBody
         typedef boost::fusion::vector<
             boost::optional<std::string>,
             KeyValueVector> BodyAttr;
-        BodyAttr const& b = x3::_attr(ctx);
+        BodyAttr& b = x3::_attr(ctx);
         x3::_val(ctx).key    = boost::fusion::at_c<0>(b)
-                                   ? *boost::fusion::at_c<0>(b)
+                                   ? std::move(*boost::fusion::at_c<0>(b))
                                    : std::string();
-        x3::_val(ctx).fields = boost::fusion::at_c<1>(b);
+        // Copy the fields to a list of the exact size, since the
+        // list built by the parser has grown by doubling
+        KeyValueVector& fields = boost::fusion::at_c<1>(b);
+        x3::_val(ctx).fields.clear();
+        x3::_val(ctx).fields.reserve(fields.size());
+        x3::_val(ctx).fields.insert(x3::_val(ctx).fields.end(),
+                                    std::make_move_iterator(fields.begin()),
+                                    std::make_move_iterator(fields.end()));
     }
 };
 
@@ -219,7 +240,7 @@ typedef x3::rule<InnerQuoteTextId, std::string> InnerQuoteTextRule;
 typedef x3::rule<QuotedId, std::string>    QuotedRule;
 
 /// @brief Matches a single field value component.
-typedef x3::rule<ValueId, std::string>     ValueRule;
+typedef x3::rule<ValueId, Value>           ValueRule;
 
 /// @brief Matches a @c '#'-concatenated list of values.
 typedef x3::rule<ValuesId, ValueVector>    ValuesRule;
@@ -365,10 +386,202 @@ inline auto const quoted_def =
         | ('{' >> *innerBraceText >> '}')
     ][AccumulateStrings()];
 
+//------------------------------------------------------------------
+// Fast path for quoted values in contiguous buffers
+//------------------------------------------------------------------
+
+/// @brief True for the characters which stop findSpecial().
+inline bool isSpecial(char c)
+{
+    return c == '{' || c == '}' || c == '"' || c == '\\';
+}
+
+/**
+ * @brief Return a pointer to the first @c {, @c }, @c " or
+ *        backslash in [@p p, @p last), or @p last if there is none.
+ *
+ * Compares 32 (AVX2) or 16 (SSE2) bytes at a time when the compiler
+ * targets those instruction sets, with a scalar loop for the tail
+ * and for other targets.
+ */
+inline const char* findSpecial(const char* p, const char* last)
+{
+#if defined(__AVX2__)
+    const __m256i lb = _mm256_set1_epi8('{');
+    const __m256i rb = _mm256_set1_epi8('}');
+    const __m256i qu = _mm256_set1_epi8('"');
+    const __m256i bs = _mm256_set1_epi8('\\');
+    while (last - p >= 32) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(p));
+        __m256i m = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, lb),
+                            _mm256_cmpeq_epi8(v, rb)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, qu),
+                            _mm256_cmpeq_epi8(v, bs)));
+        unsigned bits = static_cast<unsigned>(_mm256_movemask_epi8(m));
+        if (bits != 0) {
+            return p + __builtin_ctz(bits);
+        }
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i lb = _mm_set1_epi8('{');
+    const __m128i rb = _mm_set1_epi8('}');
+    const __m128i qu = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    while (last - p >= 16) {
+        __m128i v = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(p));
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, lb),
+                         _mm_cmpeq_epi8(v, rb)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, qu),
+                         _mm_cmpeq_epi8(v, bs)));
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(m));
+        if (bits != 0) {
+            return p + __builtin_ctz(bits);
+        }
+        p += 16;
+    }
+#endif
+    while (p != last && !isSpecial(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+/**
+ * @brief Find the end of the quoted value beginning at @p first.
+ *
+ * Handles the common case in which the value of the @c quoted rule
+ * is its text between the outer delimiters, unchanged: balanced
+ * braces, and no construct which the grammar decodes or treats
+ * specially (escaped braces, escaped quotes, or a quote inside
+ * braces within a quoted value).
+ *
+ * @return A pointer to the closing delimiter, or null if the value
+ *         must be left to the grammar.
+ */
+inline const char* scanQuoted(const char* first, const char* last)
+{
+    const bool quote = (*first == '"');
+    long depth = 0;
+    const char* p = first + 1;
+    for (;;) {
+        p = findSpecial(p, last);
+        if (p == last) {
+            return 0;
+        }
+        switch (*p) {
+        case '{':
+            ++depth;
+            break;
+        case '}':
+            if (depth == 0) {
+                return quote ? 0 : p;
+            }
+            --depth;
+            break;
+        case '"':
+            if (quote) {
+                if (depth == 0) {
+                    return p;
+                }
+                return 0;
+            }
+            break;
+        default:
+            // Backslash: only escapes which the grammar decodes
+            // need the slow path
+            if (quote || (p + 1 != last
+                          && (p[1] == '{' || p[1] == '}'))) {
+                return 0;
+            }
+            break;
+        }
+        ++p;
+    }
+}
+
+/**
+ * @brief Parser equivalent to the @c quoted rule which scans values
+ *        in @c const @c char* input with scanQuoted() and falls back
+ *        to the @c quoted rule for other input and unusual values.
+ */
+struct FastQuotedParser : x3::parser<FastQuotedParser>
+{
+    typedef std::string attribute_type;
+    static bool const has_attribute = true;
+
+    template<typename Iterator, typename Context,
+             typename RContext, typename Attribute>
+    bool parse(Iterator& first, Iterator const& last,
+               Context const& ctx, RContext& rctx,
+               Attribute& attr) const
+    {
+        return parseImpl(first, last, ctx, rctx, attr,
+                         std::is_same<Iterator, const char*>());
+    }
+
+private:
+    template<typename Iterator, typename Context,
+             typename RContext, typename Attribute>
+    bool parseImpl(Iterator& first, Iterator const& last,
+                   Context const& ctx, RContext& rctx,
+                   Attribute& attr, std::true_type) const
+    {
+        const char* it = first;
+        x3::skip_over(it, last, ctx);
+        if (it != last && (*it == '{' || *it == '"')) {
+            const char* end = scanQuoted(it, last);
+            if (end) {
+                x3::traits::move_to(std::string(it + 1, end), attr);
+                first = end + 1;
+                return true;
+            }
+        }
+        return quoted.parse(first, last, ctx, rctx, attr);
+    }
+
+    template<typename Iterator, typename Context,
+             typename RContext, typename Attribute>
+    bool parseImpl(Iterator& first, Iterator const& last,
+                   Context const& ctx, RContext& rctx,
+                   Attribute& attr, std::false_type) const
+    {
+        return quoted.parse(first, last, ctx, rctx, attr);
+    }
+};
+
+inline FastQuotedParser const fastQuoted = FastQuotedParser();
+
+/// @brief Stores a delimited value, marking it as not bare.
+struct AssignQuotedValue
+{
+    /// @param ctx X3 parse context carrying a @c std::string attr.
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        x3::_val(ctx) = Value(std::move(x3::_attr(ctx)), false);
+    }
+};
+
+/// @brief Stores an undelimited value, marking it as bare.
+struct AssignBareValue
+{
+    /// @param ctx X3 parse context carrying a @c std::string attr.
+    template<typename Context>
+    void operator()(Context& ctx) const
+    {
+        x3::_val(ctx) = Value(std::move(x3::_attr(ctx)), true);
+    }
+};
+
 /// @brief A single value: quoted string or bare non-delimiter text.
 inline auto const value_def =
-    quoted
-    | +~x3::char_(",})#");
+    fastQuoted[AssignQuotedValue()]
+    | (+~x3::char_(",})#"))[AssignBareValue()];
 
 /// @brief A @c '#'-separated sequence of values.
 inline auto const values_def =
@@ -682,6 +895,723 @@ inline bool read(std::basic_istream<E, T>& in, Container& entries)
     return read(istream_iterator(in), istream_iterator(), entries);
 }
 
+//------------------------------------------------------------------
+// Reading with diagnostics
+//------------------------------------------------------------------
+
+/**
+ * @brief Location of an entry which could not be parsed.
+ */
+struct ParseError
+{
+    /// Byte offset of the entry's @c \@ from the start of the input.
+    std::size_t offset;
+    /// Line number (starting at 1) of the entry's @c \@.
+    std::size_t line;
+    /// Column number (starting at 1) of the entry's @c \@.
+    std::size_t column;
+    /// The beginning of the line at which the entry starts.
+    std::string text;
+};
+
+/**
+ * @brief The source bytes of one parsed entry.
+ *
+ * The span of an entry starts where the parse of the previous entry
+ * stopped (or at the start of the input) and so includes any junk,
+ * comments and whitespace before the entry.  Consecutive spans are
+ * therefore contiguous.
+ */
+struct EntrySpan
+{
+    /// Byte offset of the span from the start of the input.
+    std::size_t offset;
+    /// Length of the span in bytes.
+    std::size_t length;
+    /// content_hash() of the bytes in the span.
+    std::uint64_t hash;
+};
+
+/**
+ * @brief Return a 64-bit hash of the bytes in [@p first, @p last).
+ *
+ * The input is consumed eight bytes at a time, so hashing a file is
+ * much cheaper than parsing it.  The hash is not cryptographic; it
+ * is used to detect which parts of a file have changed.
+ */
+inline std::uint64_t content_hash(const char* first, const char* last)
+{
+    const std::uint64_t k1 = 0x9e3779b97f4a7c15ULL;
+    const std::uint64_t k2 = 0xc2b2ae3d27d4eb4fULL;
+    std::uint64_t h = k2 ^ static_cast<std::uint64_t>(last - first);
+    while (last - first >= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, first, 8);
+        w *= k1;
+        w = (w << 31) | (w >> 33);
+        h = (h ^ (w * k2)) * k1;
+        first += 8;
+    }
+    std::uint64_t w = 0;
+    std::memcpy(&w, first, static_cast<std::size_t>(last - first));
+    h = (h ^ (w * k2)) * k1;
+    h ^= h >> 29;
+    h *= k2;
+    h ^= h >> 32;
+    return h;
+}
+
+namespace detail {
+
+/**
+ * @brief Parse entries from @p it one at a time, recording the span
+ *        of each relative to @p base, until an entry fails to parse.
+ *
+ * This is equivalent to parsing <tt>*start</tt>: on return @p it is
+ * where that parse would have stopped.
+ */
+template<class Container>
+inline void parseSpans(const char* base, const char*& it,
+                       const char* last, Container& entries,
+                       std::vector<EntrySpan>& spans)
+{
+    for (;;) {
+        const char* b = it;
+        BibTeXEntry e;
+        if (!x3::phrase_parse(it, last, start, bibtex::space, e)) {
+            it = b;
+            return;
+        }
+        EntrySpan sp;
+        sp.offset = static_cast<std::size_t>(b - base);
+        sp.length = static_cast<std::size_t>(it - b);
+        sp.hash = content_hash(b, it);
+        spans.push_back(sp);
+        entries.push_back(std::move(e));
+    }
+}
+
+/**
+ * @brief Return the first @c \@ after @p p which starts a line,
+ *        ignoring leading spaces and tabs, or @p last if there is
+ *        none.
+ */
+inline const char* nextEntryStart(const char* p, const char* last)
+{
+    bool line_start = false;
+    for (; p != last; ++p) {
+        char c = *p;
+        if (c == '\n') {
+            line_start = true;
+        } else if (c == '@' && line_start) {
+            return p;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            line_start = false;
+        }
+    }
+    return last;
+}
+
+} // namespace detail
+
+/**
+ * @brief Parse all BibTeX entries from a contiguous buffer,
+ *        recording the location of each entry which fails to parse.
+ *
+ * Where read() silently stops at the first entry which does not
+ * parse, this function appends a ParseError for it to @p errors.
+ * If @p resync is true, parsing then continues from the next
+ * @c \@ at the start of a line, so that a single pass returns
+ * every recoverable entry.  If @p resync is false, parsing stops
+ * and @p entries is identical to the result of read().
+ *
+ * @param  first    Begin of input buffer.
+ * @param  last     End of input buffer.
+ * @param  entries  Output container.
+ * @param  errors   Output: appended to for each failure.
+ * @param  resync   If true, continue after a failure.
+ * @param  spans    If not null, appended to with the span of each
+ *                  entry (see EntrySpan), relative to @p first.
+ * @return @c true if no entry failed to parse.
+ */
+template<class Container>
+inline bool read_with_errors(const char* first,
+                             const char* last,
+                             Container& entries,
+                             std::vector<ParseError>& errors,
+                             bool resync = true,
+                             std::vector<EntrySpan>* spans = 0)
+{
+    bool ret = true;
+    const char* it = first;
+    // Line bookkeeping is incremental so each byte is counted once
+    const char* counted = first;
+    std::size_t line = 1;
+    const char* line_begin = first;
+
+    while (it != last) {
+        if (spans) {
+            detail::parseSpans(first, it, last, entries, *spans);
+        } else {
+            x3::phrase_parse(it, last, *detail::start,
+                             bibtex::space, entries);
+        }
+        x3::phrase_parse(it, last, detail::junk, bibtex::space);
+        if (it == last) {
+            break;
+        }
+
+        // The entry at 'it' failed to parse
+        ret = false;
+        for (; counted != it; ++counted) {
+            if (*counted == '\n') {
+                ++line;
+                line_begin = counted + 1;
+            }
+        }
+        ParseError err;
+        err.offset = static_cast<std::size_t>(it - first);
+        err.line = line;
+        err.column = static_cast<std::size_t>(it - line_begin) + 1;
+        const char* eol = it;
+        while (eol != last && *eol != '\n' && *eol != '\r'
+               && eol - it < 60) {
+            ++eol;
+        }
+        err.text.assign(it, eol);
+        errors.push_back(err);
+
+        if (!resync) {
+            break;
+        }
+        it = detail::nextEntryStart(it, last);
+    }
+    return ret;
+}
+
+//------------------------------------------------------------------
+// Parallel read() over a contiguous buffer
+//------------------------------------------------------------------
+
+namespace detail {
+
+/**
+ * @brief Find the first candidate entry boundary at or after @p from.
+ *
+ * A candidate is an @c \@ at the start of a line (or of the buffer)
+ * with zero brace depth, counted from @p first.  Escaped braces
+ * (@c \{ and @c \}) do not change the depth.
+ *
+ * @param  first  Begin of the buffer; depth is counted from here.
+ * @param  last   End of the buffer.
+ * @param  from   Position from which a boundary may be returned.
+ * @param  depth  In/out: brace depth at @p first on entry, depth at
+ *                the returned position on exit.
+ * @param  scan   In/out: position up to which @p depth is valid.
+ * @return The boundary, or @p last if none was found.
+ */
+inline const char* nextBoundary(const char* first, const char* last,
+                                const char* from, long& depth,
+                                const char*& scan)
+{
+    for (const char* p = scan; p != last; ++p) {
+        char c = *p;
+        if (c == '\\' && p + 1 != last
+            && (p[1] == '{' || p[1] == '}')) {
+            ++p;
+        } else if (c == '{') {
+            ++depth;
+        } else if (c == '}') {
+            --depth;
+        } else if (c == '@' && depth == 0 && p >= from
+                   && (p == first || p[-1] == '\n')) {
+            scan = p + 1;
+            return p;
+        }
+    }
+    scan = last;
+    return last;
+}
+
+} // namespace detail
+
+/**
+ * @brief Parse all BibTeX entries from a contiguous buffer using
+ *        several threads.
+ *
+ * The buffer is split into roughly equal chunks at candidate entry
+ * boundaries (see detail::nextBoundary()) and each chunk is parsed
+ * with the same grammar on its own thread.  The per-chunk results
+ * are appended to @p entries in buffer order.
+ *
+ * The result is identical to the serial read().  A chunk is only
+ * accepted if everything after its last entry is junk, i.e. the
+ * serial parse would have continued into the next chunk at the
+ * same boundary.  Otherwise (for example when a boundary was found
+ * inside a parenthesised entry, or when an entry fails to parse)
+ * the remainder of the buffer is parsed serially from the start of
+ * the offending chunk.
+ *
+ * If @p errors is not null, failures are handled and recorded as
+ * in read_with_errors(), and the result is identical to that
+ * function.
+ *
+ * @param  first     Begin of input buffer.
+ * @param  last      End of input buffer.
+ * @param  entries   Output container.
+ * @param  nthreads  Number of threads (values below 2 parse serially).
+ * @param  errors    If not null, output list of parse failures.
+ * @param  resync    If true, continue after a failure (used only
+ *                   when @p errors is not null).
+ * @param  spans     If not null, appended to with the span of each
+ *                   entry as in read_with_errors().  This requires
+ *                   @p errors to be non-null.
+ * @return @c true on success.
+ */
+template<class Container>
+inline bool read_parallel(const char* first,
+                          const char* last,
+                          Container& entries,
+                          unsigned nthreads,
+                          std::vector<ParseError>* errors = 0,
+                          bool resync = true,
+                          std::vector<EntrySpan>* spans = 0)
+{
+    std::size_t size = static_cast<std::size_t>(last - first);
+    if (nthreads < 2 || size < 2 * nthreads) {
+        if (errors) {
+            return read_with_errors(first, last, entries,
+                                    *errors, resync, spans);
+        }
+        return read(first, last, entries);
+    }
+
+    std::size_t span0 = spans ? spans->size() : 0;
+
+    // Choose chunk boundaries
+    std::vector<const char*> bounds(1, first);
+    long depth = 0;
+    const char* scan = first;
+    for (unsigned i = 1; i < nthreads; ++i) {
+        const char* target = first + size / nthreads * i;
+        if (target <= bounds.back()) {
+            continue;
+        }
+        const char* b =
+            detail::nextBoundary(first, last, target, depth, scan);
+        if (b == last) {
+            break;
+        }
+        bounds.push_back(b);
+    }
+    bounds.push_back(last);
+
+    std::size_t nchunks = bounds.size() - 1;
+    if (nchunks < 2) {
+        if (errors) {
+            return read_with_errors(first, last, entries,
+                                    *errors, resync, spans);
+        }
+        return read(first, last, entries);
+    }
+
+    // Parse each chunk, recording whether it was fully consumed
+    std::vector<std::vector<BibTeXEntry> > parts(nchunks);
+    std::vector<std::vector<EntrySpan> > part_spans(nchunks);
+    std::vector<char> complete(nchunks, 0);
+    std::vector<std::thread> workers;
+    workers.reserve(nchunks);
+    for (std::size_t i = 0; i < nchunks; ++i) {
+        workers.push_back(std::thread([&, i]() {
+            const char* it = bounds[i];
+            const char* end = bounds[i + 1];
+            if (spans) {
+                detail::parseSpans(first, it, end, parts[i],
+                                   part_spans[i]);
+            } else {
+                x3::phrase_parse(it, end, *detail::start,
+                                 bibtex::space, parts[i]);
+            }
+            x3::phrase_parse(it, end, detail::junk, bibtex::space);
+            complete[i] = (it == end);
+        }));
+    }
+    for (std::size_t i = 0; i < nchunks; ++i) {
+        workers[i].join();
+    }
+
+    // Concatenate in order, finishing serially after the first
+    // chunk which did not parse as the serial parse would have
+    bool ret = true;
+    for (std::size_t i = 0; i < nchunks; ++i) {
+        if (!complete[i] && (i + 1 < nchunks || errors)) {
+            std::vector<BibTeXEntry> rest;
+            if (errors) {
+                // Report locations relative to the whole buffer;
+                // chunks begin at line starts, so columns are
+                // already correct
+                std::vector<ParseError> errs;
+                std::vector<EntrySpan> rest_spans;
+                ret = read_with_errors(bounds[i], last, rest,
+                                       errs, resync,
+                                       spans ? &rest_spans : 0);
+                std::size_t skip = static_cast<std::size_t>(
+                    bounds[i] - first);
+                std::size_t lines = static_cast<std::size_t>(
+                    std::count(first, bounds[i], '\n'));
+                for (std::size_t j = 0; j < errs.size(); ++j) {
+                    errs[j].offset += skip;
+                    errs[j].line += lines;
+                    errors->push_back(errs[j]);
+                }
+                for (std::size_t j = 0; j < rest_spans.size(); ++j) {
+                    rest_spans[j].offset += skip;
+                    spans->push_back(rest_spans[j]);
+                }
+            } else {
+                ret = read(bounds[i], last, rest);
+            }
+            entries.insert(entries.end(),
+                           std::make_move_iterator(rest.begin()),
+                           std::make_move_iterator(rest.end()));
+            break;
+        }
+        entries.insert(entries.end(),
+                       std::make_move_iterator(parts[i].begin()),
+                       std::make_move_iterator(parts[i].end()));
+        if (spans) {
+            spans->insert(spans->end(), part_spans[i].begin(),
+                          part_spans[i].end());
+        }
+    }
+
+    // Junk at the end of a chunk is not part of any span, whereas
+    // the serial parse puts it at the start of the next one
+    if (spans && ret) {
+        std::size_t expected = 0;
+        for (std::size_t i = span0; i < spans->size(); ++i) {
+            EntrySpan& sp = (*spans)[i];
+            if (sp.offset != expected) {
+                sp.length += sp.offset - expected;
+                sp.offset = expected;
+                sp.hash = content_hash(first + sp.offset,
+                                       first + sp.offset + sp.length);
+            }
+            expected = sp.offset + sp.length;
+        }
+    }
+
+    return ret;
+}
+
+//------------------------------------------------------------------
+// Streaming entry-at-a-time reader
+//------------------------------------------------------------------
+
+/**
+ * @brief Pull-style reader which yields one BibTeXEntry at a time.
+ *
+ * The input is either a contiguous buffer or an input stream.  A
+ * stream is read in blocks, and only the text between two accepted
+ * entry boundaries (see detail::nextBoundary()) is held in memory,
+ * so the memory use is bounded by the largest entry rather than by
+ * the size of the input.
+ *
+ * Each region between boundaries is parsed with the same grammar
+ * and accepted under the same condition as in read_parallel().
+ * Reading stops at the first entry which does not parse, and
+ * errors() then describes it.
+ *
+ * A region which does not parse is extended to the next boundary
+ * only once, in case the boundary was inside an entry, so that a
+ * bad entry does not make the reader hold and re-parse the rest of
+ * the input.  The entries returned by next() are therefore those
+ * of the bulk read() except when an entry contains two or more
+ * boundaries, i.e. two or more lines which begin with @c \@ outside
+ * of braces.  This can only happen in an entry delimited by
+ * parentheses, or after unbalanced braces between entries.  The
+ * reader then stops at that entry and reports it in errors(),
+ * whereas read() accepts it.
+ *
+ * @code
+ * std::ifstream in("refs.bib");
+ * bibtex::EntryReader reader(in);
+ * bibtex::BibTeXEntry e;
+ * while (reader.next(e)) {
+ *     // ...
+ * }
+ * @endcode
+ */
+class EntryReader
+{
+public:
+    /**
+     * @brief Read entries from stream @p in.
+     *
+     * @param in     Input stream.
+     * @param block  Number of bytes requested from @p in at a time.
+     */
+    explicit EntryReader(std::istream& in, std::size_t block = 65536)
+        : in_(&in), ext_(0), ext_size_(0), block_(block),
+          eof_(false), done_(false), base_(0), lines_(0), cur_(0),
+          scan_(0), end_(0), depth_(0), next_(0)
+    {
+        if (block_ == 0) {
+            block_ = 1;
+        }
+    }
+
+    /**
+     * @brief Read entries from the buffer [@p first, @p last).
+     *
+     * The buffer must outlive the reader.
+     */
+    EntryReader(const char* first, const char* last)
+        : in_(0), ext_(first),
+          ext_size_(static_cast<std::size_t>(last - first)),
+          block_(0), eof_(true), done_(false), base_(0), lines_(0),
+          cur_(0), scan_(0), end_(0), depth_(0), next_(0)
+    {
+    }
+
+    /**
+     * @brief Parse the next entry into @p entry.
+     *
+     * @return @c false when there are no further entries, either
+     *         because the input is exhausted or because the
+     *         remaining input does not parse.
+     */
+    bool next(BibTeXEntry& entry)
+    {
+        while (next_ == pending_.size()) {
+            pending_.clear();
+            next_ = 0;
+            if (done_ || !fill()) {
+                return false;
+            }
+        }
+        entry = std::move(pending_[next_]);
+        ++next_;
+        return true;
+    }
+
+    /**
+     * @brief Byte offset, from the beginning of the input, of the
+     *        first byte not yet consumed by the parser.
+     */
+    std::size_t offset() const
+    {
+        return base_ + cur_;
+    }
+
+    /**
+     * @brief The entry which did not parse, if next() returned
+     *        @c false because of one.
+     */
+    const std::vector<ParseError>& errors() const
+    {
+        return errors_;
+    }
+
+private:
+    EntryReader(const EntryReader&);
+    EntryReader& operator=(const EntryReader&);
+
+    const char* data() const
+    {
+        return ext_ ? ext_ : buf_.data();
+    }
+
+    std::size_t size() const
+    {
+        return ext_ ? ext_size_ : buf_.size();
+    }
+
+    /// Append the next block of the stream to the buffer
+    bool readBlock()
+    {
+        if (eof_) {
+            return false;
+        }
+        // Drop consumed text before growing the buffer
+        if (cur_ > 0 && cur_ >= buf_.size() / 2) {
+            lines_ += static_cast<std::size_t>(
+                std::count(buf_.begin(), buf_.begin() + cur_, '\n'));
+            buf_.erase(0, cur_);
+            base_ += cur_;
+            scan_ -= cur_;
+            end_ -= cur_;
+            cur_ = 0;
+        }
+        std::size_t old = buf_.size();
+        buf_.resize(old + block_);
+        in_->read(&buf_[old], static_cast<std::streamsize>(block_));
+        std::size_t got = static_cast<std::size_t>(in_->gcount());
+        buf_.resize(old + got);
+        if (got < block_) {
+            eof_ = true;
+        }
+        return got > 0;
+    }
+
+    /// Locate the next candidate boundary after the region end
+    bool findBoundary()
+    {
+        for (;;) {
+            const char* first = data() + cur_;
+            const char* last = data() + size();
+            const char* scan = data() + scan_;
+            const char* b = detail::nextBoundary(
+                first, last, data() + end_ + 1, depth_, scan);
+            scan_ = static_cast<std::size_t>(scan - data());
+            if (b != last) {
+                end_ = static_cast<std::size_t>(b - data());
+                return true;
+            }
+            if (!readBlock()) {
+                end_ = size();
+                return false;
+            }
+        }
+    }
+
+    /// Record the entry at @p it, which did not parse, and stop
+    void fail(const char* it)
+    {
+        const char* first = data();
+        const char* line_begin = it;
+        while (line_begin != first && line_begin[-1] != '\n') {
+            --line_begin;
+        }
+        ParseError err;
+        err.offset = base_ + static_cast<std::size_t>(it - first);
+        err.line = lines_ + 1
+            + static_cast<std::size_t>(std::count(first, it, '\n'));
+        err.column = static_cast<std::size_t>(it - line_begin) + 1;
+        const char* last = first + size();
+        const char* eol = it;
+        while (eol != last && *eol != '\n' && *eol != '\r'
+               && eol - it < 60) {
+            ++eol;
+        }
+        err.text.assign(it, eol);
+        errors_.push_back(err);
+        cur_ = static_cast<std::size_t>(it - first);
+        done_ = true;
+    }
+
+    /// Parse the next accepted region into the pending list
+    bool fill()
+    {
+        if (cur_ == size() && !readBlock()) {
+            done_ = true;
+            return false;
+        }
+        scan_ = cur_;
+        end_ = cur_;
+        depth_ = 0;
+        // A region is extended past a boundary at most once
+        for (int extended = 0;; ++extended) {
+            bool found = findBoundary();
+            const char* it = data() + cur_;
+            const char* end = data() + end_;
+            if (!found) {
+                // Final region: parse exactly as the bulk read()
+                x3::phrase_parse(it, end, *detail::start,
+                                 bibtex::space, pending_);
+                x3::phrase_parse(it, end, detail::junk, bibtex::space);
+                if (it != end) {
+                    fail(it);
+                } else {
+                    cur_ = end_;
+                    done_ = true;
+                }
+                return !pending_.empty();
+            }
+            std::vector<BibTeXEntry> part;
+            x3::phrase_parse(it, end, *detail::start,
+                             bibtex::space, part);
+            x3::phrase_parse(it, end, detail::junk, bibtex::space);
+            if (it == end) {
+                pending_.swap(part);
+                cur_ = end_;
+                return true;
+            }
+            if (extended == 1) {
+                // Keep the entries before the one which failed
+                pending_.swap(part);
+                fail(it);
+                return !pending_.empty();
+            }
+        }
+    }
+
+    std::istream* in_;
+    const char* ext_;
+    std::size_t ext_size_;
+    std::size_t block_;
+    bool eof_;
+    bool done_;
+    std::string buf_;
+    /// Absolute offset of the first byte of buf_
+    std::size_t base_;
+    /// Number of lines before the first byte of buf_
+    std::size_t lines_;
+    /// Offset of the first unconsumed byte
+    std::size_t cur_;
+    /// Offset up to which depth_ has been computed
+    std::size_t scan_;
+    /// Offset of the end of the current region
+    std::size_t end_;
+    long depth_;
+    std::vector<BibTeXEntry> pending_;
+    std::size_t next_;
+    std::vector<ParseError> errors_;
+};
+
+/**
+ * @brief Call @p visitor once for every entry read from @p in, in
+ *        order, without storing the entries.
+ *
+ * @tparam Visitor  Callable with signature
+ *                  <tt>void(BibTeXEntry&)</tt>.
+ * @return The number of entries visited.
+ */
+template<class Visitor>
+inline std::size_t for_each_entry(std::istream& in, Visitor visitor)
+{
+    EntryReader reader(in);
+    BibTeXEntry entry;
+    std::size_t n = 0;
+    while (reader.next(entry)) {
+        visitor(entry);
+        ++n;
+    }
+    return n;
+}
+
+/**
+ * @brief Call @p visitor once for every entry in the buffer
+ *        [@p first, @p last), in order.
+ *
+ * @tparam Visitor  Callable with signature
+ *                  <tt>void(BibTeXEntry&)</tt>.
+ * @return The number of entries visited.
+ */
+template<class Visitor>
+inline std::size_t for_each_entry(const char* first, const char* last,
+                                  Visitor visitor)
+{
+    EntryReader reader(first, last);
+    BibTeXEntry entry;
+    std::size_t n = 0;
+    while (reader.next(entry)) {
+        visitor(entry);
+        ++n;
+    }
+    return n;
+}
+
 /**
  * @brief Stream extraction operator for a single BibTeX entry.
  *
@@ -0,0 +1,553 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_snapshot.h
+    \brief Snapshots of a list of entries which share unchanged entries
+*/
+#ifndef BT_SNAPSHOT_H
+#define BT_SNAPSHOT_H
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bt_arena.h"
+#include "bt_entry.h"
+
+namespace bibtex {
+
+/**
+ * @brief A change to a list of entries, holding the entries it
+ *        replaced so that it can be reversed.
+ *
+ * SnapshotHistory::apply() reverses a change and leaves in it the
+ * entries it removed from the list, so that applying it again
+ * repeats the change.  A change is one of
+ * - a splice: the entries [@ref pos, @ref pos + @ref count) of the
+ *   list replaced the entries in @ref ents,
+ * - a removal: the entries in @ref ents were removed from positions
+ *   @ref ix of the list, or were put back if @ref ents is empty,
+ * - a selection: entry @c k of the list was entry @c ix[k] of the
+ *   list of @ref size entries, whose other entries are in
+ *   @ref ents.
+ */
+struct EntryChange
+{
+    enum Kind { splice, removal, selection };
+
+    EntryChange()
+        : kind(splice), pos(0), count(0), size(0), done(true)
+    {
+    }
+
+    Kind kind;
+    /// First entry of a splice.
+    std::size_t pos;
+    /// Number of entries put in place by a splice.
+    std::size_t count;
+    /// Positions of the entries of a removal or a selection.
+    std::vector<std::size_t> ix;
+    /// Length of the list before a selection.
+    std::size_t size;
+    /// False if a removal or a selection has been reversed.
+    bool done;
+    /// The entries taken out of the list.
+    std::vector<BibTeXEntry> ents;
+    /// The arenas used by the fields of @ref ents.
+    EntryArenaHandle arenas;
+};
+
+/**
+ * @brief True if @p a and @p b are equal and their values are
+ *        written the same way, i.e. with the same delimiters and
+ *        macro references.
+ */
+inline bool same_entry(const BibTeXEntry& a, const BibTeXEntry& b)
+{
+    if (!(a == b)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.fields.size(); ++i) {
+        const ValueVector& va = a.fields[i].second;
+        const ValueVector& vb = b.fields[i].second;
+        for (std::size_t j = 0; j < va.size(); ++j) {
+            if (va[j].bare != vb[j].bare || va[j].macro != vb[j].macro) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief The views of a list of entries, and the changes to the
+ *        entries made since.
+ */
+struct Snapshot
+{
+    /// What was about to be done when the snapshot was made.
+    std::string desc;
+    /// Lists of indexes in the entries, see btmanip::bib_file.
+    std::vector<std::vector<std::size_t> > views;
+    /// The description of each of the @ref views.
+    std::vector<std::string> view_descs;
+    /// The changes made after the snapshot, in order.
+    std::vector<EntryChange> changes;
+};
+
+/**
+ * @brief Undo and redo stacks of snapshots of a list of entries.
+ *
+ * A snapshot does not copy the entries.  Instead, the owner of the
+ * list makes every change to it through modify(), splice(),
+ * remove() or select(), which record in the most recent snapshot
+ * the entries which are replaced or removed.  Making a snapshot
+ * thus costs nothing for the entries, and the entries which are
+ * changed afterwards are copied once each; entries which are
+ * removed or replaced by a new list are moved rather than copied.
+ * undo() reverses the changes recorded since the last snapshot,
+ * and redo() repeats them.
+ *
+ * Changes are recorded only while there is a snapshot to undo, and
+ * a change made outside of these functions makes undo() give a
+ * wrong list.
+ */
+class SnapshotHistory
+{
+public:
+
+    /// @param depth The maximum number of snapshots on each stack.
+    explicit SnapshotHistory(std::size_t depth = 20)
+        : depth_(depth)
+    {
+    }
+
+    /// @brief Set the maximum number of snapshots on each stack.
+    void set_depth(std::size_t depth)
+    {
+        depth_ = depth;
+        trim(undo_);
+        trim(redo_);
+    }
+
+    /// @brief Remove all snapshots.
+    void clear()
+    {
+        undo_.clear();
+        redo_.clear();
+        touched_.clear();
+    }
+
+    /// @brief True if changes are recorded for undo().
+    bool recording() const
+    {
+        return !undo_.empty();
+    }
+
+    /// @brief Number of snapshots which can be restored by undo().
+    std::size_t undo_size() const
+    {
+        return undo_.size();
+    }
+
+    /// @brief Number of snapshots which can be restored by redo().
+    std::size_t redo_size() const
+    {
+        return redo_.size();
+    }
+
+    /// @brief The snapshot undo() would restore.
+    const Snapshot& undo_top() const
+    {
+        return undo_.back();
+    }
+
+    /// @brief The snapshot redo() would restore.
+    const Snapshot& redo_top() const
+    {
+        return redo_.back();
+    }
+
+    /**
+     * @brief Move @p s to the undo stack, so that the changes which
+     *        follow are recorded in it, and remove all snapshots
+     *        from the redo stack.
+     */
+    void push(Snapshot& s)
+    {
+        redo_.clear();
+        touched_.clear();
+        if (depth_ == 0) {
+            return;
+        }
+        s.changes.clear();
+        undo_.push_back(std::move(s));
+        trim(undo_);
+    }
+
+    /**
+     * @brief Record entry @p i of @p ents, whose fields use
+     *        @p arenas, before it is modified in place.
+     *
+     * The entry is copied only the first time it is modified after
+     * a snapshot.
+     */
+    void modify(const std::vector<BibTeXEntry>& ents, std::size_t i,
+                const EntryArenaHandle& arenas)
+    {
+        if (begin_modify(i)) {
+            BibTeXEntry old(ents[i]);
+            modified(i, std::move(old), arenas);
+        }
+    }
+
+    /**
+     * @brief Return true if entry @p i must be recorded before it
+     *        is modified, and mark it as recorded.
+     *
+     * This is for code which only knows whether it changed the
+     * entry afterwards.  If this returns true, the caller copies
+     * the entry and, once done, gives the copy to modified(), or
+     * calls unmodified() if the entry did not change.  Calls to
+     * modify() in between do nothing.
+     */
+    bool begin_modify(std::size_t i)
+    {
+        return recording() && touched_.insert(i).second;
+    }
+
+    /**
+     * @brief Record @p old, a copy of entry @p i from before it was
+     *        modified in place, after begin_modify().
+     */
+    void modified(std::size_t i, BibTeXEntry&& old,
+                  const EntryArenaHandle& arenas)
+    {
+        EntryChange& c = record(EntryChange::splice, arenas);
+        c.pos = i;
+        c.count = 1;
+        c.ents.push_back(std::move(old));
+    }
+
+    /// @brief Entry @p i was not changed after begin_modify().
+    void unmodified(std::size_t i)
+    {
+        touched_.erase(i);
+    }
+
+    /**
+     * @brief Replace the @p n entries of @p ents from position
+     *        @p pos by the entries of @p repl, leaving @p repl
+     *        empty.
+     */
+    void splice(std::vector<BibTeXEntry>& ents, std::size_t pos,
+                std::size_t n, std::vector<BibTeXEntry>& repl,
+                const EntryArenaHandle& arenas)
+    {
+        if (!recording()) {
+            std::vector<BibTeXEntry> cur;
+            move_range(ents, pos, n, repl, cur);
+            repl.clear();
+            return;
+        }
+        touched_.clear();
+        EntryChange& c = record(EntryChange::splice, arenas);
+        c.pos = pos;
+        c.count = repl.size();
+        move_range(ents, pos, n, repl, c.ents);
+        repl.clear();
+    }
+
+    /**
+     * @brief Remove the entries of @p ents for which @p keep is
+     *        zero.
+     */
+    void remove(std::vector<BibTeXEntry>& ents,
+                const std::vector<char>& keep,
+                const EntryArenaHandle& arenas)
+    {
+        std::vector<BibTeXEntry> kept, dropped;
+        std::vector<std::size_t> ix;
+        kept.reserve(ents.size());
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            if (keep[i]) {
+                kept.push_back(std::move(ents[i]));
+            } else {
+                dropped.push_back(std::move(ents[i]));
+                ix.push_back(i);
+            }
+        }
+        ents.swap(kept);
+        if (recording() && !ix.empty()) {
+            touched_.clear();
+            EntryChange& c = record(EntryChange::removal, arenas);
+            c.ix.swap(ix);
+            c.ents.swap(dropped);
+        }
+    }
+
+    /**
+     * @brief Replace @p ents by the entries at positions @p ix, in
+     *        that order, where each position appears at most once.
+     */
+    void select(std::vector<BibTeXEntry>& ents,
+                const std::vector<std::size_t>& ix,
+                const EntryArenaHandle& arenas)
+    {
+        std::vector<BibTeXEntry> sel;
+        sel.reserve(ix.size());
+        for (std::size_t k = 0; k < ix.size(); ++k) {
+            sel.push_back(std::move(ents[ix[k]]));
+        }
+        if (!recording()) {
+            ents.swap(sel);
+            return;
+        }
+        touched_.clear();
+        EntryChange& c = record(EntryChange::selection, arenas);
+        c.ix = ix;
+        c.size = ents.size();
+        std::vector<char> used(ents.size(), 0);
+        for (std::size_t k = 0; k < ix.size(); ++k) {
+            used[ix[k]] = 1;
+        }
+        for (std::size_t i = 0; i < ents.size(); ++i) {
+            if (!used[i]) {
+                c.ents.push_back(std::move(ents[i]));
+            }
+        }
+        ents.swap(sel);
+    }
+
+    /**
+     * @brief Reverse the changes recorded since the last snapshot,
+     *        where @p arenas are those of @p ents, and replace
+     *        @p cur, holding the current views, by that snapshot.
+     *
+     * @p cur is pushed on the redo stack with the changes.
+     *
+     * @return @c false if the undo stack is empty.
+     */
+    bool undo(std::vector<BibTeXEntry>& ents, EntryArenaHandle& arenas,
+              Snapshot& cur)
+    {
+        if (undo_.empty()) {
+            return false;
+        }
+        std::vector<EntryChange>& ch = undo_.back().changes;
+        for (std::size_t i = ch.size(); i-- > 0;) {
+            apply(ch[i], ents, arenas);
+        }
+        step(cur, undo_, redo_);
+        return true;
+    }
+
+    /**
+     * @brief Repeat the changes reversed by the last undo(), and
+     *        replace @p cur, holding the current views, by the
+     *        snapshot made after them.
+     *
+     * @return @c false if the redo stack is empty.
+     */
+    bool redo(std::vector<BibTeXEntry>& ents, EntryArenaHandle& arenas,
+              Snapshot& cur)
+    {
+        if (redo_.empty()) {
+            return false;
+        }
+        std::vector<EntryChange>& ch = redo_.back().changes;
+        for (std::size_t i = 0; i < ch.size(); ++i) {
+            apply(ch[i], ents, arenas);
+        }
+        step(cur, redo_, undo_);
+        return true;
+    }
+
+private:
+
+    /// Add a change to the last snapshot, which cannot be redone.
+    EntryChange& record(EntryChange::Kind kind,
+                        const EntryArenaHandle& arenas)
+    {
+        redo_.clear();
+        std::vector<EntryChange>& ch = undo_.back().changes;
+        ch.push_back(EntryChange());
+        ch.back().kind = kind;
+        ch.back().arenas.share(arenas);
+        return ch.back();
+    }
+
+    /**
+     * Replace the @p n entries of @p ents from @p pos by those of
+     * @p in, moving them to @p out.
+     */
+    static void move_range(std::vector<BibTeXEntry>& ents,
+                           std::size_t pos, std::size_t n,
+                           std::vector<BibTeXEntry>& in,
+                           std::vector<BibTeXEntry>& out)
+    {
+        out.clear();
+        out.reserve(n);
+        for (std::size_t i = pos; i < pos + n; ++i) {
+            out.push_back(std::move(ents[i]));
+        }
+        if (in.size() == n) {
+            for (std::size_t i = 0; i < n; ++i) {
+                ents[pos + i] = std::move(in[i]);
+            }
+            return;
+        }
+        if (pos + n == ents.size()) {
+            // At the end, as for an added entry: no shifting needed
+            ents.erase(ents.begin() + pos, ents.end());
+            for (std::size_t i = 0; i < in.size(); ++i) {
+                ents.push_back(std::move(in[i]));
+            }
+            return;
+        }
+        std::vector<BibTeXEntry> res;
+        res.reserve(ents.size() - n + in.size());
+        for (std::size_t i = 0; i < pos; ++i) {
+            res.push_back(std::move(ents[i]));
+        }
+        for (std::size_t i = 0; i < in.size(); ++i) {
+            res.push_back(std::move(in[i]));
+        }
+        for (std::size_t i = pos + n; i < ents.size(); ++i) {
+            res.push_back(std::move(ents[i]));
+        }
+        ents.swap(res);
+    }
+
+    /// Reverse or repeat @p c, which exchanges entries with @p ents.
+    static void apply(EntryChange& c, std::vector<BibTeXEntry>& ents,
+                      EntryArenaHandle& arenas)
+    {
+        // Each side keeps the arenas of the entries it receives
+        EntryArenaHandle from_list;
+        from_list.share(arenas);
+        arenas.share(c.arenas);
+        if (c.kind == EntryChange::splice) {
+            std::vector<BibTeXEntry> out;
+            std::size_t n = c.ents.size();
+            move_range(ents, c.pos, c.count, c.ents, out);
+            c.count = n;
+            c.ents.swap(out);
+        } else if (c.kind == EntryChange::removal) {
+            std::vector<BibTeXEntry> res, out;
+            if (c.done) {
+                // Put the entries back at their positions
+                std::size_t n = ents.size() + c.ents.size();
+                res.reserve(n);
+                for (std::size_t i = 0, j = 0, k = 0; i < n; ++i) {
+                    if (k < c.ix.size() && c.ix[k] == i) {
+                        res.push_back(std::move(c.ents[k++]));
+                    } else {
+                        res.push_back(std::move(ents[j++]));
+                    }
+                }
+            } else {
+                res.reserve(ents.size() - c.ix.size());
+                for (std::size_t i = 0, k = 0; i < ents.size(); ++i) {
+                    if (k < c.ix.size() && c.ix[k] == i) {
+                        out.push_back(std::move(ents[i]));
+                        ++k;
+                    } else {
+                        res.push_back(std::move(ents[i]));
+                    }
+                }
+            }
+            ents.swap(res);
+            c.ents.swap(out);
+            c.done = !c.done;
+        } else {
+            const std::size_t npos = static_cast<std::size_t>(-1);
+            std::vector<std::size_t> inv(c.size, npos);
+            for (std::size_t k = 0; k < c.ix.size(); ++k) {
+                inv[c.ix[k]] = k;
+            }
+            std::vector<BibTeXEntry> res, out;
+            if (c.done) {
+                res.reserve(c.size);
+                for (std::size_t i = 0, d = 0; i < c.size; ++i) {
+                    if (inv[i] != npos) {
+                        res.push_back(std::move(ents[inv[i]]));
+                    } else {
+                        res.push_back(std::move(c.ents[d++]));
+                    }
+                }
+            } else {
+                res.reserve(c.ix.size());
+                for (std::size_t k = 0; k < c.ix.size(); ++k) {
+                    res.push_back(std::move(ents[c.ix[k]]));
+                }
+                for (std::size_t i = 0; i < c.size; ++i) {
+                    if (inv[i] == npos) {
+                        out.push_back(std::move(ents[i]));
+                    }
+                }
+            }
+            ents.swap(res);
+            c.ents.swap(out);
+            c.done = !c.done;
+        }
+        c.arenas.share(from_list);
+    }
+
+    /**
+     * Move the snapshot at the top of @p from, with its changes,
+     * to @p cur, and push @p cur with those changes on @p to.
+     */
+    void step(Snapshot& cur, std::deque<Snapshot>& from,
+              std::deque<Snapshot>& to)
+    {
+        cur.changes.swap(from.back().changes);
+        to.push_back(std::move(cur));
+        trim(to);
+        cur = std::move(from.back());
+        from.pop_back();
+        touched_.clear();
+    }
+
+    /// Remove the oldest snapshots beyond the maximum depth.
+    void trim(std::deque<Snapshot>& d) const
+    {
+        while (d.size() > depth_) {
+            d.pop_front();
+        }
+    }
+
+    std::size_t depth_;
+    std::deque<Snapshot> undo_;
+    std::deque<Snapshot> redo_;
+    /// Entries recorded by modify() since the last change of order.
+    std::unordered_set<std::size_t> touched_;
+};
+
+} // namespace bibtex
+
+#endif // BT_SNAPSHOT_H
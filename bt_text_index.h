@@ -0,0 +1,624 @@
+/*
+  ───────────────────────────────────────────────────────────────────
+
+  Copyright (C) 2015-2026, Andrew W. Steiner
+
+  This file is part of btmanip.
+
+  btmanip is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  btmanip is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with btmanip. If not, see <http://www.gnu.org/licenses/>.
+
+  ───────────────────────────────────────────────────────────────────
+*/
+/** \file bt_text_index.h
+    \brief Inverted index of the words in text fields of a list of
+    entries
+*/
+#ifndef BT_TEXT_INDEX_H
+#define BT_TEXT_INDEX_H
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bt_entry.h"
+#include "bt_macro.h"
+
+namespace bibtex {
+
+/**
+ * @brief Call @p fn with each word of @p in, lower case and with
+ *        accents removed.
+ *
+ * LaTeX accent commands such as <tt>\\"{o}</tt> and <tt>\\c{c}</tt>
+ * are dropped and the letters <tt>\\ss</tt>, <tt>\\o</tt>,
+ * <tt>\\ae</tt> etc. spelled out, and the accented Latin letters of
+ * UTF-8 (U+00C0 to U+017F) are replaced by the letters without
+ * accents, so that e.g. <tt>M{\\"u}ller</tt> and <tt>Müller</tt>
+ * both give @c muller.  Braces do not end words, and other LaTeX
+ * commands, ASCII punctuation and spaces do.  Other non-ASCII
+ * characters are kept as they are.  The word passed to @p fn is a
+ * buffer which is reused for the next word.
+ */
+template<class Fn>
+void for_each_word(const std::string& in, Fn fn)
+{
+    // The letters for U+00C0 to U+00FF and U+0100 to U+017F, with
+    // upper-case letters standing for two letters and spaces for
+    // characters which end a word
+    static const char latin1[] =
+        "aaaaaaAceeeeiiiidnooooo ouuuuyTSaaaaaaAceeeeiiiidnooooo ouuuuyTy";
+    static const char latin_a[] =
+        "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiJJjjkkk"
+        "llllllllllnnnnnnnnnooooooQQrrrrrrssssssssttttttuuuuuuuuuuuu"
+        "wwyyyzzzzzzs";
+    std::string w;
+    // Append letter @c c, spelling out the upper-case ones
+    auto put = [&w](char c) {
+        switch (c) {
+        case 'A': w += "ae"; break;
+        case 'J': w += "ij"; break;
+        case 'Q': w += "oe"; break;
+        case 'S': w += "ss"; break;
+        case 'T': w += "th"; break;
+        default: w += c;
+        }
+    };
+    auto end_word = [&w, &fn]() {
+        if (!w.empty()) {
+            fn(static_cast<const std::string&>(w));
+            w.clear();
+        }
+    };
+    std::size_t n = in.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        unsigned char c = static_cast<unsigned char>(in[i]);
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            w += c;
+        } else if (c >= 'A' && c <= 'Z') {
+            w += static_cast<char>(c - 'A' + 'a');
+        } else if (c == '{' || c == '}') {
+            // Braces only protect case
+        } else if (c == '\\' && i + 1 < n) {
+            char d = in[i + 1];
+            if (d != 0 && std::strchr("'\"^`~=.", d)) {
+                // An accent on the letter which follows
+                ++i;
+                continue;
+            }
+            std::size_t j = i + 1;
+            std::string cmd;
+            while (j < n && std::isalpha(static_cast<unsigned char>(in[j]))) {
+                cmd += static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(in[j])));
+                ++j;
+            }
+            i = j - 1;
+            if (cmd == "ss" || cmd == "ae" || cmd == "oe") {
+                w += cmd;
+            } else if (cmd == "aa" || cmd == "o" || cmd == "l"
+                       || cmd == "i" || cmd == "j") {
+                w += cmd[0];
+            } else if (cmd.size() == 1
+                       && std::strchr("uvhcdbkrt", cmd[0])) {
+                // An accent, possibly followed by a space
+                if (j < n && in[j] == ' ') {
+                    ++i;
+                }
+            } else {
+                end_word();
+                if (cmd.empty()) {
+                    // A command like \\ or \&
+                    ++i;
+                }
+            }
+        } else if ((c == 0xc3 || c == 0xc4 || c == 0xc5) && i + 1 < n
+                   && (static_cast<unsigned char>(in[i + 1]) & 0xc0) == 0x80) {
+            unsigned cp = ((c & 0x1f) << 6)
+                | (static_cast<unsigned char>(in[i + 1]) & 0x3f);
+            ++i;
+            char r = ' ';
+            if (cp >= 0xc0 && cp < 0x100) {
+                r = latin1[cp - 0xc0];
+            } else if (cp >= 0x100 && cp < 0x180) {
+                r = latin_a[cp - 0x100];
+            }
+            if (r == ' ') {
+                end_word();
+            } else {
+                put(r);
+            }
+        } else if (c == 0xc2 && i + 1 < n) {
+            // Non-breaking space and Latin-1 punctuation
+            ++i;
+            end_word();
+        } else if (c >= 0x80) {
+            w += c;
+        } else {
+            end_word();
+        }
+    }
+    end_word();
+}
+
+/**
+ * @brief Append the words of @p in to @p words, see for_each_word().
+ */
+inline void fold_words(const std::string& in, std::vector<std::string>& words)
+{
+    for_each_word(in, [&words](const std::string& w) {
+        words.push_back(w);
+    });
+}
+
+/**
+ * @brief An inverted index of the words of some fields of a list of
+ *        entries, for word and phrase searches ranked by relevance.
+ *
+ * The words are found by for_each_word(), so searches ignore case and
+ * accents.  For each word the index holds, in compressed-row form,
+ * the entries which contain it, the number of times it occurs in
+ * each, and its positions, so that a search for several words
+ * intersects the lists of entries, starting from the shortest, and
+ * a phrase search checks the positions only in the entries which
+ * contain all its words.  Positions in different fields are not
+ * adjacent, so phrases do not span fields.  The results are ranked
+ * with the BM25 formula.
+ *
+ * The index is built in parallel by blocks of entries.  Like
+ * ColumnStore it records the address and length of the entry list
+ * it was built from, but the owner must call clear() after
+ * modifying entries in place.
+ */
+class TextIndex
+{
+public:
+
+    TextIndex()
+        : data_(0), size_(0), built_(false), avg_len_(0.0)
+    {
+        fields_.push_back("title");
+        fields_.push_back("abstract");
+        fields_.push_back("author");
+    }
+
+    /// @brief Set the names of the fields which are indexed.
+    void set_fields(const std::vector<std::string>& f)
+    {
+        fields_ = f;
+        clear();
+    }
+
+    /// @brief The names of the fields which are indexed.
+    const std::vector<std::string>& fields() const
+    {
+        return fields_;
+    }
+
+    /// @brief Remove the index.
+    void clear()
+    {
+        vocab_.clear();
+        doc_begin_.clear();
+        docs_.clear();
+        pos_begin_.clear();
+        pos_.clear();
+        doc_len_.clear();
+        data_ = 0;
+        size_ = 0;
+        built_ = false;
+        avg_len_ = 0.0;
+    }
+
+    /// @brief True if the index was built from @p ents.
+    bool current(const std::vector<BibTeXEntry>& ents) const
+    {
+        return built_ && ents.data() == data_ && ents.size() == size_;
+    }
+
+    /// @brief Number of distinct words.
+    std::size_t size() const
+    {
+        return vocab_.size();
+    }
+
+    /**
+     * @brief Index the fields of @p ents, using up to @p n_threads
+     *        threads for blocks of at least 1000 entries.
+     */
+    void build(const std::vector<BibTeXEntry>& ents, int n_threads = 1)
+    {
+        clear();
+        std::size_t n = ents.size();
+        std::size_t n_blocks = 1;
+        if (n_threads > 1) {
+            n_blocks = std::min(static_cast<std::size_t>(n_threads),
+                                std::max<std::size_t>(n / 1000, 1));
+        }
+        if (n_blocks > 1) {
+            // Expand the macros first, since expand() caches them
+            for (std::size_t i = 0; i < n; ++i) {
+                cache_expansions(ents[i]);
+            }
+        }
+        std::vector<Block> blocks(n_blocks);
+        std::vector<std::thread> pool;
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            std::size_t first = n * b / n_blocks;
+            std::size_t last = n * (b + 1) / n_blocks;
+            if (b + 1 < n_blocks) {
+                pool.push_back(std::thread(&TextIndex::scan, this,
+                                           std::cref(ents), first, last,
+                                           std::ref(blocks[b])));
+            } else {
+                scan(ents, first, last, blocks[b]);
+            }
+        }
+        for (std::size_t t = 0; t < pool.size(); ++t) {
+            pool[t].join();
+        }
+
+        // Give global numbers to the words, count the occurrences
+        // of each and the number of entries which contain it
+        doc_len_.resize(n, 0);
+        std::vector<std::size_t> n_pos, n_docs;
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            Block& bl = blocks[b];
+            bl.global.resize(bl.words.size());
+            for (std::size_t k = 0; k < bl.words.size(); ++k) {
+                std::pair<std::unordered_map<std::string,
+                                             std::uint32_t>::iterator,
+                          bool> r = vocab_.insert(std::make_pair(
+                    bl.words[k],
+                    static_cast<std::uint32_t>(vocab_.size())));
+                bl.global[k] = r.first->second;
+                if (r.second) {
+                    n_pos.push_back(0);
+                    n_docs.push_back(0);
+                }
+            }
+            std::vector<std::uint32_t> last(bl.words.size(), npos32);
+            for (std::size_t r = 0; r < bl.recs.size(); ++r) {
+                const Record& rec = bl.recs[r];
+                std::uint32_t g = bl.global[rec.word];
+                ++n_pos[g];
+                if (last[rec.word] != rec.doc) {
+                    last[rec.word] = rec.doc;
+                    ++n_docs[g];
+                }
+                ++doc_len_[rec.doc];
+            }
+        }
+
+        // Place the records by word, keeping the order of the
+        // entries and of the positions in each
+        std::size_t nw = vocab_.size();
+        doc_begin_.assign(nw + 1, 0);
+        std::vector<std::size_t> pos_first(nw + 1, 0);
+        for (std::size_t g = 0; g < nw; ++g) {
+            doc_begin_[g + 1] = doc_begin_[g] + n_docs[g];
+            pos_first[g + 1] = pos_first[g] + n_pos[g];
+        }
+        docs_.resize(doc_begin_[nw]);
+        pos_begin_.resize(doc_begin_[nw] + nw);
+        pos_.resize(pos_first[nw]);
+        std::vector<std::size_t> next_doc(doc_begin_.begin(),
+                                          doc_begin_.end() - 1);
+        std::vector<std::size_t> next_pos(pos_first.begin(),
+                                          pos_first.end() - 1);
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            const Block& bl = blocks[b];
+            for (std::size_t r = 0; r < bl.recs.size(); ++r) {
+                const Record& rec = bl.recs[r];
+                std::uint32_t g = bl.global[rec.word];
+                std::size_t d = next_doc[g];
+                if (d == doc_begin_[g] || docs_[d - 1] != rec.doc) {
+                    docs_[d] = rec.doc;
+                    pos_begin_[d + g] = next_pos[g];
+                    ++next_doc[g];
+                }
+                pos_[next_pos[g]++] = rec.pos;
+            }
+        }
+        // The end of the positions of the last entry of each word
+        for (std::size_t g = 0; g < nw; ++g) {
+            pos_begin_[doc_begin_[g + 1] + g] = pos_first[g + 1];
+        }
+
+        double total = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            total += doc_len_[i];
+        }
+        avg_len_ = (n > 0 ? total / n : 0.0);
+        data_ = ents.data();
+        size_ = n;
+        built_ = true;
+    }
+
+    /**
+     * @brief Find the entries which contain all of @p terms, ranked
+     *        by relevance.
+     *
+     * Each element of @p terms is split into words by for_each_word().
+     * If it has more than one word, the words must occur in that
+     * order as a phrase.  The results are pairs of a score and an
+     * index in the entry list, by decreasing score and then by
+     * increasing index.
+     */
+    void search(const std::vector<std::string>& terms,
+                std::vector<std::pair<double, std::size_t> >& results) const
+    {
+        results.clear();
+
+        // The word numbers of each phrase
+        std::vector<std::vector<std::uint32_t> > phrases;
+        std::vector<std::uint32_t> all;
+        for (std::size_t k = 0; k < terms.size(); ++k) {
+            std::vector<std::string> words;
+            fold_words(terms[k], words);
+            if (words.empty()) {
+                continue;
+            }
+            std::vector<std::uint32_t> ph;
+            for (std::size_t j = 0; j < words.size(); ++j) {
+                std::unordered_map<std::string, std::uint32_t>::
+                    const_iterator it = vocab_.find(words[j]);
+                if (it == vocab_.end()) {
+                    return;
+                }
+                ph.push_back(it->second);
+                all.push_back(it->second);
+            }
+            phrases.push_back(ph);
+        }
+        if (all.empty()) {
+            return;
+        }
+        std::sort(all.begin(), all.end());
+        all.erase(std::unique(all.begin(), all.end()), all.end());
+        std::sort(all.begin(), all.end(),
+                  [this](std::uint32_t a, std::uint32_t b) {
+                      return n_docs(a) < n_docs(b);
+                  });
+
+        // For each word of each phrase, its place in the list of
+        // all the words
+        std::vector<std::vector<std::size_t> > slots(phrases.size());
+        for (std::size_t p = 0; p < phrases.size(); ++p) {
+            for (std::size_t j = 0; j < phrases[p].size(); ++j) {
+                slots[p].push_back(std::find(all.begin(), all.end(),
+                                             phrases[p][j]) - all.begin());
+            }
+        }
+        double n_ents = static_cast<double>(size_);
+        std::vector<double> idf(all.size());
+        for (std::size_t k = 0; k < all.size(); ++k) {
+            double df = static_cast<double>(n_docs(all[k]));
+            idf[k] = std::log(1.0 + (n_ents - df + 0.5) / (df + 0.5));
+        }
+
+        // Intersect the lists of entries, starting from the shortest,
+        // with a cursor in each of the others
+        std::vector<std::size_t> cur(all.size());
+        for (std::size_t k = 0; k < all.size(); ++k) {
+            cur[k] = doc_begin_[all[k]];
+        }
+        const double k1 = 1.2, b = 0.75;
+        for (std::size_t d0 = doc_begin_[all[0]];
+             d0 < doc_begin_[all[0] + 1]; ++d0) {
+            std::uint32_t doc = docs_[d0];
+            bool found = true;
+            for (std::size_t k = 1; k < all.size() && found; ++k) {
+                std::size_t end = doc_begin_[all[k] + 1];
+                cur[k] = gallop(cur[k], end, doc);
+                found = (cur[k] < end && docs_[cur[k]] == doc);
+            }
+            if (!found) {
+                continue;
+            }
+            cur[0] = d0;
+            for (std::size_t p = 0; p < phrases.size() && found; ++p) {
+                found = has_phrase(phrases[p], slots[p], cur);
+            }
+            if (!found) {
+                continue;
+            }
+            double score = 0.0;
+            double norm = k1 * (1.0 - b + b * doc_len_[doc]
+                                / (avg_len_ > 0.0 ? avg_len_ : 1.0));
+            for (std::size_t k = 0; k < all.size(); ++k) {
+                double tf = static_cast<double>(positions_end(all[k], cur[k])
+                                                - positions_begin(all[k],
+                                                                  cur[k]));
+                score += idf[k] * tf * (k1 + 1.0) / (tf + norm);
+            }
+            results.push_back(std::make_pair(score,
+                                             static_cast<std::size_t>(doc)));
+        }
+        std::sort(results.begin(), results.end(),
+                  [](const std::pair<double, std::size_t>& x,
+                     const std::pair<double, std::size_t>& y) {
+                      return x.first > y.first
+                          || (x.first == y.first && x.second < y.second);
+                  });
+    }
+
+private:
+
+    static constexpr std::uint32_t npos32 =
+        static_cast<std::uint32_t>(-1);
+
+    /// One occurrence of a word.
+    struct Record
+    {
+        /// The number of the word in its Block.
+        std::uint32_t word;
+        std::uint32_t doc;
+        std::uint32_t pos;
+    };
+
+    /// The words of a block of entries.
+    struct Block
+    {
+        std::vector<std::string> words;
+        /// The global number of each word.
+        std::vector<std::uint32_t> global;
+        /// The occurrences, by entry and position.
+        std::vector<Record> recs;
+    };
+
+    /// Find the words of entries @p first to @p last into @p bl.
+    void scan(const std::vector<BibTeXEntry>& ents, std::size_t first,
+              std::size_t last, Block& bl) const
+    {
+        std::unordered_map<std::string, std::uint32_t> local;
+        std::string scratch;
+        for (std::size_t i = first; i < last; ++i) {
+            const BibTeXEntry& e = ents[i];
+            std::uint32_t pos = 0;
+            for (std::size_t f = 0; f < fields_.size(); ++f) {
+                for (std::size_t j = e.find_field(fields_[f]);
+                     j != BibTeXEntry::npos;
+                     j = e.find_field(fields_[f], j + 1)) {
+                    for_each_word(
+                        expand(e.fields[j].second, scratch),
+                        [&](const std::string& w) {
+                            std::unordered_map<std::string,
+                                               std::uint32_t>::iterator it =
+                                local.find(w);
+                            if (it == local.end()) {
+                                it = local.insert(std::make_pair(
+                                    w, static_cast<std::uint32_t>(
+                                        bl.words.size()))).first;
+                                bl.words.push_back(w);
+                            }
+                            Record rec;
+                            rec.word = it->second;
+                            rec.doc = static_cast<std::uint32_t>(i);
+                            rec.pos = pos++;
+                            bl.recs.push_back(rec);
+                        });
+                    // Keep phrases within one field
+                    ++pos;
+                }
+            }
+        }
+    }
+
+    /// Number of entries which contain word @p w.
+    std::size_t n_docs(std::uint32_t w) const
+    {
+        return doc_begin_[w + 1] - doc_begin_[w];
+    }
+
+    /// The first position of word @p w in its @p d-th entry overall.
+    std::size_t positions_begin(std::uint32_t w, std::size_t d) const
+    {
+        return pos_begin_[d + w];
+    }
+
+    std::size_t positions_end(std::uint32_t w, std::size_t d) const
+    {
+        return pos_begin_[d + w + 1];
+    }
+
+    /**
+     * The first element of @ref docs_ from @p first to @p end which
+     * is not less than @p doc, found by doubling steps from @p first
+     * and then bisection, since the cursors move forward by small
+     * steps.
+     */
+    std::size_t gallop(std::size_t first, std::size_t end,
+                       std::uint32_t doc) const
+    {
+        std::size_t step = 1, lo = first;
+        while (first < end && docs_[first] < doc) {
+            lo = first + 1;
+            first = (end - first > step ? first + step : end);
+            step *= 2;
+        }
+        return std::lower_bound(docs_.begin() + lo, docs_.begin() + first,
+                                doc) - docs_.begin();
+    }
+
+    /**
+     * True if the words @p ph occur in order in the current entry,
+     * where the entry of word @p ph[j] is at @p cur[slots[j]].
+     */
+    bool has_phrase(const std::vector<std::uint32_t>& ph,
+                    const std::vector<std::size_t>& slots,
+                    const std::vector<std::size_t>& cur) const
+    {
+        if (ph.size() < 2) {
+            return true;
+        }
+        for (std::size_t p = positions_begin(ph[0], cur[slots[0]]);
+             p < positions_end(ph[0], cur[slots[0]]); ++p) {
+            bool found = true;
+            for (std::size_t j = 1; j < ph.size() && found; ++j) {
+                std::vector<std::uint32_t>::const_iterator b =
+                    pos_.begin() + positions_begin(ph[j], cur[slots[j]]);
+                std::vector<std::uint32_t>::const_iterator e =
+                    pos_.begin() + positions_end(ph[j], cur[slots[j]]);
+                found = std::binary_search(
+                    b, e, static_cast<std::uint32_t>(pos_[p] + j));
+            }
+            if (found) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// The names of the indexed fields.
+    std::vector<std::string> fields_;
+    /// The number of each word.
+    std::unordered_map<std::string, std::uint32_t> vocab_;
+    /// The first element of @ref docs_ for each word, and the end.
+    std::vector<std::size_t> doc_begin_;
+    /// The entries which contain each word, in increasing order.
+    std::vector<std::uint32_t> docs_;
+    /**
+     * The first element of @ref pos_ for each element @c d of
+     * @ref docs_ of word @c w at <tt>d + w</tt>, followed by the end
+     * of the positions of the last entry of the word.
+     */
+    std::vector<std::size_t> pos_begin_;
+    /// The positions of the words in each entry.
+    std::vector<std::uint32_t> pos_;
+    /// Number of words in each entry.
+    std::vector<std::uint32_t> doc_len_;
+    /// Address of the entry list the index was built from.
+    const BibTeXEntry* data_;
+    /// Length of the entry list the index was built from.
+    std::size_t size_;
+    /// True if build() was called since clear().
+    bool built_;
+    /// Average of @ref doc_len_.
+    double avg_len_;
+};
+
+} // namespace bibtex
+
+#endif // BT_TEXT_INDEX_H
@@ -32,6 +32,8 @@
 // For time()
 #include <ctime>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -59,6 +61,7 @@ namespace btmanip {
     /// \name Parameters for 'set' command
     //@{
     o2scl::cli::parameter_int p_verbose;
+    o2scl::cli::parameter_int p_threads;
     o2scl::cli::parameter_bool p_recase_tag;
     o2scl::cli::parameter_bool p_reformat_journal;
     o2scl::cli::parameter_bool p_trans_latex_html;
@@ -70,6 +73,12 @@ namespace btmanip {
     o2scl::cli::parameter_bool p_autoformat_urls;
     o2scl::cli::parameter_bool p_add_empty_titles;
     o2scl::cli::parameter_bool p_remove_author_tildes;
+    o2scl::cli::parameter_bool p_use_mmap;
+    o2scl::cli::parameter_bool p_skip_bad_entries;
+    o2scl::cli::parameter_string p_cache;
+    o2scl::cli::parameter_bool p_use_columns;
+    o2scl::cli::parameter_bool p_use_text_index;
+    o2scl::cli::parameter_int p_undo_levels;
 
     /// A file of BibTeX entries
     bib_file bf;
@@ -103,6 +112,19 @@ namespace btmanip {
       return ncol;
     }
 
+    /** \brief Save a snapshot of the entries for 'undo' before
+	running the command given in \c sv
+    */
+    void save_snapshot(std::vector<std::string> &sv) {
+      std::string desc;
+      for(size_t i=0;i<sv.size();i++) {
+	if (i>0) desc+=' ';
+	desc+=sv[i];
+      }
+      bf.snapshot(desc);
+      return;
+    }
+
     
     /** \brief Read journal list file
         
@@ -134,11 +156,12 @@ namespace btmanip {
         given, set <field> to <value>.
     */
     virtual int set_field(std::vector<std::string> &sv, bool itive_com) {
+      if (sv.size()>=3) save_snapshot(sv);
       if (sv.size()==4) {
 	bf.set_field_value(sv[1],sv[2],sv[3]);
       } else if (sv.size()==3) {
-	if (bf.entries.size()==1) {
-          bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[0]);
+	if (bf.view_size()==1) {
+          bibtex_entry &bt=bf.view_entry(0);
 	  bf.set_field_value(bt,sv[1],sv[2]);
 	} else {
 	  cerr << "More than one entry, thus 'set-field' requires three "
@@ -154,31 +177,71 @@ namespace btmanip {
     /** \brief Search current list for field and pattern pairs.
 
         ["and"] ["or"] <field 1> <pattern 1> [field 2] [pattern 2]
+        or "expr" <expression>
 
         Search the current list for entries which have fields which
         match a specified pattern. Combine multiple criteria with
         "or" or "and" if specified. If at least one entry is
-        found, then the current list is replaced with the search
-        results. Replace one of the field arguments with "key" to
-        search by key name.
+        found, then the search results become the current list.
+        Replace one of the field arguments with "key" to search by
+        key name.
+
+        With "expr", the remaining arguments form an expression
+        which combines conditions with "and", "or", "not" and
+        parentheses, e.g.
+
+        search expr "year between 2015 and 2020 and citations > 50"
+
+        The conditions are <field> = <pattern> and <field> !=
+        <pattern> for patterns as above, ~ and !~ for patterns which
+        ignore case, <field> =~ /regex/ (or /regex/i to ignore case),
+        numeric comparisons <, <=, >, >= and == with a number,
+        <field> between <number> and <number>, and has <field>. The
+        field may be "key" or "tag" (the entry type). Patterns
+        containing spaces, parentheses or any of < > = ~ must be
+        quoted.
+
+        The entries which do not match are not removed: the search
+        results are a view of the entries, which is stacked on top
+        of the previous view. Use 'pop-view' to return to the
+        previous view, 'reset-views' to return to all entries and
+        'list-views' to list the views. Output commands use the
+        current view. Commands which modify or reorder the entries
+        first remove the entries which are not in the current view.
+        No snapshot is saved for 'undo', since 'pop-view' removes
+        the view.
      */
     virtual int search(std::vector<std::string> &sv, bool itive_com) {
-      if (sv.size()==3) {
+      if (sv[1]=="expr") {
+	// Quote the arguments which contained spaces, so that
+	// they remain single patterns
+	std::string expr;
+	for(size_t i=2;i<sv.size();i++) {
+	  if (i>2) expr+=' ';
+	  if (sv.size()>3 && sv[i].find(' ')!=std::string::npos &&
+	      sv[i].find('"')==std::string::npos) {
+	    expr+='"'+sv[i]+'"';
+	  } else {
+	    expr+=sv[i];
+	  }
+	}
+	bf.view_expr(expr);
+      } else if (sv.size()==3) {
 	std::vector<std::string>::iterator it=sv.begin();
 	sv.erase(it);
-	bf.search_or(sv);
+	bf.view_or(sv);
       } else if (sv[1]=="or") {
 	std::vector<std::string>::iterator it=sv.begin();
 	sv.erase(it);
 	it=sv.begin();
 	sv.erase(it);
-	bf.search_or(sv);
+	bf.view_or(sv);
       } else if (sv[1]=="and") {
 	std::vector<std::string>::iterator it=sv.begin();
 	sv.erase(it);
 	it=sv.begin();
 	sv.erase(it);
-	bf.search_and(sv);
+	bf.view_and(sv);
       } else {
 	cerr << "Failed in search." << endl;
 	return 1;
@@ -186,6 +249,186 @@ namespace btmanip {
       return 0;
     }
   
+    /** \brief Find the entries by one or more authors
+
+        Arguments: <tt><name> [name] ...</tt>
+
+        Create a view of the entries in the current view with any
+        of the specified authors, as for the 'search' command. A
+        name can be given as in an author field, e.g. "Muller, J."
+        or "J. M{\\"u}ller", or as a last name alone. Case, accents
+        and parts like "van der" and "Jr." are ignored, and the
+        initials, if given, need only agree with those in the entry,
+        so that "Muller, J." also finds "Muller, J. M.". Unlike
+        'search or author "*Muller*"', this does not match
+        "Mullerton". The author index is built by the first 'author'
+        command and reused until the entries are modified.
+     */
+    virtual int author(std::vector<std::string> &sv, bool itive_com) {
+      std::vector<std::string> names(sv.begin()+1,sv.end());
+      bf.view_author(names);
+      return 0;
+    }
+  
+    /** \brief Find entries by the words in their text fields
+
+        Arguments: <tt><word or phrase> [word or phrase] ...</tt>
+
+        Find the entries in the current view whose title, abstract
+        or author fields contain all of the specified words,
+        ignoring case and accents. An argument which contains
+        several words, e.g. "equation of state", must occur as a
+        phrase. The 20 best matches are listed by decreasing
+        relevance, and all matching entries become a new view, as
+        for the 'search' command. The word index is built the first
+        time it is needed, or when the file is read if
+        'use_text_index' is true.
+     */
+    virtual int find(std::vector<std::string> &sv, bool itive_com) {
+      std::vector<std::string> words(sv.begin()+1,sv.end());
+      std::vector<std::pair<double,size_t> > results;
+      bf.find_text(words,results);
+      size_t n_show=std::min(results.size(),(size_t)20);
+      for(size_t k=0;k<n_show;k++) {
+	bibtex_entry &bt=static_cast<bibtex_entry &>
+	  (bf.entries[results[k].second]);
+	cout.width(3);
+	cout << k+1 << ". ";
+	cout.precision(3);
+	cout << std::fixed << results[k].first << " "
+	     << *bt.key;
+	if (bt.is_field_present("title")) {
+	  cout << " " << bt.get_field("title");
+	}
+	cout << endl;
+      }
+      cout.unsetf(std::ios::floatfield);
+      cout.precision(6);
+      if (results.size()>n_show) {
+	cout << "(" << results.size()-n_show << " more.)" << endl;
+      }
+      return 0;
+    }
+  
+    /** \brief Return to the view before the last search
+
+        (No arguments.)
+
+        Remove the view created by the last 'search' command,
+        returning to the entries which were current before it.
+     */
+    virtual int pop_view(std::vector<std::string> &sv, bool itive_com) {
+      if (bf.n_views()==0) {
+	cerr << "No view to remove in 'pop-view'." << endl;
+	return 1;
+      }
+      bf.pop_view();
+      if (bf.verbose>0) {
+	cout << bf.view_size() << " records in the current view." << endl;
+      }
+      return 0;
+    }
+
+    /** \brief Return to all entries
+
+        (No arguments.)
+
+        Remove all views created by the 'search' command, returning
+        to the full list of entries.
+     */
+    virtual int reset_views(std::vector<std::string> &sv,
+			    bool itive_com) {
+      bf.reset_views();
+      if (bf.verbose>0) {
+	cout << bf.view_size() << " records in the current view." << endl;
+      }
+      return 0;
+    }
+
+    /** \brief List the stack of views
+
+        (No arguments.)
+
+        List the views created by the 'search' command, from the
+        full list of entries to the current view, with the number
+        of entries in each.
+     */
+    virtual int list_views(std::vector<std::string> &sv, bool itive_com) {
+      cout << "0. all entries: " << bf.entries.size() << endl;
+      for(size_t k=0;k<bf.n_views();k++) {
+	cout << k+1 << ". search " << bf.view_desc(k) << ": "
+	     << bf.view_count(k) << endl;
+      }
+      return 0;
+    }
+    
+    /** \brief Save a snapshot of the current entries
+
+        [description]
+
+        Save the current entries and views so that 'undo' can
+        restore them. The commands which modify the entries or read
+        new entries save a snapshot automatically, so this is only
+        needed to mark a state to return to. The commands which only
+        create a view do not, since 'pop-view' removes the view. The
+        entries are not copied: each entry is copied when it is
+        first changed after the snapshot. The number of snapshots
+        kept is set by 'undo_levels'.
+     */
+    virtual int snapshot(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      if (bf.verbose>0) {
+	cout << "Saved snapshot of " << bf.entries.size()
+	     << " entries (" << bf.n_undo() << " to undo)." << endl;
+      }
+      return 0;
+    }
+
+    /** \brief Undo the last command which changed the entries
+
+        (No arguments.)
+
+        Restore the entries and views saved before the last command
+        which changed them, or by the last 'snapshot' command. This
+        may be repeated up to 'undo_levels' times, and 'redo'
+        reverses it.
+     */
+    virtual int undo(std::vector<std::string> &sv, bool itive_com) {
+      if (bf.n_undo()==0) {
+	cerr << "Nothing to undo." << endl;
+	return 1;
+      }
+      std::string desc=bf.undo_desc();
+      bf.undo();
+      if (bf.verbose>0) {
+	cout << "Undid '" << desc << "', " << bf.view_size()
+	     << " records in the current view." << endl;
+      }
+      return 0;
+    }
+
+    /** \brief Redo the last command undone by 'undo'
+
+        (No arguments.)
+
+        Restore the entries and views as they were before the last
+        'undo'. Any command which changes the entries removes the
+        commands which can be redone.
+     */
+    virtual int redo(std::vector<std::string> &sv, bool itive_com) {
+      if (bf.n_redo()==0) {
+	cerr << "Nothing to redo." << endl;
+	return 1;
+      }
+      std::string desc=bf.redo_desc();
+      bf.redo();
+      if (bf.verbose>0) {
+	cout << "Redid '" << desc << "', " << bf.view_size()
+	     << " records in the current view." << endl;
+      }
+      return 0;
+    }
+    
     /** \brief Remove fields which match field and pattern pairs.
 
         ["and"] ["or"] <field 1> "<pattern 1> [field 2] [pattern 2] ...",
@@ -195,6 +438,8 @@ namespace btmanip {
         with "or" or "and" if specified.
      */
     virtual int remove(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      bf.apply_view();
       if (sv.size()==3) {
 	std::vector<std::string>::iterator it=sv.begin();
 	sv.erase(it);
@@ -234,40 +479,33 @@ namespace btmanip {
 	return 1;
       }
 
+      save_snapshot(sv);
+      bf.apply_view();
+      
       bib_file bf2;
       bf2.parse_bib(sv[1]);
 
-      bool found_duplicate=false;
-
-      for(size_t i=0;i<bf.entries.size();) {
-
-	bool found=false;
-
-	for(size_t j=0;j<bf2.entries.size();j++) {
-	  std::string key1=*(bf.entries[i].key);
-	  std::string key2=*(bf2.entries[j].key);
-	  if (key1==key2 && bf.entries[i].tag==bf2.entries[j].tag) {
-	    cout << "Duplicate keys and duplicate tags: "
-		 << bf.entries[i].tag << " " << key1 << endl;
-	    bf.entries.erase(bf.entries.begin()+i);
-	    j=bf2.entries.size();
-	    found_duplicate=true;
-	    found=true;
-	  }
+      // The tag and key of each entry in the file, separated by a
+      // null character
+      std::unordered_set<std::string> tag_keys;
+      for(size_t j=0;j<bf2.entries.size();j++) {
+	if (bf2.entries[j].key) {
+	  tag_keys.insert(bf2.entries[j].tag.str()+'\0'+
+			  *(bf2.entries[j].key));
 	}
-	if (!found) i++;
       }
 
-      // Remake 'sort' object if necessary
-      if (found_duplicate) {
-	bf.sort.clear();
-	for(size_t i=0;i<bf.entries.size();i++) {
-	  bibtex::BibTeXEntry &bt=bf.entries[i];
-	  if (bf.sort.find(*bt.key)==bf.sort.end()) {
-	    bf.sort.insert(make_pair(*bt.key,i));
-	  }
+      for(size_t i=0;i<bf.entries.size();i++) {
+	if (!bf.entries[i].key) continue;
+	std::string key1=*(bf.entries[i].key);
+	if (tag_keys.count(bf.entries[i].tag.str()+'\0'+key1)>0) {
+	  cout << "Duplicate keys and duplicate tags: "
+	       << bf.entries[i].tag << " " << key1 << endl;
+	  bf.remove_entry(i);
 	}
       }
+      bf.compact();
+      
       return 0;
     }
 
@@ -316,7 +554,15 @@ namespace btmanip {
       o2scl_hdf::hdf_file hf;
       hf.compr_type=1;
       hf.open_or_create(sv[1]);
-      hdf_output(hf,bf.entries,"btmanip");
+      if (bf.n_views()>0) {
+	std::vector<bibtex::BibTeXEntry> ents;
+	for(size_t i=0;i<bf.view_size();i++) {
+	  ents.push_back(bf.view_entry(i));
+	}
+	hdf_output(hf,ents,"btmanip");
+      } else {
+	hdf_output(hf,bf.entries,"btmanip");
+      }
       hf.close();
     
       return 0;
@@ -325,8 +571,8 @@ namespace btmanip {
     /** \brief Clear the current bibliography
      */
     virtual int clear(std::vector<std::string> &sv, bool itive_com) {
-      bf.entries.clear();
-      bf.sort.clear();
+      save_snapshot(sv);
+      bf.clear();
       return 0;
     }
     
@@ -344,8 +590,8 @@ namespace btmanip {
 	return 1;
       }
 
-      bf.entries.clear();
-      bf.sort.clear();
+      save_snapshot(sv);
+      bf.clear();
 
       o2scl_hdf::hdf_file hf;
       hf.open(sv[1]);
@@ -378,8 +624,8 @@ namespace btmanip {
 	"' ";
       std::string base_url="https://api.adsabs.harvard.edu/v1/";
             
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	
 	if (bf.is_field_present(bt,"doi")) {
 	  
@@ -432,8 +678,8 @@ namespace btmanip {
      */
     virtual int inspire_get(std::vector<std::string> &sv, bool itive_com) {
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	
 	if (bf.is_field_present(bt,"doi")) {
 	  
@@ -744,14 +990,14 @@ namespace btmanip {
               << date_old << " and " << date_new << ". </p>" << endl;
       frecent << endl;
       
-      for(size_t ie=0;ie<bf.entries.size();ie++) {
+      for(size_t ie=0;ie<bf.view_size();ie++) {
 
         bool title_written=false;
 
-        cout << ie << " of " << bf.entries.size()
+        cout << ie << " of " << bf.view_size()
              << " publications." << endl;
 
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[ie]);
+        bibtex_entry &bt=bf.view_entry(ie);
         
         cout << "Article titled " << endl;
         vector<string> sv2;
@@ -923,6 +1169,8 @@ namespace btmanip {
         Sort current BibTeX entries by key.
      */
     virtual int sort(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      bf.apply_view();
       bf.sort_bib();
       return 0;
     }
@@ -934,6 +1182,8 @@ namespace btmanip {
         Sort current BibTeX entries by date.
      */
     virtual int sort_by_date(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      bf.apply_view();
       if (sv.size()>=2 && sv[1]==((string)"descending")) {
 	bf.sort_by_date(true);
       } else {
@@ -942,6 +1192,17 @@ namespace btmanip {
       return 0;
     }
 
+    /** \brief Count the entries in \c b with each tag and key,
+	as the tag and key separated by a null character
+    */
+    void count_tags_keys(bib_file &b,
+			 std::unordered_map<std::string,size_t> &counts) {
+      for(size_t j=0;j<b.entries.size();j++) {
+	counts[b.entries[j].tag.str()+'\0'+*b.entries[j].key]++;
+      }
+      return;
+    }
+    
     /** \brief Find duplicates between two .bib files
 
         [file 1] [file 2]
@@ -959,21 +1220,22 @@ namespace btmanip {
       std::cout << "size: " << bf.journals.size() << endl;
       
       if (sv.size()==2) {
-	if (bf.entries.size()==0) {
+	if (bf.view_size()==0) {
 	  cerr << "No BibTeX entries to compare to." << endl;
 	  return 1;
 	}
 	bib_file bf2;
 	bf2.parse_bib(sv[1]);
-	for(size_t i=0;i<bf.entries.size();i++) {
-	  for(size_t j=0;j<bf2.entries.size();j++) {
-	    std::string key1=*(bf.entries[i].key);
-	    std::string key2=*(bf2.entries[j].key);
-	    if (key1==key2 && bf.entries[i].tag==bf2.entries[j].tag) {
-	      cout << "Duplicate: " << bf.entries[i].tag << " "
-		   << key1 << endl;
-	      found=true;
-	    }
+	std::unordered_map<std::string,size_t> counts;
+	count_tags_keys(bf2,counts);
+	for(size_t i=0;i<bf.view_size();i++) {
+	  bibtex_entry &bt=bf.view_entry(i);
+	  std::unordered_map<std::string,size_t>::iterator it=
+	    counts.find(bt.tag.str()+'\0'+*bt.key);
+	  for(size_t j=0;it!=counts.end() && j<it->second;j++) {
+	    cout << "Duplicate: " << bt.tag << " "
+		 << *bt.key << endl;
+	    found=true;
 	  }
 	}
       } else if (sv.size()>=3) {
@@ -981,15 +1243,15 @@ namespace btmanip {
 	bf2.parse_bib(sv[1]);
 	bib_file bf3;
 	bf3.parse_bib(sv[2]);
+	std::unordered_map<std::string,size_t> counts;
+	count_tags_keys(bf3,counts);
 	for(size_t i=0;i<bf2.entries.size();i++) {
-	  for(size_t j=0;j<bf3.entries.size();j++) {
-	    std::string key1=*(bf2.entries[i].key);
-	    std::string key2=*(bf3.entries[j].key);
-	    if (key1==key2 && bf2.entries[i].tag==bf3.entries[j].tag) {
-	      cout << "Duplicate: " << bf2.entries[i].tag << " "
-		   << key1 << endl;
-	      found=true;
-	    }
+	  std::unordered_map<std::string,size_t>::iterator it=
+	    counts.find(bf2.entries[i].tag.str()+'\0'+*bf2.entries[i].key);
+	  for(size_t j=0;it!=counts.end() && j<it->second;j++) {
+	    cout << "Duplicate: " << bf2.entries[i].tag << " "
+		 << *bf2.entries[i].key << endl;
+	    found=true;
 	  }
 	}
       } else {
@@ -997,113 +1259,90 @@ namespace btmanip {
 	  cout << "Looking for duplicates among current BibTeX entries."
 	       << endl;
 	}
-	bool restart=true;
-	size_t istart=0;
-	while (restart) {
-	  restart=false;
-	  for(size_t i=istart;i<bf.entries.size();i++) {
-	    for(size_t j=i+1;j<bf.entries.size();j++) {
-              bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
-              bibtex_entry &bt2=static_cast<bibtex_entry &>(bf.entries[j]);
-	      int dup_val=bf.possible_duplicate(bt,bt2);
-	      if (dup_val==1) {
-		cout << "Duplicate tag and key." << endl;
-		bf.bib_output_one(cout,bt);
-		bf.bib_output_one(cout,bt2);
-		cout << "Keep first, second, both, rename, or quit "
-		     << "(f,s,b,r,q)? " << flush;
-		char ch;
-		cin >> ch;
-		if (ch=='f') {
-		  vector<bibtex::BibTeXEntry>::iterator it=bf.entries.begin();
-		  it+=j;
-		  bf.entries.erase(it);
-		  restart=true;
-		  istart=i;
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		} else if (ch=='s') {
-		  vector<bibtex::BibTeXEntry>::iterator it=bf.entries.begin();
-		  it+=i;
-		  bf.entries.erase(it);
-		  restart=true;
-		  istart=i;
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		} else if (ch=='r') {
-		  // Get new names
-		  cout << "Enter new name for first entry:\n" << flush;
-		  std::string new1;
-		  cin >> new1;
-		  cout << "Enter new name for second entry:\n" << flush;
-		  std::string new2;
-		  cin >> new2;
-		  // Set new name
-		  *bt.key=new1;
-		  *bt2.key=new2;
-		  // Remake 'sort' object
-		  bf.sort.clear();
-		  for(size_t i2=0;i2<bf.entries.size();i2++) {
-		    bibtex::BibTeXEntry &bt3=bf.entries[i2];
-		    if (bf.sort.find(*bt3.key)==bf.sort.end()) {
-		      bf.sort.insert(make_pair(*bt3.key,i2));
-		    }
-		  }
-		} else if (ch=='q') {
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		  restart=false;
-		  cout << "Quitting early." << endl;
-		}
-		found=true;
-	      } else if (dup_val==2) {
-		cout << "Possible duplicate between "
-		     << *bt.key << " and " << *bt2.key << endl;
-		cout << endl;
-		
-		bf.bib_output_twoup(cout,bt,bt2,
-				    ((std::string)"Entry ")+o2scl::szttos(i),
-				    ((std::string)"Entry ")+o2scl::szttos(j));
-		
-		cout << "Keep left (" << *bt.key << "), right ("
-		     << *bt2.key << "), both, or quit (<, , >. , b , q)? ";
-		char ch;
-		cin >> ch;
-		if (ch=='<' || ch==',') {
-		  cout << "Keeping " << *bt.key << " ." << endl;
-		  vector<bibtex::BibTeXEntry>::iterator it=bf.entries.begin();
-		  it+=j;
-		  bf.entries.erase(it);
-		  restart=true;
-		  istart=i;
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		} else if (ch=='>' || ch=='.') {
-		  cout << "Keeping " << *bt2.key << " ." << endl;
-		  vector<bibtex::BibTeXEntry>::iterator it=bf.entries.begin();
-		  it+=i;
-		  bf.entries.erase(it);
-		  restart=true;
-		  istart=i;
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		} else if (ch=='q') {
-		  restart=false;
-		  i=bf.entries.size();
-		  j=bf.entries.size();
-		  cout << "Quitting early." << endl;
-		} else {
-		  cout << "Keeping both." << endl;
-		}
-		found=true;
-	      }
+	save_snapshot(sv);
+	bf.apply_view();
+
+	// Find the candidate pairs first. Entries which are not kept
+	// are only marked as removed, so the indexes of the others do
+	// not change while the user is prompted.
+	std::vector<std::pair<size_t,size_t> > pairs;
+	std::vector<int> dup_vals;
+	bf.find_duplicates(pairs,dup_vals);
+	if (bf.verbose>0) {
+	  cout << pairs.size() << " possible duplicate pairs found."
+	       << endl;
+	}
+	
+	bool quit=false;
+	for(size_t k=0;k<pairs.size() && !quit;k++) {
+	  size_t i=pairs[k].first, j=pairs[k].second;
+	  if (bf.is_removed(i) || bf.is_removed(j)) continue;
+	  bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+	  bibtex_entry &bt2=static_cast<bibtex_entry &>(bf.entries[j]);
+	  // Check again, since keys may have been renamed
+	  int dup_val=dup_vals[k];
+	  if (dup_val==1) dup_val=bf.possible_duplicate(bt,bt2);
+	  if (dup_val==1) {
+	    cout << "Duplicate tag and key." << endl;
+	    bf.bib_output_one(cout,bt);
+	    bf.bib_output_one(cout,bt2);
+	    cout << "Keep first, second, both, rename, or quit "
+		 << "(f,s,b,r,q)? " << flush;
+	    char ch;
+	    cin >> ch;
+	    if (ch=='f') {
+	      bf.remove_entry(j);
+	    } else if (ch=='s') {
+	      bf.remove_entry(i);
+	    } else if (ch=='r') {
+	      // Get new names
+	      cout << "Enter new name for first entry:\n" << flush;
+	      std::string new1;
+	      cin >> new1;
+	      cout << "Enter new name for second entry:\n" << flush;
+	      std::string new2;
+	      cin >> new2;
+	      // Set new name
+	      bf.modify_entry(bt);
+	      bf.modify_entry(bt2);
+	      *bt.key=new1;
+	      *bt2.key=new2;
+	      // Rebuild the key index
+	      bf.refresh_sort();
+	    } else if (ch=='q') {
+	      quit=true;
+	      cout << "Quitting early." << endl;
 	    }
-	    if (i%50==49) {
-	      std::cout << i+1 << "/" << bf.entries.size()
-			<< " records processed." << std::endl;
+	    found=true;
+	  } else if (dup_val==2) {
+	    cout << "Possible duplicate between "
+		 << *bt.key << " and " << *bt2.key << endl;
+	    cout << endl;
+	    
+	    bf.bib_output_twoup(cout,bt,bt2,
+				((std::string)"Entry ")+o2scl::szttos(i),
+				((std::string)"Entry ")+o2scl::szttos(j));
+	    
+	    cout << "Keep left (" << *bt.key << "), right ("
+		 << *bt2.key << "), both, or quit (<, , >. , b , q)? ";
+	    char ch;
+	    cin >> ch;
+	    if (ch=='<' || ch==',') {
+	      cout << "Keeping " << *bt.key << " ." << endl;
+	      bf.remove_entry(j);
+	    } else if (ch=='>' || ch=='.') {
+	      cout << "Keeping " << *bt2.key << " ." << endl;
+	      bf.remove_entry(i);
+	    } else if (ch=='q') {
+	      quit=true;
+	      cout << "Quitting early." << endl;
+	    } else {
+	      cout << "Keeping both." << endl;
 	    }
+	    found=true;
 	  }
 	}
+	bf.compact();
       }
 
       if (found==false && bf.verbose>0) {
@@ -1121,6 +1360,8 @@ namespace btmanip {
      */
     virtual int o2scl(std::vector<std::string> &sv, bool itive_com) {
       std::string data_dir=o2scl_settings.get_data_dir();
+      save_snapshot(sv);
+      bf.apply_view();
       bf.add_bib(data_dir+"/o2scl.bib");
       return 0;
     }
@@ -1149,6 +1390,8 @@ namespace btmanip {
       string format=kw.get_string("format","html");
       std::string url=kw.get_string("url","doi");
       
+      save_snapshot(sv);
+      bf.apply_view();
       bf.verbose=0;
       char *env_str=getenv("BTMANIP_BIB");
       if (env_str) {
@@ -1267,6 +1510,7 @@ namespace btmanip {
 	return 1;
       }
 
+      save_snapshot(sv);
       bf.parse_bib(sv[1]);
       return 0;
     }
@@ -1286,6 +1530,8 @@ namespace btmanip {
 	return 1;
       }
 
+      save_snapshot(sv);
+      bf.apply_view();
       bf.add_bib(sv[1]);
       return 0;
     }
@@ -1315,10 +1561,10 @@ namespace btmanip {
 	outs=&fout;
       }
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	bf.text_output_one(*outs,bt);
-	if (i+1<bf.entries.size()) (*outs) << endl;
+	if (i+1<bf.view_size()) (*outs) << endl;
       }
     
       if (sv.size()>1) {
@@ -1364,8 +1610,8 @@ namespace btmanip {
     
       std::string stmp;
       std::vector<std::string> slist;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	// Title
 	std::string title=bt.get_field("title");
@@ -1473,8 +1719,8 @@ namespace btmanip {
     
       std::string stmp;
       std::vector<std::string> slist;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	// Title
 	std::string title=bt.get_field("title");
@@ -1579,8 +1825,8 @@ namespace btmanip {
 
       std::string stmp;
       std::vector<std::string> slist;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	if (bf.is_field_present(bt,"doi")) {
 	  // DOI link and reference
@@ -1651,6 +1897,8 @@ namespace btmanip {
         Reverse the order of the current bibliography.
     */
     virtual int reverse(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      bf.apply_view();
       bf.reverse_bib();
       return 0;
     }
@@ -1677,8 +1925,8 @@ namespace btmanip {
       std::string stmp;
       std::vector<std::string> slist;
       (*outs) << "\\begin{enumerate}" << endl;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	cout << "Formatting entry " << i << " " << *bt.key << endl;
 
 	if (bf.is_field_present(bt,"doi")) {
@@ -1750,8 +1998,8 @@ namespace btmanip {
 
       std::string stmp;
       int count=0;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	// Authors
         if (bf.is_field_present(bt,"author")) {
@@ -1831,8 +2079,8 @@ namespace btmanip {
 
       std::string stmp;
       int count=0;
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
         if (bf.lower_string(bt.tag)==((string)"article")) {
 
@@ -1911,10 +2159,10 @@ namespace btmanip {
 	outs=&fout;
       }
     
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	bf.bib_output_one(*outs,bt);
-	if (i+1<bf.entries.size()) (*outs) << endl;
+	if (i+1<bf.view_size()) (*outs) << endl;
       }
 
       if (sv.size()>1) {
@@ -2174,68 +2422,46 @@ namespace btmanip {
     
     /** \brief Automatically set keys for all entries.
 
-        (No arguments.)
-
-        This command automatically sets the key for all entries equal
-        to the Last name of the first author, a two-digit year, and
-        the first two letters of the title.
+        [mapping file]
+
+        This command automatically sets the key for all entries in
+        the current view equal to the last name of the first author,
+        a two-digit year, and the first letters of the first two
+        title words. If the key is already used by another entry,
+        the letters "b", "c", ... are appended. Entries without an
+        author, a year or a title of at least two words keep their
+        keys. The keys are computed using the number of threads
+        given by 'threads'.
+
+        If [mapping file] is specified, the old and new keys of each
+        entry whose key changed are written to that file, one pair
+        per line, e.g. to update the citations in .tex files.
+        Otherwise they are written to the screen.
     */
     virtual int auto_key(std::vector<std::string> &sv, bool itive_com) {
-      
-      for(size_t i=0;i<bf.entries.size();i++) {
-	
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
-
-	// Ensure title, year, and author are present
-	if (bf.is_field_present(bt,"title") &&
-	    bf.is_field_present(bt,"year") &&
-	    bf.is_field_present(bt,"author")) {
-
-	  // Separate the title into words
-	  std::vector<std::string> title_words;
-	  o2scl::split_string(bt.get_field("title"),title_words);
-	  
-	  if (bt.get_field("title").length()>5 && title_words.size()>1) {
-
-	    // Start with the last name of the first author
-	    std::string auth2=bf.last_name_first_author(bt);
-
-	    // Remove non-alphabetic characters
-	    for(size_t j=0;j<auth2.length();j++) {
-	      if (!std::isalpha(auth2[j])) {
-		std::string tmp=auth2.substr(0,j)+
-		  auth2.substr(j+1,auth2.length()-j-1);
-		auth2=tmp;
-		j=0;
-	      }
-	    }
 
-	    // Add the year
-	    std::string key2=auth2+
-	      bt.get_field("year").substr(2,2);
-
-	    // Add the first characters of the first two
-	    // title words which begin with alphabetic characters
-	    int nadd=0;
-	    for(size_t j=0;j<title_words.size() && nadd<2;j++) {
-	      if (std::isalpha(title_words[j][0])) {
-		char c=std::tolower(title_words[j][0]);
-		key2+=c;
-		nadd++;
-	      }
-	    }
+      save_snapshot(sv);
+      std::vector<std::pair<std::string,std::string> > changes;
+      bf.auto_keys(changes);
 
-	    // Ensure the new key is not already present
-	    if (bf.sort.find(key2)==bf.sort.end()) {
-	      
-	      std::cout << "Proposing change " << *bt.key << " to " << key2
-			<< std::endl;
-	      bf.change_key(*bt.key,key2);
-	      
-	      if (i>0) i--;
-	    }
-	  }
-	  
+      if (sv.size()>=2) {
+	std::ofstream fout(sv[1]);
+	if (!fout) {
+	  cerr << "Could not open file " << sv[1] << " in 'auto-key'."
+	       << endl;
+	  return 1;
+	}
+	for(size_t i=0;i<changes.size();i++) {
+	  fout << changes[i].first << " " << changes[i].second << endl;
+	}
+	if (bf.verbose>0) {
+	  cout << "Changed " << changes.size() << " keys. Wrote mapping "
+	       << "to file " << sv[1] << " ." << endl;
+	}
+      } else {
+	for(size_t i=0;i<changes.size();i++) {
+	  cout << "Changed " << changes[i].first << " to "
+	       << changes[i].second << endl;
 	}
       }
       return 0;
@@ -2256,6 +2482,9 @@ namespace btmanip {
 	cerr << "Command 'change-key' requires more arguments." << endl;
 	return 1;
       }
+
+      save_snapshot(sv);
+      bf.apply_view();
       
       if (sv.size()==2) {
 	if (bf.entries.size()==1) {
@@ -2312,12 +2541,12 @@ namespace btmanip {
 	  klist[k]=o2scl::szttos(k)+". "+klist[k];
 	}
       } else {
-        if (bf.entries.size()==0) {
+        if (bf.view_size()==0) {
           cout << "Bibtex list empty." << endl;
           return 0;
         }
-	for(size_t k=0;k<bf.entries.size();k++) {
-	  klist.push_back(o2scl::szttos(k)+". "+*(bf.entries[k].key));
+	for(size_t k=0;k<bf.view_size();k++) {
+	  klist.push_back(o2scl::szttos(k)+". "+*(bf.view_entry(k).key));
 	}
       }
 
@@ -2346,9 +2575,9 @@ namespace btmanip {
 	outs=&fout;
       }
     
-      for(size_t i=0;i<bf.entries.size();i++) {
+      for(size_t i=0;i<bf.view_size();i++) {
 
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+        bibtex_entry &bt=bf.view_entry(i);
 
 	// Output tag and key
 	(*outs) << "@" << bt.tag << "{";
@@ -2368,7 +2597,7 @@ namespace btmanip {
 	      // If it's a set of pages, only print out
 	      // the first page
 	      if (bt.fields[j].second.size()>0) {
-		string first_page=bf.first_page(bt.fields[j].second[0]);
+		string first_page=bf.first_page(bibtex::expand(bt.fields[j].second));
 		(*outs) << bt.fields[j].first << " = {";
 		(*outs) << first_page << "}," << endl;
 	      }
@@ -2376,7 +2605,7 @@ namespace btmanip {
 	    } else if (bt.fields[j].second.size()>0) {
 	      // Output other fields
 	      (*outs) << bt.fields[j].first << " = {";
-	      (*outs) << bt.fields[j].second[0] << "}," << endl;
+	      (*outs) << bibtex::expand(bt.fields[j].second) << "}," << endl;
 	    }
 	  }
 	}
@@ -2489,6 +2718,8 @@ namespace btmanip {
         required fields are included.
     */
     virtual int clean(std::vector<std::string> &sv, bool itive_com) {
+      save_snapshot(sv);
+      bf.apply_view();
       if (sv.size()>1 && sv[1]==((std::string)"fast")) {
 	bf.clean(false);
       } else {
@@ -2513,8 +2744,8 @@ namespace btmanip {
 	outs=&fout;
       }
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	if (bf.is_field_present(bt,"url") &&
 	    bt.get_field("url").length()>0) {
@@ -2572,8 +2803,8 @@ namespace btmanip {
 	prefix=sv[2];
       }
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
       
 	if (bt.key) {
 	  (*outs) << "    \\anchor " << prefix << *bt.key << " " << *bt.key
@@ -2770,8 +3001,8 @@ namespace btmanip {
 	}
       }
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 
 	if (list) {
 	  (*outs) << "<li>" << endl;
@@ -2972,9 +3203,11 @@ namespace btmanip {
     virtual int inspire_cites(std::vector<std::string> &sv,
 			      bool itive_com) {
 
-      for(size_t i=0;i<bf.entries.size();i++) {
+      save_snapshot(sv);
+
+      for(size_t i=0;i<bf.view_size();i++) {
 	
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+        bibtex_entry &bt=bf.view_entry(i);
 	
 	if (bf.is_field_present(bt,"inspireid")) {
 	  
@@ -3031,13 +3264,15 @@ namespace btmanip {
 	return 1;
       }
 
+      save_snapshot(sv);
+
       std::string prefix="curl -X GET -H 'Authorization: Bearer:"+token+
 	"' '";
       std::string base_url="https://api.adsabs.harvard.edu/v1/search";
       
-      for(size_t i=0;i<bf.entries.size();i++) {
+      for(size_t i=0;i<bf.view_size();i++) {
 	
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+        bibtex_entry &bt=bf.view_entry(i);
 	
 	if (bf.is_field_present(bt,"bibcode")) {
 	  
@@ -3111,8 +3346,8 @@ namespace btmanip {
 	<< std::endl;
       */
 
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
 	if (bf.is_field_present(bt,"year") &&
 	    bf.is_field_present(bt,"month") &&
 	    bf.is_field_present(bt,"citations")) {
@@ -3200,8 +3435,8 @@ namespace btmanip {
       // In this function, we remove extra whitespace for titles which
       // have more than one line because ReST is picky about spacing
       
-      for(size_t i=0;i<bf.entries.size();i++) {
-        bibtex_entry &bt=static_cast<bibtex_entry &>(bf.entries[i]);
+      for(size_t i=0;i<bf.view_size();i++) {
+        bibtex_entry &bt=bf.view_entry(i);
       
 	if (bt.key) {
 	  (*outs) << ".. [" << *bt.key << "] : ";
@@ -3443,7 +3678,7 @@ namespace btmanip {
      */
     virtual int run(int argc, char *argv[]) {
     
-      static const int nopt=47;
+      static const int nopt=55;
       comm_option_s options[nopt]=
         {
           {'a',"add","",1,1,"","",
@@ -3451,12 +3686,17 @@ namespace btmanip {
            (this,&btmanip_class::add),cli::comm_option_both,
            1,"","btmanip_class","add",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"author","",1,-1,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::author),cli::comm_option_both,
+           1,"","btmanip_class","author",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"bbl-dups","",-1,-1,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::bbl_dups),cli::comm_option_both,
            1,"","btmanip_class","bbl_dups",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
-          {0,"auto-key","",0,0,"","",new comm_option_mfptr<btmanip_class>
+          {0,"auto-key","",0,1,"","",new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::auto_key),cli::comm_option_both,
            1,"","btmanip_class","auto_key",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
@@ -3543,6 +3783,11 @@ namespace btmanip {
            "This command is an alias of 'list-keys'.",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::list_keys),cli::comm_option_both},
+          {0,"list-views","",0,0,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::list_views),cli::comm_option_both,
+           1,"","btmanip_class","list_views",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {'n',"nsf","",0,1,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::nsf),cli::comm_option_both,
@@ -3563,6 +3808,11 @@ namespace btmanip {
            (this,&btmanip_class::doe_talks),cli::comm_option_both,
            1,"","btmanip_class","doe_talks",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"pop-view","",0,0,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::pop_view),cli::comm_option_both,
+           1,"","btmanip_class","pop_view",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"prop","",0,1,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::proposal),cli::comm_option_both,
@@ -3583,11 +3833,21 @@ namespace btmanip {
            (this,&btmanip_class::remove_field),cli::comm_option_both,
            1,"","btmanip_class","remove_field",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"redo","",0,0,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::redo),cli::comm_option_both,
+           1,"","btmanip_class","redo",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"reverse","",0,0,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::reverse),cli::comm_option_both,
            1,"","btmanip_class","reverse",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"reset-views","",0,0,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::reset_views),cli::comm_option_both,
+           1,"","btmanip_class","reset_views",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"rst","",0,2,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::rst),cli::comm_option_both,
@@ -3646,11 +3906,21 @@ namespace btmanip {
            (this,&btmanip_class::search),cli::comm_option_both,
            1,"","btmanip_class","search",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"find","",1,-1,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::find),cli::comm_option_both,
+           1,"","btmanip_class","find",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {'f',"set-field","",2,3,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::set_field),cli::comm_option_both,
            1,"","btmanip_class","set_field",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"snapshot","",0,-1,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::snapshot),cli::comm_option_both,
+           1,"","btmanip_class","snapshot",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"sort","",0,0,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::sort),cli::comm_option_both,
@@ -3676,6 +3946,11 @@ namespace btmanip {
            (this,&btmanip_class::text_short),cli::comm_option_both,
            1,"","btmanip_class","text_short",
            "doc/xml/classbtmanip_1_1btmanip__class.xml"},
+          {0,"undo","",0,0,"","",
+           new comm_option_mfptr<btmanip_class>
+           (this,&btmanip_class::undo),cli::comm_option_both,
+           1,"","btmanip_class","undo",
+           "doc/xml/classbtmanip_1_1btmanip__class.xml"},
           {0,"utk-rev","",0,1,"","",
            new comm_option_mfptr<btmanip_class>
            (this,&btmanip_class::utk_review),cli::comm_option_both,
@@ -3702,6 +3977,15 @@ namespace btmanip {
       p_verbose.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
       cl->par_list.insert(make_pair("verbose",&p_verbose));
 
+      p_threads.i=&bf.threads;
+      p_threads.help=((string)"Number of threads used to parse ")+
+	".bib files, to build the word index for 'find' and to "+
+	"compute keys in 'auto-key' (default 1).";
+      p_threads.doc_class="bib_file";
+      p_threads.doc_name="threads";
+      p_threads.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("threads",&p_threads));
+
       p_recase_tag.b=&bf.recase_tag;
       p_recase_tag.help="If true, unify the case of the tags (default true).";
       p_recase_tag.doc_class="bib_file";
@@ -3791,6 +4075,62 @@ namespace btmanip {
       p_add_empty_titles.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
       cl->par_list.insert(make_pair("add_empty_titles",&p_add_empty_titles));
     
+      p_use_mmap.b=&bf.use_mmap;
+      p_use_mmap.help=((string)"If true, memory-map .bib files when ")+
+	"parsing (default true).";
+      p_use_mmap.doc_class="bib_file";
+      p_use_mmap.doc_name="use_mmap";
+      p_use_mmap.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("use_mmap",&p_use_mmap));
+
+      p_skip_bad_entries.b=&bf.skip_bad_entries;
+      p_skip_bad_entries.help=((string)"If true, skip .bib entries ")+
+	"which cannot be parsed and continue with the next entry, "+
+	"otherwise stop at the first such entry (default true).";
+      p_skip_bad_entries.doc_class="bib_file";
+      p_skip_bad_entries.doc_name="skip_bad_entries";
+      p_skip_bad_entries.doc_xml_file=
+	"doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("skip_bad_entries",
+				    &p_skip_bad_entries));
+
+      p_cache.str=&bf.cache;
+      p_cache.help=((string)"Use of the .btcache file next to each ")+
+	".bib file: \"off\", \"read\" (load the cache if it matches "+
+	"the .bib file) or \"rw\" (also rewrite it after parsing) "+
+	"(default \"off\").";
+      p_cache.doc_class="bib_file";
+      p_cache.doc_name="cache";
+      p_cache.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("cache",&p_cache));
+
+      p_use_columns.b=&bf.use_columns;
+      p_use_columns.help=((string)"If true, the search and remove ")+
+	"commands scan column-oriented copies of the fields they "+
+	"match, which are kept until the entries change "+
+	"(default false).";
+      p_use_columns.doc_class="bib_file";
+      p_use_columns.doc_name="use_columns";
+      p_use_columns.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("use_columns",&p_use_columns));
+
+      p_use_text_index.b=&bf.use_text_index;
+      p_use_text_index.help=((string)"If true, build the word index ")+
+	"used by the find command when a file is read, rather than "+
+	"on the first find (default false).";
+      p_use_text_index.doc_class="bib_file";
+      p_use_text_index.doc_name="use_text_index";
+      p_use_text_index.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("use_text_index",&p_use_text_index));
+
+      p_undo_levels.i=&bf.undo_levels;
+      p_undo_levels.help=((string)"Number of snapshots of the ")+
+	"entries kept for the undo and redo commands (default 20).";
+      p_undo_levels.doc_class="bib_file";
+      p_undo_levels.doc_name="undo_levels";
+      p_undo_levels.doc_xml_file="doc/xml/classbtmanip_1_1bib__file.xml";
+      cl->par_list.insert(make_pair("undo_levels",&p_undo_levels));
+    
       cl->prompt="btmanip> ";
       cl->addl_help_cmd=((string)"\n There is a custom BibTeX entry ")+
 	"called 'Talk' which btmanip is designed to work with.\n \n"+